@@ -1,6 +1,41 @@
 /* Autonomous Remote Control (ARC)
    Developed by Isaiah Knorr
 
+   Version 0.3a
+   18 October 2026
+   - Controller reads take microseconds instead of milliseconds
+   - Ultrasonic pings are asynchronous, timed by interrupts and bounded by the max range
+   - EchoSweeper stores every reading of a sweep and sweeps one step at a time
+   - Eye pings are pipelined with the servo motion
+   - The eye runs on its own core (SensingTask), the control loop runs at a fixed period
+   - Hardware access goes through hal.h, the firmware can be run on a PC with the simulator in sim/
+   - Each stage of the loop is profiled, send 'p' over Serial to print the histograms ('r' clears them)
+   - Serial output is binary telemetry frames (telemetry.h), queued and written without blocking
+   - Servo and motor duty cycles are integer, any PWM resolution works and is checked when compiling (dutycycle.h)
+   - Pins and PWM channels in config.h are checked for conflicts when compiling (configcheck.h)
+   - Motor, controller and ultrasonic pins are written straight to the GPIO registers
+   - Buttons are turned into press/release events, outputs are only written when they change
+   - Sweep readings are median filtered, pinging again only until the readings agree (filter.h)
+   - Select+Start switches to autonomous mode, steering by an obstacle map updated every ping (obstaclemap.h)
+   - A close echo straight ahead brakes the car from the echo interrupt, and holds until forward is let go
+     (or, away from the controller, until a reading ahead is clear again).
+     Forward speed is capped by how old the last reading straight ahead is (emergencystop.h)
+   - The controller, actuator targets and eye readings are recorded to a ring log in flash (flashlog.h)
+   - Range sensors at the corners and rear ping alongside the eye, taking turns only with the
+     sensors that could hear them (pingscheduler.h)
+   - Objects are followed from sweep to sweep, with their radial and angular velocity (objecttracker.h)
+   - The rear motor and steering ramp to their targets with slew, acceleration and jerk limits,
+     stepped by a timer rather than the loop (motionprofile.h)
+   - setup() brings the car up in timed stages, outputs safe first, and nothing touches the
+     hardware before it. The time from power up to the first control tick is reported (bootsequence.h)
+   - Each pass of the loop and its slow stages are held to a deadline, and sustained overruns step
+     down to cheaper modes (fewer telemetry frames, fewer sweep divisions, a single ping) until the
+     loop keeps up again. Send 's' over Serial to print the overrun counts (loopsupervisor.h)
+   - loop() feeds the task watchdog, and the car stops if the sensing side goes quiet
+   - Setpoint, mode and waypoint commands from a phone or PC are read from Serial without
+     blocking, in the telemetry framing. They run out after their time to live, and each one
+     acted on is acknowledged with its latency (commandlink.h)
+
    Version 0.2a
    06 November 2020
    - Created Ultrasonic class to read from the HC-SR04 module
@@ -38,6 +73,8 @@
    2: Brief motor movement at boot
    Possible cause: The GPIO output lines are undefined until the boot process in complete.
    Possible solutions: Improved PWM controller, alternative GPIO configuration.
+   Mitigation: setup() brakes the motor first, and PWM channels are set up and given their duty
+   cycle before their pins are attached (bootsequence.h). The lines are still undefined until then.
 
    3: Low speed, overheating
    Cause: New motor driver needs a heat sink
@@ -46,6 +83,8 @@
 */
 
 #include "config.h"
+#include "configcheck.h"
+#include "hal.h"
 #include "servoesp32.h"
 #include "motor.h"
 #include "controller.h"
@@ -53,6 +92,17 @@
 #include "ultrasonic.h"
 #include "echosweeper.h"
 #include "pwmcontroller.h"
+#include "sensingtask.h"
+#include "profiler.h"
+#include "telemetry.h"
+#include "obstaclemap.h"
+#include "emergencystop.h"
+#include "flashlog.h"
+#include "pingscheduler.h"
+#include "motionprofile.h"
+#include "bootsequence.h"
+#include "loopsupervisor.h"
+#include "commandlink.h"
 
 // Used to store if eye is in sweeping mode
 bool isSweeping = false;
@@ -70,6 +120,39 @@ int targetSteeringAngle,targetEyeAngle;
 // Used to store if currently in manual mode or autonomous mode
 bool isManualMode = true;
 
+// Used to store if driven by commands from the command link, which overrides both modes
+bool isRemoteMode = false;
+
+// Number of the last sweep sent by telemetry
+unsigned long lastFrameSequence = 0;
+
+// Time of the last sweep reading recorded by the flash log
+unsigned long lastPointTime = 0;
+
+// Time of the last single ping sent by telemetry
+unsigned long lastDistanceTime = 0;
+
+// Number of flash log sector erases seen by the loop
+unsigned long lastEraseCount = 0;
+
+// Used to store if the eye is running on its own core
+bool isSplitCore = false;
+
+// Used to hold the control loop to a fixed period, and to measure the period achieved
+unsigned long lastControlTick;
+unsigned long lastControlTime = 0;
+unsigned long controlPeriod = 0;
+unsigned long maxControlPeriod = 0;
+
+// Time the last status frame was sent
+unsigned long lastStatusTime = 0;
+
+// Used to store if the motion profiles are stepped by their timer, otherwise they are stepped in loop()
+bool isMotionTimed = false;
+
+// Readings per sweep, fewer once the loop supervisor has stepped down
+int eyeDivisions = EYE_DIVISIONS;
+
 // Create Servo object
 ServoESP32 steeringServo(STEERING_SERVO_MIN_ANGLE,STEERING_SERVO_MAX_ANGLE,STEERING_SERVO_HOME_ANGLE,
   STEERING_SERVO_PWM_CHANNEL,STEERING_SERVO_PWM_WIRE,STEERING_SERVO_PWM_FREQENCY,STEERING_SERVO_PWM_RESOLUTION);
@@ -88,49 +171,339 @@ ControllerAction controllerAction;
 EchoSweeper eye(EYE_SERVO_MIN_ANGLE,EYE_SERVO_MAX_ANGLE,EYE_SERVO_HOME_ANGLE,EYE_PWM_CHANNEL,EYE_PWM_WIRE,
   EYE_PWM_FREQENCY,EYE_PWM_RESOLUTION,EYE_TRIGGER_WIRE,EYE_ECHO_WIRE,EYE_DIVISIONS,EYE_MIN_RANGE,EYE_MAX_RANGE);
 
+// Create EmergencyStop object, which brakes the rear motor from the eye's echo interrupt
+EmergencyStop emergencyStop(&rearMotor,&eye);
+
+// Create PingScheduler object, which runs the range sensors and takes turns with the eye
+PingScheduler rangeSensors;
+
+// Create SensingTask object, which runs the eye and the range sensors apart from the control loop
+SensingTask sensing(&eye,&rangeSensors);
+
+// Create Telemetry object, all serial output goes through it
+Telemetry telemetry(&Serial);
+
+// Create FlashLog object, which records what the car did to flash
+FlashLog flashLog;
+
+// Create MotionProfile objects, which ramp the rear motor and the steering to their targets
+MotionProfile driveProfile(DRIVE_SLEW_RATE,DRIVE_ACCELERATION,DRIVE_JERK,-1.0,1.0);
+MotionProfile steeringProfile(STEERING_SLEW_RATE,STEERING_ACCELERATION,STEERING_JERK,
+  STEERING_SERVO_MIN_ANGLE,STEERING_SERVO_MAX_ANGLE);
+
+// Create MotionProfiler object, which steps the profiles from a timer
+MotionProfiler motion;
+
+// Create BootSequence object, which times the stages of setup()
+BootSequence boot;
+
+// Create LoopSupervisor object, which holds the loop to its deadline
+LoopSupervisor supervisor(CONTROL_PERIOD_MILLIS * 1000UL,LOOP_DEADLINE_PERCENT);
+
+// Create CommandLink object, which reads commands from a phone or PC over Serial
+CommandLink commandLink(&Serial);
+
+/* Turns a heading (eye angle) into a steering angle. Eye angles grow to the left and steering
+ * angles to the right, so the heading is mirrored about 90 degrees.
+ */
+int getSteeringAngle(int heading) {
+  int steeringAngle = 180 - heading;
+  if(steeringAngle < STEERING_SERVO_MIN_ANGLE) steeringAngle = STEERING_SERVO_MIN_ANGLE;
+  if(steeringAngle > STEERING_SERVO_MAX_ANGLE) steeringAngle = STEERING_SERVO_MAX_ANGLE;
+  return steeringAngle;
+}
+
+// Sets the sensing and telemetry for a degrade level, each level keeps the cuts of the ones before it
+void applyDegradeLevel(DegradeLevel level) {
+  int decimation = level >= DEGRADE_TELEMETRY ? DEGRADED_TELEMETRY_DECIMATION : TELEMETRY_STATE_DECIMATION;
+  telemetry.setDecimation(TELEMETRY_CONTROLLER,decimation);
+  telemetry.setDecimation(TELEMETRY_ACTUATORS,decimation);
+  eyeDivisions = level >= DEGRADE_DIVISIONS ? DEGRADED_EYE_DIVISIONS : EYE_DIVISIONS;
+  telemetry.print("Degrade level: ");
+  telemetry.println(DEGRADE_LEVEL_NAMES[level]);
+}
+
 void setup() {
+  boot.begin();
+
+  // Outputs into a safe state before anything else: the motor braked, the other lines low
+  rearMotor.begin();
+  controller.begin();
+  halWritePin(EYE_TRIGGER_WIRE,LOW);
+  halPinMode(EYE_TRIGGER_WIRE,OUTPUT);
+  boot.endStage(BOOT_SAFE);
+
   // Start Serial services
   Serial.begin(SERIAL_BAUD_RATE,SERIAL_8N1,SERIAL_RX_WIRE,SERIAL_TX_WIRE);
+  boot.endStage(BOOT_SERIAL);
 
-  // Initialize pins
-  pinMode(LED_WIRE,OUTPUT);
-  pinMode(REAR_MOTOR_CONTROL_WIRE1,OUTPUT);
-  pinMode(REAR_MOTOR_CONTROL_WIRE2,OUTPUT);
-  pinMode(CONTROLLER_DATA_WIRE,INPUT);
-  pinMode(CONTROLLER_LATCH_WIRE,OUTPUT);
-  pinMode(CONTROLLER_CLOCK_WIRE,OUTPUT);
-  pinMode(EYE_TRIGGER_WIRE,OUTPUT);
-  pinMode(EYE_ECHO_WIRE,INPUT);
+  // Servo signals start at the home angles, the steering profile starts there too
+  steeringServo.begin();
+  eye.begin();
+  steeringProfile.reset(STEERING_SERVO_HOME_ANGLE);
+  boot.endStage(BOOT_SERVOS);
+
+  rangeSensors.addSensor(LEFT_RANGE_TRIGGER_WIRE,LEFT_RANGE_ECHO_WIRE,RANGE_MAX_RANGE,LEFT_RANGE_HEADING,
+    ULTRASONIC_FIELD_OF_VIEW,CORNER_RANGE_PRIORITY);
+  rangeSensors.addSensor(RIGHT_RANGE_TRIGGER_WIRE,RIGHT_RANGE_ECHO_WIRE,RANGE_MAX_RANGE,RIGHT_RANGE_HEADING,
+    ULTRASONIC_FIELD_OF_VIEW,CORNER_RANGE_PRIORITY);
+  rangeSensors.addSensor(REAR_RANGE_TRIGGER_WIRE,REAR_RANGE_ECHO_WIRE,RANGE_MAX_RANGE,REAR_RANGE_HEADING,
+    ULTRASONIC_FIELD_OF_VIEW,REAR_RANGE_PRIORITY);
   eyeDistance = 0.0;
   targetSpeed = 0.0;
   targetSteeringAngle = STEERING_SERVO_HOME_ANGLE;
   targetEyeAngle = EYE_SERVO_HOME_ANGLE;
+  boot.endStage(BOOT_SENSORS);
+
+  // Report the time taken by a controller read, this is a fixed cost of every loop
+  controller.getData();
+  telemetry.print("Controller read (us): ");
+  telemetry.println(controller.getReadTime());
+  telemetry.flush();
+  boot.endStage(BOOT_CONTROLLER);
+
+  // The controller and actuators change every loop, only every few loops are worth sending
+  telemetry.setDecimation(TELEMETRY_CONTROLLER,TELEMETRY_STATE_DECIMATION);
+  telemetry.setDecimation(TELEMETRY_ACTUATORS,TELEMETRY_STATE_DECIMATION);
+
+  // Move the eye to its own core, the control loop stays on this one
+  // If the task cannot be started the eye runs from loop() instead
+  if(SPLIT_CORE_MODE) {
+    isSplitCore = sensing.begin(SENSING_CORE);
+  }
+  // Ramp the motor and steering from a timer, if it cannot be started they are stepped from loop() instead
+  motion.add(&driveProfile,Motor::profileOutput,&rearMotor);
+  motion.add(&steeringProfile,ServoESP32::profileOutput,&steeringServo);
+  isMotionTimed = motion.begin();
+  // Carry on the log from where it was, without a log partition nothing is recorded
+  if(!flashLog.begin()) {
+    telemetry.println("No log partition, not recording");
+  }
+  // Reset if the loop gets stuck, setup() then brakes the motor before anything else
+  if(!halWatchdogBegin(WATCHDOG_TIMEOUT_MILLIS)) {
+    telemetry.println("Task watchdog not started");
+  }
+  supervisor.setBudget(SUPERVISE_CONTROLLER,CONTROLLER_BUDGET_MICROS);
+  supervisor.setBudget(SUPERVISE_RESPOND,RESPOND_BUDGET_MICROS);
+  supervisor.setBudget(SUPERVISE_SENSING,SENSING_BUDGET_MICROS);
+  supervisor.setBudget(SUPERVISE_REPORT,REPORT_BUDGET_MICROS);
+  supervisor.begin();
+  boot.endStage(BOOT_TASKS);
+  lastControlTick = halTicks();
 }
 
 void loop() {
-  // Check Mode, used to switch between manual and automated
-  if(isManualMode) { 
-    // Read raw data from controller
-    controllerData = controller.getData();
-    
-    // Update response based on input
-    controllerAction.respond(controllerData,&targetSpeed,&targetSteeringAngle,&targetEyeAngle);
-    
-    // Update servos and motors
-    rearMotor.setSpeed(targetSpeed);
-    steeringServo.setAngle(targetSteeringAngle);
-    eye.setAngle(targetEyeAngle);
+  PROFILE_START(STAGE_LOOP);
+  supervisor.startTick();
+  
+  // Read raw data from controller, in both modes so the mode can be switched
+  PROFILE_START(STAGE_CONTROLLER);
+  controllerData = controller.getData();
+  PROFILE_END(STAGE_CONTROLLER);
+  supervisor.endStage(SUPERVISE_CONTROLLER);
+  flashLog.logController(halMillis(),controllerData);
 
-    // Check if sweeping (enabled when start is held down)
-    if(controllerData == 0x08) {
-      eyeDistance = eye.sweep();
+  supervisor.startStage();
+  PROFILE_START(STAGE_RESPOND);
+  bool isButtonsChanged = controllerAction.update(controllerData);
+
+  // Check Mode, Select and Start pressed together switch between manual and automated, and take back a remote car
+  if(controllerData != 0xFF && (controllerData & MODE_TOGGLE_BUTTONS) == MODE_TOGGLE_BUTTONS &&
+    (controllerAction.getPressed() & MODE_TOGGLE_BUTTONS)) {
+    isManualMode = isRemoteMode || !isManualMode;
+    isRemoteMode = false;
+    isButtonsChanged = true;
+  }
+
+  // Read the commands that have arrived, a mode command switches like the buttons do
+  commandLink.update();
+  CommandMode commandMode;
+  if(commandLink.getMode(&commandMode)) {
+    isManualMode = commandMode == COMMAND_MODE_CONTROLLER;
+    isRemoteMode = commandMode == COMMAND_MODE_REMOTE;
+    isButtonsChanged = true;
+  }
+
+  if(isRemoteMode) {
+    /* Remote mode, a setpoint gives the targets straight, and a waypoint is followed like the
+     * autonomous mode with the free heading closest to it. The map holds a reading for a few
+     * sweeps, so a waypoint only goes forward while the eye has looked straight ahead within
+     * COMMAND_AHEAD_MAX_AGE_MILLIS. Once the last command has run out the car stops and looks
+     * ahead until another arrives.
+     */
+    RemoteCommand command;
+    if(!commandLink.getCommand(halMillis(),&command)) {
+      isSweeping = false;
+      targetSpeed = 0.0;
+      targetSteeringAngle = STEERING_SERVO_HOME_ANGLE;
+      targetEyeAngle = EYE_SERVO_HOME_ANGLE;
+    }
+    else if(command.type == COMMAND_SETPOINT) {
+      isSweeping = command.isSweeping;
+      targetSpeed = command.speed;
+      targetSteeringAngle = command.steeringAngle;
+      targetEyeAngle = command.eyeAngle;
     }
     else {
-      eyeDistance = eye.getDistance();
+      int heading;
+      isSweeping = true;
+      const SensorSnapshot& snapshot = sensing.read();
+      snapshot.map.chooseHeading(halMillis(),command.heading,&heading,&targetSpeed);
+      if(targetSpeed > command.speed) targetSpeed = command.speed;
+      if(snapshot.aheadTime == 0 || halMillis() - snapshot.aheadTime > COMMAND_AHEAD_MAX_AGE_MILLIS) targetSpeed = 0.0;
+      targetSteeringAngle = getSteeringAngle(heading);
+      targetEyeAngle = EYE_SERVO_HOME_ANGLE;
     }
+  }
+  else if(isManualMode) { 
+    // Update response based on input, only when the buttons change
+    if(isButtonsChanged) {
+      controllerAction.respond(controllerData,&targetSpeed,&targetSteeringAngle,&targetEyeAngle);
+    }
+
+    // Check if sweeping (enabled when start is held down)
+    isSweeping = controllerData == 0x08;
+  }
+  else {
+    /* Autonomous mode, the eye sweeps and the car heads for the free heading closest to
+     * straight ahead. Stops when there is no free heading.
+     */
+    int heading;
+    isSweeping = true;
+    sensing.read().map.chooseHeading(halMillis(),90,&heading,&targetSpeed);
+    targetSteeringAngle = getSteeringAngle(heading);
+    targetEyeAngle = EYE_SERVO_HOME_ANGLE;
+  }
+
+  // At the lowest level the eye pings where it points instead of sweeping
+  if(supervisor.getLevel() >= DEGRADE_SINGLE_PING) isSweeping = false;
+
+  // With no readings from the sensing side the car would be driving blind, so it stops
+  if(supervisor.isSensingStalled()) targetSpeed = 0;
+
+  /* The emergency stop is blind while the eye looks aside, so forward speed is capped by how old
+   * the last reading ahead is. A manual car with the eye held aside is left to the driver
+   */
+  float driveSpeed = targetSpeed;
+  if(isSweeping || !isManualMode || isRemoteMode) {
+    const SensorSnapshot& snapshot = sensing.read();
+    float speedLimit = EmergencyStop::getSpeedLimit(snapshot.aheadDistance,halMillis() - snapshot.aheadTime);
+    if(driveSpeed > speedLimit) driveSpeed = speedLimit;
+  }
+  PROFILE_END(STAGE_RESPOND);
+  supervisor.endStage(SUPERVISE_RESPOND);
+
+  // Set where the motor and steering ramp to, the motion profiles write the outputs
+  PROFILE_START(STAGE_MOTOR);
+  driveProfile.setTarget(driveSpeed);
+  /* An emergency stop holds until the car is no longer asked to go forward. The brake does not
+   * move the ramp, so it is only let go once the ramp has been dropped to the stop (the first
+   * step while braked), or it would carry on from the speed before the brake. The map and the
+   * commands keep asking to go forward, so away from the controller a clear reading ahead taken
+   * after the brake lets it go as well
+   */
+  if(targetSpeed <= 0 && driveProfile.getPosition() <= 0) emergencyStop.clear();
+  else if((!isManualMode || isRemoteMode) && driveProfile.getPosition() <= 0) {
+    const SensorSnapshot& snapshot = sensing.read();
+    emergencyStop.releaseIfClear(snapshot.aheadDistance,snapshot.aheadTime);
+  }
+  PROFILE_END(STAGE_MOTOR);
+  PROFILE_START(STAGE_SERVO);
+  steeringProfile.setTarget(targetSteeringAngle);
+  PROFILE_END(STAGE_SERVO);
+
+  // Tell the sender each command has been acted on, and how long it took from being read
+  int commandType;
+  unsigned long commandLatency;
+  while(commandLink.acknowledge(halMicros(),&commandType,&commandLatency)) {
+    telemetry.sendCommand(halMicros(),commandType,commandLatency);
+  }
+  if(!isMotionTimed) motion.update();
+
+  // The car answers the controller from the first tick on, report how long that took from power up
+  if(boot.endFirstTick()) boot.report(telemetry);
+  sensing.setCommand(isSweeping,targetEyeAngle,targetSpeed,eyeDivisions);
+  telemetry.sendController(halMicros(),controllerData);
+  telemetry.sendActuators(halMicros(),targetSpeed,targetSteeringAngle,targetEyeAngle);
+  flashLog.logActuators(halMillis(),targetSpeed,targetSteeringAngle,targetEyeAngle);
+  flashLog.setEraseAllowed(rearMotor.getSpeed() == 0);
+
+  // Without a core of its own, the eye does one non-blocking step here
+  if(!isSplitCore) {
+    supervisor.startStage();
+    sensing.runOnce();
+    supervisor.endStage(SUPERVISE_SENSING);
+  }
+
+  // Only report when a new reading has arrived
+  supervisor.startStage();
+  PROFILE_START(STAGE_REPORT);
+  if(sensing.update()) {
+    const SensorSnapshot& snapshot = sensing.read();
+    eyeDistance = snapshot.distance;
     
-    // Send serial message
-    Serial.println(eyeDistance);
+    // Send the whole sweep when one completes, otherwise each new single reading at the angle it was taken
+    if(snapshot.isSweeping) {
+      if(snapshot.frame.sequence != lastFrameSequence) {
+        lastFrameSequence = snapshot.frame.sequence;
+        telemetry.sendScan(snapshot.frame);
+      }
+    }
+    else if(snapshot.distanceTime != lastDistanceTime) {
+      lastDistanceTime = snapshot.distanceTime;
+      telemetry.sendDistance(snapshot.distanceTime,eyeDistance);
+      flashLog.logDistance(halMillis(),snapshot.eyeAngle,eyeDistance);
+    }
+
+    // Sweep readings are recorded and sent as they arrive, so a replay and the display get them at the same time
+    if(snapshot.point.timestamp != lastPointTime) {
+      lastPointTime = snapshot.point.timestamp;
+      flashLog.logScanPoint(halMillis(),snapshot.point.angle,snapshot.point.distance);
+      telemetry.sendPoint(snapshot.point);
+    }
+  }
+  supervisor.watchSensing(sensing.read().sequence);
+  flashLog.flush(halMillis());
+
+  // Report the worst control period since the last status
+  if(halMillis() - lastStatusTime >= TELEMETRY_STATUS_MILLIS) {
+    lastStatusTime = halMillis();
+    telemetry.sendStatus(halMicros(),maxControlPeriod,getOutputStats());
+    maxControlPeriod = 0;
+  }
+
+  // Write what the serial port can take now, the rest waits for the next loop
+  telemetry.flush();
+  PROFILE_END(STAGE_REPORT);
+  supervisor.endStage(SUPERVISE_REPORT);
+
+  // Print the loop profile on request ('p'), or clear it ('r'), or the overrun counts ('s')
+  int request = commandLink.getRequest();
+  if(request >= 0) {
+#ifdef ARC_PROFILING
+    if(request == 'p') getProfiler().dump(telemetry);
+    if(request == 'r') getProfiler().reset();
+#endif
+    if(request == 's') supervisor.dump(telemetry);
+  }
+  PROFILE_END(STAGE_LOOP);
+
+  // A flash erase stalls both cores, a pass it landed in is not held against the loop
+  if(flashLog.getEraseCount() != lastEraseCount) {
+    lastEraseCount = flashLog.getEraseCount();
+    supervisor.excuseTick();
+  }
+
+  // Step down to a cheaper mode under sustained overrun, or back up once the loop keeps up
+  if(supervisor.endTick()) applyDegradeLevel(supervisor.getLevel());
+  halWatchdogFeed();
+
+  // Hold the control loop to a fixed period when the eye has its own core
+  if(isSplitCore) {
+    halDelayUntil(&lastControlTick,CONTROL_PERIOD_MILLIS);
   }
-  // TODO: Autonomous mode, controlled with smart phone
+  unsigned long currentTime = halMicros();
+  controlPeriod = currentTime - lastControlTime;
+  lastControlTime = currentTime;
+  if(controlPeriod > maxControlPeriod) maxControlPeriod = controlPeriod;
 }
@@ -3,11 +3,20 @@
  * 
  * 06 Septemeber 2020
  * - Imported code from previous arduino project
+ * 
+ * 18 October 2026
+ * - Serial input is read by TelemetryReader, a fixed ring buffer that never blocks or allocates
+ * - Shows the distance, nearest scan point, actuators and loop period sent by ARC
+ * - Only the changed parts of the screen are sent (PartialDisplay), at 400 kHz
+ * - SELECT switches the telemetry screen to a radar plot of the sweep (RadarView)
 */
 
 #include <Wire.h> // This one is needed for I2C
 #include <Adafruit_GFX.h> // Used for graphics
 #include <Adafruit_SSD1306.h> // Needed for the 1306 OLED
+#include "telemetryreader.h"
+#include "partialdisplay.h"
+#include "radarview.h"
 
 #define WIDTH 128 // Screen width
 #define HEIGHT 32 // Screen height
@@ -31,8 +40,29 @@ int last = NONE;
 int pressCounter = 0;
 boolean longPress = false;
 const int LONG_PRESS_THRESHOLD = 20;
-// Create instance of Adafruit_SSD1306
-Adafruit_SSD1306 oled(WIDTH,HEIGHT, &Wire, RESET);
+const unsigned long REDRAW_PERIOD_MILLIS = 20; // Fastest the telemetry screen is redrawn
+const unsigned long TEXT_HOLD_MILLIS = 2000; // Time a text line is shown for
+// Reads telemetry from ARC
+TelemetryReader reader;
+// Latest values received, distances are in tenths of an inch (-1 if nothing in range)
+int distance = -1;
+int scanDistance = -1;
+int scanAngle = 0;
+int speed = 0;
+int steeringAngle = 90;
+int eyeAngle = 90;
+unsigned long controlPeriod = 0;
+unsigned long carDropped = 0;
+char textLine[TELEMETRY_MAX_LINE + 1];
+unsigned long textTime = 0;
+boolean isChanged = false;
+boolean isRadar = false; // Radar plot instead of the text
+boolean isRadarShown = false; // True once the whole plot has been drawn
+unsigned long lastRedraw = 0;
+// Create instance of PartialDisplay (an Adafruit_SSD1306 that only sends what changed)
+PartialDisplay oled(WIDTH,HEIGHT, &Wire, RESET);
+// Plots the sweep on oled
+RadarView radar(&oled);
 // NOTE: &Wire = address to I2C?
 static const unsigned char PROGMEM car_bmp[] =
 { 0, 0, 1, 255, 0, 0, 0, 0, 0, 0, 31, 255, 128, 0, 0, 0, 
@@ -62,9 +92,105 @@ int getKey(int buttonPressed) {
   if (buttonPressed < 790 && buttonPressed > 700) return SELECT;
 }
 
+// Stores the values of a telemetry message
+void readMessage() {
+  int length;
+  switch(reader.getType()) {
+    case TELEMETRY_TEXT:
+      length = reader.getLength();
+      if(length > TELEMETRY_MAX_LINE) length = TELEMETRY_MAX_LINE;
+      for(int i = 0; i < length; i++) {
+        textLine[i] = reader.get8(i);
+      }
+      textLine[length] = 0;
+      textTime = millis();
+      break;
+    case TELEMETRY_DISTANCE:
+      distance = reader.get16(4);
+      radar.plot(eyeAngle,distance,isRadarShown);
+      break;
+    case TELEMETRY_POINT:
+      radar.plot(reader.get8(4),reader.get16(5),isRadarShown);
+      break;
+    case TELEMETRY_SCAN:
+      // Keep the nearest point of the sweep
+      scanDistance = -1;
+      for(int i = 0; i < reader.get8(9); i++) {
+        int pointDistance = reader.get16(11 + 3 * i);
+        if(pointDistance >= 0 && (scanDistance < 0 || pointDistance < scanDistance)) {
+          scanDistance = pointDistance;
+          scanAngle = reader.get8(10 + 3 * i);
+        }
+        // Points come one at a time as well, the whole sweep puts back any that were dropped
+        radar.plot(reader.get8(10 + 3 * i),pointDistance,isRadarShown);
+      }
+      break;
+    case TELEMETRY_ACTUATORS:
+      speed = (int8_t)reader.get8(4);
+      steeringAngle = reader.get8(5);
+      eyeAngle = reader.get8(6);
+      break;
+    case TELEMETRY_STATUS:
+      controlPeriod = reader.get32(4);
+      carDropped = reader.get32(8);
+      break;
+    default:
+      return;
+  }
+  isChanged = true;
+}
+
+// Prints a distance in tenths of an inch
+void printDistance(int tenths) {
+  if(tenths < 0) {
+    oled.print("--");
+    return;
+  }
+  oled.print(tenths / 10);
+  oled.print(".");
+  oled.print(tenths % 10);
+}
+
+// Draws the telemetry screen
+void drawTelemetry() {
+  oled.clearDisplay();
+  oled.setCursor(0,0);
+  oled.setTextSize(1);
+  oled.setTextColor(WHITE);
+  oled.print("Dist ");
+  printDistance(distance);
+  oled.println(" in");
+  oled.print("Near ");
+  printDistance(scanDistance);
+  oled.print(" @ ");
+  oled.println(scanAngle);
+  oled.print("Spd ");
+  oled.print(speed);
+  oled.print("% St ");
+  oled.print(steeringAngle);
+  oled.print(" Eye ");
+  oled.println(eyeAngle);
+  // Text lines replace the status for a while
+  if(textTime != 0 && millis() - textTime < TEXT_HOLD_MILLIS) {
+    oled.println(textLine);
+  }
+  else {
+    // Loop period, drops (car/display), display frames per second and bytes per frame
+    oled.print(controlPeriod);
+    oled.print("us D");
+    oled.print(carDropped);
+    oled.print("/");
+    oled.print(reader.getDroppedCount() + reader.getBadCount());
+    oled.print(" ");
+    oled.print(oled.getFrameRate());
+    oled.print("f ");
+    oled.print(oled.getBytesPerFrame());
+    oled.println("B");
+  }
+}
+
 void setup() {
   Serial.begin(115200);
-  Serial.setTimeout(50);
   while(!oled.begin(SSD1306_SWITCHCAPVCC, 0x3C)) { // Address 0x3C for 128x32
     Serial.println(F("SSD1306 allocation failed"));
   }
@@ -82,6 +208,13 @@ void setup() {
 }
 
 void loop() {
+  // Always keep up with the input, even while the car is shown
+  reader.poll(Serial);
+  while(reader.available()) {
+    readMessage();
+    reader.pop();
+  }
+
   key = getKey(analogRead(button));
   if(key != last || longPress) {
     if(key != last) {
@@ -115,6 +248,9 @@ void loop() {
       ypos = 0;
       dx = 0;
       dy = 0;
+      isRadar = !isRadar;
+      isRadarShown = false;
+      isChanged = true;
       break;
       default:
       pressCounter = 0;
@@ -152,14 +288,29 @@ void loop() {
      if(ypos > 32) ypos = -32;
      oled.clearDisplay();
     oled.drawBitmap(xpos,ypos, car_bmp, 64, 32, 1);
+    oled.display();
+    isRadarShown = false;
+  }
+  else if(isRadar) {
+    // Points are plotted as they arrive, the whole plot is only drawn when it is first shown
+    if(!isRadarShown) {
+      radar.draw();
+      isRadarShown = true;
+      isChanged = true;
+    }
+    if(isChanged && millis() - lastRedraw >= REDRAW_PERIOD_MILLIS) {
+      oled.display();
+      isChanged = false;
+      lastRedraw = millis();
+    }
   }
   else {
-    if(Serial.available()) oled.clearDisplay();
-    oled.setCursor(0,0);
-    oled.setTextSize(1);
-    while(Serial.available()) { 
-      oled.println(Serial.readString());
+    // Only redraw for new values, and not faster than the display can be written
+    if(isChanged && millis() - lastRedraw >= REDRAW_PERIOD_MILLIS) {
+      drawTelemetry();
+      oled.display();
+      isChanged = false;
+      lastRedraw = millis();
     }
   }
-  oled.display();
 }
@@ -0,0 +1,203 @@
+/* PartialDisplay class
+ * 18 October 2026
+ * 
+ * Adafruit_SSD1306 that only sends the parts of the screen that changed. Every pixel drawn
+ * through the Adafruit_GFX functions (text, bitmaps, lines, rectangles) marks the columns it
+ * touches on its SSD1306 page (8 rows), and display() sends just those column ranges over I2C
+ * instead of the whole framebuffer.
+ * 
+ * clearDisplay() marks everything drawn since the last clear, so the usual clear and redraw
+ * sends the old and new drawing but not the blank parts of the screen. Only rotation 0 is
+ * tracked.
+ * 
+ * The I2C clock can be raised with setClock(), and the frames per second and bytes per frame
+ * achieved are measured over each second.
+ */ 
+
+#ifndef PARTIALDISPLAY_H
+#define PARTIALDISPLAY_H
+
+ const int DISPLAY_MAX_PAGES = 8; // 64 rows
+ const int DISPLAY_WIRE_CHUNK = 31; // Data bytes per I2C transmission, AVR Wire buffers 32 bytes
+ const unsigned long DISPLAY_I2C_CLOCK = 400000; // Fast mode, the SSD1306 is rated for 400 kHz
+ const unsigned long DISPLAY_STATS_MILLIS = 1000;
+
+ class PartialDisplay : public Adafruit_SSD1306 {
+  private:
+    TwoWire* i2c;
+    uint8_t address;
+    int pages;
+    // Column ranges of each page, a page is clean when start > end
+    uint8_t dirtyStart[DISPLAY_MAX_PAGES]; // Changed since the last display()
+    uint8_t dirtyEnd[DISPLAY_MAX_PAGES];
+    uint8_t drawnStart[DISPLAY_MAX_PAGES]; // Drawn on since the last clearDisplay()
+    uint8_t drawnEnd[DISPLAY_MAX_PAGES];
+    unsigned long frameCount;
+    unsigned long byteCount;
+    unsigned long statsTime;
+    unsigned int frameRate;
+    unsigned int bytesPerFrame;
+    void markDirty(int x,int page);
+    void markAll();
+    void sendCommands(const uint8_t* commands,int count);
+    void sendPage(int page);
+  public:
+    PartialDisplay(int width,int height,TwoWire* i2c,int resetPin);
+    bool begin(uint8_t switchVcc,uint8_t address);
+    void setClock(unsigned long clock);
+    void drawPixel(int16_t x,int16_t y,uint16_t color);
+    void drawFastHLine(int16_t x,int16_t y,int16_t w,uint16_t color);
+    void drawFastVLine(int16_t x,int16_t y,int16_t h,uint16_t color);
+    void clearDisplay();
+    void display();
+    unsigned int getFrameRate();
+    unsigned int getBytesPerFrame();
+ };
+
+ // Constructor, the Adafruit library is given the same clock so its own transfers keep it
+ PartialDisplay::PartialDisplay(int width,int height,TwoWire* i2c,int resetPin)
+    : Adafruit_SSD1306(width,height,i2c,resetPin,DISPLAY_I2C_CLOCK,DISPLAY_I2C_CLOCK) {
+  this->i2c = i2c;
+  address = 0x3C;
+  pages = height / 8;
+  if(pages > DISPLAY_MAX_PAGES) pages = DISPLAY_MAX_PAGES;
+  frameCount = 0;
+  byteCount = 0;
+  statsTime = 0;
+  frameRate = 0;
+  bytesPerFrame = 0;
+  for(int i = 0; i < DISPLAY_MAX_PAGES; i++) {
+    drawnStart[i] = 255;
+    drawnEnd[i] = 0;
+  }
+  markAll();
+ }
+
+ // Starts the display, the first display() sends the whole screen
+ bool PartialDisplay::begin(uint8_t switchVcc,uint8_t address) {
+  this->address = address;
+  if(!Adafruit_SSD1306::begin(switchVcc,address)) return false;
+  setClock(DISPLAY_I2C_CLOCK);
+  markAll();
+  statsTime = millis();
+  return true;
+ }
+
+ void PartialDisplay::setClock(unsigned long clock) {
+  i2c->setClock(clock);
+ }
+
+ void PartialDisplay::drawPixel(int16_t x,int16_t y,uint16_t color) {
+  Adafruit_SSD1306::drawPixel(x,y,color);
+  if(x < 0 || x >= width() || y < 0 || y >= height()) return;
+  markDirty(x,y / 8);
+ }
+
+ void PartialDisplay::drawFastHLine(int16_t x,int16_t y,int16_t w,uint16_t color) {
+  Adafruit_SSD1306::drawFastHLine(x,y,w,color);
+  if(w <= 0 || y < 0 || y >= height()) return;
+  int start = x < 0 ? 0 : x;
+  int end = x + w - 1 >= width() ? width() - 1 : x + w - 1;
+  if(start > end) return;
+  markDirty(start,y / 8);
+  markDirty(end,y / 8);
+ }
+
+ void PartialDisplay::drawFastVLine(int16_t x,int16_t y,int16_t h,uint16_t color) {
+  Adafruit_SSD1306::drawFastVLine(x,y,h,color);
+  if(h <= 0 || x < 0 || x >= width()) return;
+  int start = y < 0 ? 0 : y;
+  int end = y + h - 1 >= height() ? height() - 1 : y + h - 1;
+  for(int page = start / 8; page <= end / 8; page++) {
+    markDirty(x,page);
+  }
+ }
+
+ // Clears the framebuffer, only what was drawn since the last clear needs to be sent
+ void PartialDisplay::clearDisplay() {
+  Adafruit_SSD1306::clearDisplay();
+  for(int i = 0; i < pages; i++) {
+    if(drawnStart[i] < dirtyStart[i]) dirtyStart[i] = drawnStart[i];
+    if(drawnEnd[i] > dirtyEnd[i]) dirtyEnd[i] = drawnEnd[i];
+    drawnStart[i] = 255;
+    drawnEnd[i] = 0;
+  }
+ }
+
+ void PartialDisplay::markDirty(int x,int page) {
+  if(x < dirtyStart[page]) dirtyStart[page] = x;
+  if(x > dirtyEnd[page]) dirtyEnd[page] = x;
+  if(x < drawnStart[page]) drawnStart[page] = x;
+  if(x > drawnEnd[page]) drawnEnd[page] = x;
+ }
+
+ // Marks the whole screen as changed
+ void PartialDisplay::markAll() {
+  for(int i = 0; i < DISPLAY_MAX_PAGES; i++) {
+    dirtyStart[i] = 0;
+    dirtyEnd[i] = width() - 1;
+  }
+ }
+
+ // Sends the changed columns of each page, replaces Adafruit_SSD1306::display()
+ void PartialDisplay::display() {
+  for(int i = 0; i < pages; i++) {
+    if(dirtyStart[i] > dirtyEnd[i]) continue;
+    sendPage(i);
+    dirtyStart[i] = 255;
+    dirtyEnd[i] = 0;
+  }
+  frameCount++;
+
+  // Measure the frame rate and size over each second
+  unsigned long currentTime = millis();
+  if(currentTime - statsTime >= DISPLAY_STATS_MILLIS) {
+    frameRate = frameCount * 1000UL / (currentTime - statsTime);
+    bytesPerFrame = byteCount / frameCount;
+    frameCount = 0;
+    byteCount = 0;
+    statsTime = currentTime;
+  }
+ }
+
+ // Sets the SSD1306 address window to the changed columns of a page and sends them
+ void PartialDisplay::sendPage(int page) {
+  uint8_t* buffer = getBuffer() + page * width();
+  int column = dirtyStart[page];
+  int end = dirtyEnd[page];
+  uint8_t commands[] = {
+    SSD1306_COLUMNADDR, (uint8_t)column, (uint8_t)end,
+    SSD1306_PAGEADDR, (uint8_t)page, (uint8_t)page
+  };
+  sendCommands(commands,sizeof(commands));
+
+  while(column <= end) {
+    int count = end - column + 1;
+    if(count > DISPLAY_WIRE_CHUNK) count = DISPLAY_WIRE_CHUNK;
+    i2c->beginTransmission(address);
+    i2c->write((uint8_t)0x40); // Data follows
+    i2c->write(buffer + column,count);
+    i2c->endTransmission();
+    column += count;
+    byteCount += count + 1;
+  }
+ }
+
+ void PartialDisplay::sendCommands(const uint8_t* commands,int count) {
+  i2c->beginTransmission(address);
+  i2c->write((uint8_t)0x00); // Commands follow
+  i2c->write(commands,count);
+  i2c->endTransmission();
+  byteCount += count + 1;
+ }
+
+ // Frames sent per second, measured over the last second
+ unsigned int PartialDisplay::getFrameRate() {
+  return frameRate;
+ }
+
+ // Average bytes sent per frame over the last second, including I2C control bytes
+ unsigned int PartialDisplay::getBytesPerFrame() {
+  return bytesPerFrame;
+ }
+#endif
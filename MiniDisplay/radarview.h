@@ -0,0 +1,135 @@
+/* RadarView class
+ * 18 October 2026
+ * 
+ * Plots the eye's readings round the car as they arrive, like a radar screen. The car sits at
+ * the middle of the bottom row, 90 degrees is straight up and RADAR_RANGE is RADAR_RADIUS
+ * pixels away. Each reading is a 2x2 dot at its angle and distance.
+ * 
+ * The angles are looked up in sine and cosine tables kept in flash (Q7 fixed point, one entry
+ * per degree), so plotting a point takes two table reads and a few integer multiplies and divides, with
+ * no floating point on the AVR.
+ * 
+ * The screen holds the last point of each RADAR_BIN_DEGREES wide bin. A new reading rubs out
+ * the old dot in its bin and draws its own, touching a few columns of the framebuffer, so
+ * PartialDisplay only sends those columns instead of redrawing the whole plot each sweep.
+ */ 
+
+#ifndef RADARVIEW_H
+#define RADARVIEW_H
+
+ const int RADAR_MIN_ANGLE = 25; // EYE_SERVO_MIN_ANGLE in ARC's config.h
+ const int RADAR_MAX_ANGLE = 155; // EYE_SERVO_MAX_ANGLE in ARC's config.h
+ const int RADAR_RANGE = 600; // Distance at the edge of the plot, tenths of an inch
+ const int RADAR_RADIUS = 30; // Pixels
+ const int RADAR_CENTER_X = 64;
+ const int RADAR_CENTER_Y = 31;
+ const int RADAR_BIN_DEGREES = 5;
+ const int RADAR_BINS = (RADAR_MAX_ANGLE - RADAR_MIN_ANGLE) / RADAR_BIN_DEGREES + 1;
+ const uint8_t RADAR_NO_POINT = 255;
+
+ // 127 * sin and cos of RADAR_MIN_ANGLE to RADAR_MAX_ANGLE
+ static const int8_t PROGMEM RADAR_SIN[RADAR_MAX_ANGLE - RADAR_MIN_ANGLE + 1] = {
+  54, 56, 58, 60, 62, 63, 65, 67, 69, 71, 73, 75, 76, 78, 80, 82,
+  83, 85, 87, 88, 90, 91, 93, 94, 96, 97, 99, 100, 101, 103, 104, 105,
+  107, 108, 109, 110, 111, 112, 113, 114, 115, 116, 117, 118, 119, 119, 120, 121,
+  121, 122, 123, 123, 124, 124, 125, 125, 125, 126, 126, 126, 127, 127, 127, 127,
+  127, 127, 127, 127, 127, 127, 127, 126, 126, 126, 125, 125, 125, 124, 124, 123,
+  123, 122, 121, 121, 120, 119, 119, 118, 117, 116, 115, 114, 113, 112, 111, 110,
+  109, 108, 107, 105, 104, 103, 101, 100, 99, 97, 96, 94, 93, 91, 90, 88,
+  87, 85, 83, 82, 80, 78, 76, 75, 73, 71, 69, 67, 65, 63, 62, 60,
+  58, 56, 54
+ };
+
+ static const int8_t PROGMEM RADAR_COS[RADAR_MAX_ANGLE - RADAR_MIN_ANGLE + 1] = {
+  115, 114, 113, 112, 111, 110, 109, 108, 107, 105, 104, 103, 101, 100, 99, 97,
+  96, 94, 93, 91, 90, 88, 87, 85, 83, 82, 80, 78, 76, 75, 73, 71,
+  69, 67, 65, 64, 62, 60, 58, 56, 54, 52, 50, 48, 46, 43, 41, 39,
+  37, 35, 33, 31, 29, 26, 24, 22, 20, 18, 15, 13, 11, 9, 7, 4,
+  2, 0, -2, -4, -7, -9, -11, -13, -15, -18, -20, -22, -24, -26, -29, -31,
+  -33, -35, -37, -39, -41, -43, -46, -48, -50, -52, -54, -56, -58, -60, -62, -63,
+  -65, -67, -69, -71, -73, -75, -76, -78, -80, -82, -83, -85, -87, -88, -90, -91,
+  -93, -94, -96, -97, -99, -100, -101, -103, -104, -105, -107, -108, -109, -110, -111, -112,
+  -113, -114, -115
+ };
+
+ class RadarView {
+  private:
+    PartialDisplay* screen;
+    uint8_t pointX[RADAR_BINS]; // Dot of each bin, RADAR_NO_POINT if there is none
+    uint8_t pointY[RADAR_BINS];
+    void drawPoint(int bin,uint16_t color);
+    void drawCar();
+  public:
+    RadarView(PartialDisplay* screen);
+    void clear();
+    void draw();
+    void plot(int angle,int tenths,bool isShown);
+ };
+
+ // Constructor
+ RadarView::RadarView(PartialDisplay* screen) {
+  this->screen = screen;
+  clear();
+ }
+
+ // Forgets all of the points
+ void RadarView::clear() {
+  for(int i = 0; i < RADAR_BINS; i++) {
+    pointX[i] = RADAR_NO_POINT;
+    pointY[i] = RADAR_NO_POINT;
+  }
+ }
+
+ // Draws the whole plot, for when the radar is first shown
+ void RadarView::draw() {
+  screen->clearDisplay();
+  screen->setCursor(0,0);
+  screen->setTextSize(1);
+  screen->setTextColor(WHITE);
+  screen->print("Radar");
+  screen->setCursor(104,0);
+  screen->print(RADAR_RANGE / 10);
+  screen->print("in");
+  for(int i = 0; i < RADAR_BINS; i++) drawPoint(i,WHITE);
+  drawCar();
+ }
+
+ /* Moves the dot of the bin angle is in to a new reading (tenths of an inch, -1 if nothing
+  * was in range). Only the point is stored unless isShown is true, so the plot is up to date
+  * when the radar is next shown.
+  */
+ void RadarView::plot(int angle,int tenths,bool isShown) {
+  if(angle < RADAR_MIN_ANGLE || angle > RADAR_MAX_ANGLE) return;
+  int bin = (angle - RADAR_MIN_ANGLE + RADAR_BIN_DEGREES / 2) / RADAR_BIN_DEGREES;
+  if(bin >= RADAR_BINS) bin = RADAR_BINS - 1;
+  if(isShown) drawPoint(bin,BLACK);
+  if(tenths < 0 || tenths > RADAR_RANGE) {
+    pointX[bin] = RADAR_NO_POINT;
+    pointY[bin] = RADAR_NO_POINT;
+  }
+  else {
+    int radius = (long)tenths * RADAR_RADIUS / RADAR_RANGE;
+    int index = angle - RADAR_MIN_ANGLE;
+    pointX[bin] = RADAR_CENTER_X + radius * (int8_t)pgm_read_byte(&RADAR_COS[index]) / 127;
+    pointY[bin] = RADAR_CENTER_Y - radius * (int8_t)pgm_read_byte(&RADAR_SIN[index]) / 127;
+  }
+  if(!isShown) return;
+  // Rubbing out the old dot can clip the dots next to it or the car, so they are drawn again
+  if(bin > 0) drawPoint(bin - 1,WHITE);
+  drawPoint(bin,WHITE);
+  if(bin < RADAR_BINS - 1) drawPoint(bin + 1,WHITE);
+  drawCar();
+ }
+
+ void RadarView::drawPoint(int bin,uint16_t color) {
+  if(pointX[bin] == RADAR_NO_POINT) return;
+  screen->fillRect(pointX[bin],pointY[bin] - 1,2,2,color);
+ }
+
+ // Small triangle where the car is
+ void RadarView::drawCar() {
+  screen->drawFastHLine(RADAR_CENTER_X - 2,RADAR_CENTER_Y,5,WHITE);
+  screen->drawFastHLine(RADAR_CENTER_X - 1,RADAR_CENTER_Y - 1,3,WHITE);
+  screen->drawPixel(RADAR_CENTER_X,RADAR_CENTER_Y - 2,WHITE);
+ }
+#endif
@@ -0,0 +1,264 @@
+/* TelemetryReader class
+ * 18 October 2026
+ * 
+ * Reads the telemetry frames sent by ARC (see telemetry.h in ARC) and plain text lines from
+ * Serial without blocking and without using the heap. poll() takes whatever bytes have arrived,
+ * up to TELEMETRY_MAX_READ per call, so the display loop never waits for input.
+ * 
+ * Complete messages are stored in a fixed ring buffer as [type][length][payload] and are read
+ * in place with getType(), getLength() and the get functions, then removed with pop(). Payloads
+ * are written straight into the ring buffer as they arrive and only kept if the CRC matches, so
+ * there is no second copy of a frame. When the display falls behind and the ring buffer is full,
+ * new messages are dropped and counted.
+ * 
+ * The frame format and message types must match telemetry.h in ARC.
+ */ 
+
+#ifndef TELEMETRYREADER_H
+#define TELEMETRYREADER_H
+
+ const uint8_t TELEMETRY_SYNC = 0xA5;
+ const int TELEMETRY_MAX_PAYLOAD = 120;
+ const int TELEMETRY_QUEUE_SIZE = 160; // Bytes of messages waiting for the display
+ const int TELEMETRY_MAX_READ = 64; // Most bytes taken from Serial by one poll()
+ const int TELEMETRY_MAX_LINE = 21; // Characters kept from a text line (one line of the display)
+
+ // Message types, the same as in telemetry.h
+ enum TelemetryType {
+  TELEMETRY_TEXT = 1,
+  TELEMETRY_DISTANCE,
+  TELEMETRY_SCAN,
+  TELEMETRY_CONTROLLER,
+  TELEMETRY_ACTUATORS,
+  TELEMETRY_STATUS,
+  TELEMETRY_COMMAND,
+  TELEMETRY_POINT
+ };
+
+ enum TelemetryReadState {
+  READ_SYNC,      // Waiting for a frame, collecting text lines
+  READ_TYPE,
+  READ_LENGTH,
+  READ_PAYLOAD,
+  READ_CRC_LOW,
+  READ_CRC_HIGH
+ };
+
+ class TelemetryReader {
+  private:
+    uint8_t queue[TELEMETRY_QUEUE_SIZE];
+    int head; // First byte of the oldest message
+    int count; // Bytes of complete messages
+    int pendingLength; // Bytes of the message being received, stored after the complete ones
+    bool isPendingDropped; // The message being received did not fit
+    bool isLinePending; // A text line is being received
+    TelemetryReadState state;
+    uint8_t frameLength;
+    uint8_t payloadIndex;
+    uint16_t crc;
+    uint16_t frameCrc;
+    unsigned long messageCount;
+    unsigned long droppedCount;
+    unsigned long badCount;
+    void parse(uint8_t value);
+    void updateCrc(uint8_t value);
+    void startPending(uint8_t type);
+    void putPending(uint8_t value);
+    void commitPending();
+  public:
+    TelemetryReader();
+    void poll(Stream& input);
+    bool available();
+    uint8_t getType();
+    uint8_t getLength();
+    uint8_t get8(int index);
+    int16_t get16(int index);
+    uint32_t get32(int index);
+    void pop();
+    unsigned long getMessageCount();
+    unsigned long getDroppedCount();
+    unsigned long getBadCount();
+ };
+
+ // Constructor
+ TelemetryReader::TelemetryReader() {
+  head = 0;
+  count = 0;
+  pendingLength = 0;
+  isPendingDropped = false;
+  isLinePending = false;
+  state = READ_SYNC;
+  messageCount = 0;
+  droppedCount = 0;
+  badCount = 0;
+ }
+
+ // Takes the bytes that have arrived, never waits for more
+ void TelemetryReader::poll(Stream& input) {
+  int budget = TELEMETRY_MAX_READ;
+  while(budget > 0 && input.available()) {
+    parse(input.read());
+    budget--;
+  }
+ }
+
+ void TelemetryReader::parse(uint8_t value) {
+  switch(state) {
+    case READ_SYNC:
+      if(value == TELEMETRY_SYNC) {
+        // A frame in the middle of a line ends the line
+        if(isLinePending) commitPending();
+        isLinePending = false;
+        crc = 0xFFFF;
+        state = READ_TYPE;
+      }
+      else if(value == '\n') {
+        if(isLinePending) commitPending();
+        isLinePending = false;
+      }
+      else if(value >= ' ' && value < 0x7F) {
+        if(!isLinePending) {
+          startPending(TELEMETRY_TEXT);
+          isLinePending = true;
+        }
+        if(pendingLength - 2 < TELEMETRY_MAX_LINE) putPending(value);
+      }
+      break;
+    case READ_TYPE:
+      updateCrc(value);
+      startPending(value);
+      state = READ_LENGTH;
+      break;
+    case READ_LENGTH:
+      updateCrc(value);
+      if(value > TELEMETRY_MAX_PAYLOAD) {
+        // Not a real frame, wait for the next sync byte
+        badCount++;
+        state = READ_SYNC;
+        break;
+      }
+      frameLength = value;
+      payloadIndex = 0;
+      state = frameLength > 0 ? READ_PAYLOAD : READ_CRC_LOW;
+      break;
+    case READ_PAYLOAD:
+      updateCrc(value);
+      putPending(value);
+      payloadIndex++;
+      if(payloadIndex == frameLength) state = READ_CRC_LOW;
+      break;
+    case READ_CRC_LOW:
+      frameCrc = value;
+      state = READ_CRC_HIGH;
+      break;
+    case READ_CRC_HIGH:
+      frameCrc |= (uint16_t)value << 8;
+      if(frameCrc == crc) {
+        commitPending();
+      }
+      else {
+        badCount++;
+      }
+      state = READ_SYNC;
+      break;
+  }
+ }
+
+ // CRC-16/CCITT, the same as telemetry.h
+ void TelemetryReader::updateCrc(uint8_t value) {
+  crc ^= (uint16_t)value << 8;
+  for(int i = 0; i < 8; i++) {
+    if(crc & 0x8000) crc = (crc << 1) ^ 0x1021;
+    else crc = crc << 1;
+  }
+ }
+
+ // Starts a message after the complete ones, the length is filled in by commitPending()
+ void TelemetryReader::startPending(uint8_t type) {
+  pendingLength = 0;
+  isPendingDropped = false;
+  putPending(type);
+  putPending(0);
+ }
+
+ void TelemetryReader::putPending(uint8_t value) {
+  if(count + pendingLength >= TELEMETRY_QUEUE_SIZE) {
+    isPendingDropped = true;
+    return;
+  }
+  int index = head + count + pendingLength;
+  if(index >= TELEMETRY_QUEUE_SIZE) index -= TELEMETRY_QUEUE_SIZE;
+  queue[index] = value;
+  pendingLength++;
+ }
+
+ // Keeps the message being received, unless it did not fit
+ void TelemetryReader::commitPending() {
+  if(isPendingDropped) {
+    droppedCount++;
+  }
+  else {
+    int index = head + count + 1;
+    if(index >= TELEMETRY_QUEUE_SIZE) index -= TELEMETRY_QUEUE_SIZE;
+    queue[index] = pendingLength - 2;
+    count += pendingLength;
+    messageCount++;
+  }
+  pendingLength = 0;
+ }
+
+ // Returns true if there is a complete message to read
+ bool TelemetryReader::available() {
+  return count > 0;
+ }
+
+ // Returns the type of the oldest message
+ uint8_t TelemetryReader::getType() {
+  return queue[head];
+ }
+
+ // Returns the payload length of the oldest message
+ uint8_t TelemetryReader::getLength() {
+  int index = head + 1;
+  if(index >= TELEMETRY_QUEUE_SIZE) index -= TELEMETRY_QUEUE_SIZE;
+  return queue[index];
+ }
+
+ // Returns a byte of the oldest message's payload
+ uint8_t TelemetryReader::get8(int index) {
+  index += head + 2;
+  if(index >= TELEMETRY_QUEUE_SIZE) index -= TELEMETRY_QUEUE_SIZE;
+  return queue[index];
+ }
+
+ // Multi byte values are little endian
+ int16_t TelemetryReader::get16(int index) {
+  return (int16_t)(get8(index) | ((uint16_t)get8(index + 1) << 8));
+ }
+
+ uint32_t TelemetryReader::get32(int index) {
+  return (uint32_t)(uint16_t)get16(index) | ((uint32_t)(uint16_t)get16(index + 2) << 16);
+ }
+
+ // Removes the oldest message
+ void TelemetryReader::pop() {
+  int size = getLength() + 2;
+  head += size;
+  if(head >= TELEMETRY_QUEUE_SIZE) head -= TELEMETRY_QUEUE_SIZE;
+  count -= size;
+ }
+
+ unsigned long TelemetryReader::getMessageCount() {
+  return messageCount;
+ }
+
+ // Messages lost because the display fell behind
+ unsigned long TelemetryReader::getDroppedCount() {
+  return droppedCount;
+ }
+
+ // Frames lost to a bad CRC or length
+ unsigned long TelemetryReader::getBadCount() {
+  return badCount;
+ }
+#endif
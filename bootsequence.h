@@ -0,0 +1,99 @@
+/* BootSequence class
+ * 18 October 2026
+ *
+ * Times the stages setup() brings the car up in, and the first pass of the control loop. The
+ * stages run in a fixed order: the outputs are put in a safe state first (motor braked,
+ * controller and trigger lines low), then Serial, the servo PWM signals, the sensors, the
+ * controller and the background tasks. The constructors of the classes only store their
+ * settings, so nothing is written to the hardware before setup() gets to it.
+ *
+ * Times are from halMicros(), which counts from power up on the ESP32. report() prints the
+ * time each stage took and the time from power up to the first control tick, which is when
+ * the car first answers the controller.
+ */
+
+#ifndef BOOTSEQUENCE_H
+#define BOOTSEQUENCE_H
+
+#include "hal.h"
+
+ // Stages of setup(), in the order they run
+ enum BootStage {
+  BOOT_SAFE,       // Motor braked, output lines low
+  BOOT_SERIAL,     // Serial started
+  BOOT_SERVOS,     // Steering and eye PWM started at their home angles
+  BOOT_SENSORS,    // Range sensors set up
+  BOOT_CONTROLLER, // First controller read
+  BOOT_TASKS,      // Sensing task, motion timer and flash log started
+  BOOT_STAGE_COUNT
+ };
+
+ const char* const BOOT_STAGE_NAMES[BOOT_STAGE_COUNT] = {
+  "safe","serial","servos","sensors","controller","tasks"
+ };
+
+ class BootSequence {
+  private:
+    unsigned long startTime; // Start of setup() (micros)
+    unsigned long endTimes[BOOT_STAGE_COUNT]; // End of each stage, 0 if it has not ended
+    unsigned long firstTickTime; // End of the first control tick, 0 until then
+  public:
+    BootSequence();
+    void begin();
+    void endStage(BootStage stage);
+    bool endFirstTick();
+    unsigned long getStageMicros(BootStage stage);
+    unsigned long getFirstTickTime();
+    template <typename Output> void report(Output& output);
+ };
+
+ // Constructor
+ BootSequence::BootSequence() {
+  startTime = 0;
+  for(int i = 0; i < BOOT_STAGE_COUNT; i++) endTimes[i] = 0;
+  firstTickTime = 0;
+ }
+
+ // Called first thing in setup()
+ void BootSequence::begin() {
+  startTime = halMicros();
+ }
+
+ // Called as each stage ends
+ void BootSequence::endStage(BootStage stage) {
+  endTimes[stage] = halMicros();
+ }
+
+ // Called at the end of every control tick, returns true for the first one
+ bool BootSequence::endFirstTick() {
+  if(firstTickTime != 0) return false;
+  firstTickTime = halMicros();
+  return true;
+ }
+
+ // Returns the time a stage took (micros), from the end of the stage before it
+ unsigned long BootSequence::getStageMicros(BootStage stage) {
+  unsigned long stageStart = stage == 0 ? startTime : endTimes[stage - 1];
+  return endTimes[stage] - stageStart;
+ }
+
+ // Returns the time from power up to the end of the first control tick (micros), 0 until then
+ unsigned long BootSequence::getFirstTickTime() {
+  return firstTickTime;
+ }
+
+ // Prints one line per stage with its time, then the time before setup() and to the first tick
+ template <typename Output>
+ void BootSequence::report(Output& output) {
+  output.println("#boot us");
+  output.print("start ");
+  output.println(startTime);
+  for(int i = 0; i < BOOT_STAGE_COUNT; i++) {
+    output.print(BOOT_STAGE_NAMES[i]);
+    output.print(" ");
+    output.println(getStageMicros((BootStage)i));
+  }
+  output.print("first tick ");
+  output.println(firstTickTime);
+ }
+#endif
@@ -0,0 +1,336 @@
+/* CommandLink class
+ * 18 October 2026
+ *
+ * Takes commands for the car from a phone or PC over any Stream: Serial today, a Bluetooth or
+ * WiFi stream later. Commands use the telemetry framing (see telemetry.h): sync byte, type,
+ * length, payload and CRC, so the other end can use the same code to send commands and read
+ * the telemetry. update() only reads bytes that have already arrived, at most
+ * COMMAND_LINK_MAX_BYTES per call, and a frame cut off part way is finished on the next call,
+ * so the link never holds up the loop.
+ *
+ * A setpoint or waypoint is followed until its time to live runs out (COMMAND_MAX_TTL_MILLIS
+ * at most), then the car stops until a new one arrives, so a dropped link cannot leave the
+ * car driving. Each one replaces the one before it. Once the loop has acted on a command,
+ * acknowledge() gives the time from the frame being read to the targets being set, which
+ * the loop sends back as a COMMAND telemetry frame.
+ *
+ * The request characters ('p', 'r', 's') outside a frame are kept as one character requests,
+ * so a terminal can still ask for the profile over the same port. Other bytes outside a frame,
+ * such as the line ending a terminal sends after the character, are skipped.
+ *
+ * Payloads (multi byte values are little endian):
+ *   SETPOINT  u16 time to live (millis), i8 speed (percent, negative is reverse),
+ *             u8 steering angle, u8 eye angle, u8 flags (bit 0 = sweep)
+ *   MODE      u8 mode (CommandMode)
+ *   WAYPOINT  u16 time to live (millis), u8 heading (eye angle, 90 is straight ahead),
+ *             u8 speed (percent, the most the obstacle map may choose)
+ */
+
+#ifndef COMMANDLINK_H
+#define COMMANDLINK_H
+
+#include "config.h"
+#include "hal.h"
+#include "telemetry.h"
+
+ const int COMMAND_MAX_PAYLOAD = 16;
+
+ enum CommandType {
+  COMMAND_SETPOINT = 1,
+  COMMAND_MODE,
+  COMMAND_WAYPOINT,
+  COMMAND_TYPE_COUNT
+ };
+
+ enum CommandMode {
+  COMMAND_MODE_CONTROLLER, // Driven with the NES controller
+  COMMAND_MODE_AUTONOMOUS, // Steered by the obstacle map
+  COMMAND_MODE_REMOTE      // Driven by setpoints and waypoints from the link
+ };
+
+ // Part of a frame the parser expects next
+ enum CommandParseState {
+  PARSE_SYNC,
+  PARSE_TYPE,
+  PARSE_LENGTH,
+  PARSE_PAYLOAD,
+  PARSE_CRC_LOW,
+  PARSE_CRC_HIGH
+ };
+
+ // A setpoint or waypoint, in the units ControllerAction::respond() gives its targets in
+ struct RemoteCommand {
+  int type; // COMMAND_SETPOINT or COMMAND_WAYPOINT
+  float speed; // -1 to 1, for a waypoint the most the obstacle map may choose
+  int steeringAngle; // Setpoint only
+  int eyeAngle; // Setpoint only
+  bool isSweeping; // Setpoint only, the obstacle map needs the eye to sweep for a waypoint
+  int heading; // Waypoint only, eye angle to head for
+  unsigned long readTime; // Time the frame was read (micros)
+  unsigned long startTime; // Time the frame was read (millis), for the time to live
+  unsigned long timeToLive; // Millis
+ };
+
+ // Builds a command frame from its payload, for the sending end. Returns the size of the frame
+ inline int encodeCommand(int type,const uint8_t* payload,int length,uint8_t* frame) {
+  uint16_t crc = 0xFFFF;
+  frame[0] = TELEMETRY_SYNC;
+  frame[1] = type;
+  frame[2] = length;
+  for(int i = 0; i < length; i++) frame[3 + i] = payload[i];
+  for(int i = 1; i < 3 + length; i++) crc = telemetryCrc(crc,frame[i]);
+  frame[3 + length] = crc & 0xFF;
+  frame[4 + length] = crc >> 8;
+  return length + TELEMETRY_FRAME_OVERHEAD;
+ }
+
+ class CommandLink {
+  private:
+    Stream* input;
+    CommandParseState state;
+    uint8_t type;
+    uint8_t length;
+    uint8_t payload[COMMAND_MAX_PAYLOAD];
+    int index;
+    uint16_t crc; // Worked out as the frame is read
+    uint16_t frameCrc; // Sent at the end of the frame
+    RemoteCommand command; // Latest setpoint or waypoint
+    bool hasCommand;
+    bool isCommandTaken; // True once getCommand() has handed out the latest command
+    bool isExpired;
+    int mode; // Mode waiting for getMode(), -1 if none
+    unsigned long modeTime; // Time the mode frame was read (micros)
+    bool isPending[COMMAND_TYPE_COUNT]; // Commands taken by the loop and not yet acknowledged
+    unsigned long pendingTimes[COMMAND_TYPE_COUNT];
+    int request; // Last request character outside a frame, -1 if none
+    unsigned long framesReceived;
+    unsigned long framesBad;
+    unsigned long commandsExpired;
+    unsigned long maxLatency;
+    bool parse(uint8_t value);
+    bool decode();
+    bool accept(RemoteCommand& received);
+    static int clamp(int value,int minValue,int maxValue);
+  public:
+    CommandLink(Stream* input);
+    bool update();
+    bool getMode(CommandMode* mode);
+    bool getCommand(unsigned long currentTime,RemoteCommand* command);
+    bool acknowledge(unsigned long currentTime,int* commandType,unsigned long* latency);
+    int getRequest();
+    unsigned long getFramesReceived();
+    unsigned long getFramesBad();
+    unsigned long getCommandsExpired();
+    unsigned long getMaxLatency();
+ };
+
+ // Constructor, commands are read from input (Serial)
+ CommandLink::CommandLink(Stream* input) {
+  this->input = input;
+  state = PARSE_SYNC;
+  type = 0;
+  length = 0;
+  index = 0;
+  crc = 0xFFFF;
+  frameCrc = 0;
+  hasCommand = false;
+  isCommandTaken = false;
+  isExpired = false;
+  mode = -1;
+  modeTime = 0;
+  for(int i = 0; i < COMMAND_TYPE_COUNT; i++) {
+    isPending[i] = false;
+    pendingTimes[i] = 0;
+  }
+  request = -1;
+  framesReceived = 0;
+  framesBad = 0;
+  commandsExpired = 0;
+  maxLatency = 0;
+ }
+
+ // Reads what has arrived, up to COMMAND_LINK_MAX_BYTES. Returns true if a command was read
+ bool CommandLink::update() {
+  bool isNew = false;
+  int count = input->available();
+  if(count > COMMAND_LINK_MAX_BYTES) count = COMMAND_LINK_MAX_BYTES;
+  for(int i = 0; i < count; i++) {
+    int value = input->read();
+    if(value < 0) break;
+    isNew |= parse(value);
+  }
+  return isNew;
+ }
+
+ // Takes one byte of a frame, returns true when it completes a good command
+ bool CommandLink::parse(uint8_t value) {
+  switch(state) {
+    case PARSE_SYNC:
+      if(value == TELEMETRY_SYNC) {
+        crc = 0xFFFF;
+        state = PARSE_TYPE;
+      }
+      else if(value == 'p' || value == 'r' || value == 's') {
+        request = value;
+      }
+      return false;
+    case PARSE_TYPE:
+      type = value;
+      crc = telemetryCrc(crc,value);
+      state = PARSE_LENGTH;
+      return false;
+    case PARSE_LENGTH:
+      length = value;
+      crc = telemetryCrc(crc,value);
+      if(length > COMMAND_MAX_PAYLOAD) {
+        framesBad++;
+        state = PARSE_SYNC;
+        return false;
+      }
+      index = 0;
+      state = length == 0 ? PARSE_CRC_LOW : PARSE_PAYLOAD;
+      return false;
+    case PARSE_PAYLOAD:
+      payload[index++] = value;
+      crc = telemetryCrc(crc,value);
+      if(index == length) state = PARSE_CRC_LOW;
+      return false;
+    case PARSE_CRC_LOW:
+      frameCrc = value;
+      state = PARSE_CRC_HIGH;
+      return false;
+    case PARSE_CRC_HIGH:
+      frameCrc |= (uint16_t)value << 8;
+      state = PARSE_SYNC;
+      if(frameCrc != crc) {
+        framesBad++;
+        return false;
+      }
+      return decode();
+  }
+  return false;
+ }
+
+ // Turns a good frame into a command, returns false for an unknown type or a wrong length
+ bool CommandLink::decode() {
+  RemoteCommand received;
+  switch(type) {
+    case COMMAND_MODE:
+      if(length != 1 || payload[0] > COMMAND_MODE_REMOTE) break;
+      mode = payload[0];
+      modeTime = halMicros();
+      framesReceived++;
+      return true;
+    case COMMAND_SETPOINT:
+      if(length != 6) break;
+      received.speed = clamp((int8_t)payload[2],-100,100) / 100.0;
+      received.steeringAngle = clamp(payload[3],STEERING_SERVO_MIN_ANGLE,STEERING_SERVO_MAX_ANGLE);
+      received.eyeAngle = clamp(payload[4],EYE_SERVO_MIN_ANGLE,EYE_SERVO_MAX_ANGLE);
+      received.isSweeping = payload[5] & 0x01;
+      received.heading = EYE_SERVO_HOME_ANGLE;
+      return accept(received);
+    case COMMAND_WAYPOINT:
+      if(length != 4) break;
+      received.heading = clamp(payload[2],EYE_SERVO_MIN_ANGLE,EYE_SERVO_MAX_ANGLE);
+      received.speed = clamp(payload[3],0,100) / 100.0;
+      received.steeringAngle = STEERING_SERVO_HOME_ANGLE;
+      received.eyeAngle = EYE_SERVO_HOME_ANGLE;
+      received.isSweeping = true;
+      return accept(received);
+  }
+  framesBad++;
+  return false;
+ }
+
+ // Makes a setpoint or waypoint the one to follow, replacing the one before it
+ bool CommandLink::accept(RemoteCommand& received) {
+  unsigned long timeToLive = payload[0] | (payload[1] << 8);
+  if(timeToLive == 0 || timeToLive > COMMAND_MAX_TTL_MILLIS) timeToLive = COMMAND_MAX_TTL_MILLIS;
+  received.type = type;
+  received.readTime = halMicros();
+  received.startTime = halMillis();
+  received.timeToLive = timeToLive;
+  command = received;
+  hasCommand = true;
+  isCommandTaken = false;
+  isExpired = false;
+  framesReceived++;
+  return true;
+ }
+
+ int CommandLink::clamp(int value,int minValue,int maxValue) {
+  if(value < minValue) return minValue;
+  if(value > maxValue) return maxValue;
+  return value;
+ }
+
+ // Returns true once for each mode frame, with the mode it asked for
+ bool CommandLink::getMode(CommandMode* mode) {
+  if(this->mode < 0) return false;
+  *mode = (CommandMode)this->mode;
+  this->mode = -1;
+  isPending[COMMAND_MODE] = true;
+  pendingTimes[COMMAND_MODE] = modeTime;
+  return true;
+ }
+
+ /* Copies the latest setpoint or waypoint into command, returns false if there is none or its
+  * time to live has run out (currentTime in millis)
+  */
+ bool CommandLink::getCommand(unsigned long currentTime,RemoteCommand* command) {
+  if(!hasCommand) return false;
+  if(currentTime - this->command.startTime > this->command.timeToLive) {
+    if(!isExpired) commandsExpired++;
+    isExpired = true;
+    return false;
+  }
+  *command = this->command;
+  if(!isCommandTaken) {
+    isCommandTaken = true;
+    isPending[this->command.type] = true;
+    pendingTimes[this->command.type] = this->command.readTime;
+  }
+  return true;
+ }
+
+ /* Called once the loop has set the targets for the commands it took, returns true for each
+  * one not yet acknowledged with its type and the time from its frame being read (micros)
+  */
+ bool CommandLink::acknowledge(unsigned long currentTime,int* commandType,unsigned long* latency) {
+  for(int i = 0; i < COMMAND_TYPE_COUNT; i++) {
+    if(!isPending[i]) continue;
+    isPending[i] = false;
+    *commandType = i;
+    *latency = currentTime - pendingTimes[i];
+    if(*latency > maxLatency) maxLatency = *latency;
+    return true;
+  }
+  return false;
+ }
+
+ // Returns the last request character received outside a frame and forgets it, -1 if there is none
+ int CommandLink::getRequest() {
+  int value = request;
+  request = -1;
+  return value;
+ }
+
+ unsigned long CommandLink::getFramesReceived() {
+  return framesReceived;
+ }
+
+ // Returns the number of frames with a bad CRC, an unknown type or the wrong length
+ unsigned long CommandLink::getFramesBad() {
+  return framesBad;
+ }
+
+ // Returns the number of setpoints and waypoints that ran out before another arrived
+ unsigned long CommandLink::getCommandsExpired() {
+  return commandsExpired;
+ }
+
+ // Returns the longest time from a command being read to its targets being set (micros)
+ unsigned long CommandLink::getMaxLatency() {
+  return maxLatency;
+ }
+#endif
@@ -17,7 +17,16 @@ const int REAR_MOTOR_CONTROL_WIRE2 = 16;
 const int REAR_MOTOR_ENABLE_WIRE =17; 
 const int REAR_MOTOR_PWM_CHANNEL = 0; 
 const int REAR_MOTOR_PWM_FREQENCY = 5000;
-const int REAR_MOTOR_PWM_RESOLUTION = 8;
+const int REAR_MOTOR_PWM_RESOLUTION = 8; // Checked in dutycycle.h
+
+// Default motion model for servos, degrees per millisecond and settle time (SG90)
+const float SERVO_SLEW_RATE = 0.6;
+const int SERVO_SETTLE_MICROS = 2000;
+
+// Pulse widths for the ends of the servo travel, 0 degrees = 1ms, 180 degrees = 2ms (SG90)
+const int SERVO_MIN_PULSE_MICROS = 1000;
+const int SERVO_MAX_PULSE_MICROS = 2000;
+const int SERVO_ANGLE_RANGE = 180;
 
 // For steering servo
 const int STEERING_SERVO_MIN_ANGLE = 0;
@@ -28,20 +37,21 @@ const int STEERING_SERVO_HOME_ANGLE = 90;
 const int STEERING_SERVO_PWM_WIRE = 25;
 const int STEERING_SERVO_PWM_CHANNEL = 2;
 const int STEERING_SERVO_PWM_FREQENCY = 50;
-const int STEERING_SERVO_PWM_RESOLUTION = 12;
+const int STEERING_SERVO_PWM_RESOLUTION = 16; // Checked in dutycycle.h
  
 // For controller / controllerAction()
 const int CONTROLLER_DATA_WIRE = 26;
 const int CONTROLLER_LATCH_WIRE = 27;
 const int CONTROLLER_CLOCK_WIRE = 14;
+const int CONTROLLER_LATCH_PULSE_MICROS = 12; // NES latch pulse width
+const int CONTROLLER_CLOCK_PULSE_MICROS = 6; // NES clock half period
 
 // For Serial communication
 const int SERIAL_TX_WIRE = 13;
 const int SERIAL_RX_WIRE = 2;
 const int SERIAL_BAUD_RATE = 115200;
 
-// For LED on the ESP32
-const int LED_WIRE = 2;
+// The LED on the ESP32 is on GPIO 2, which is used for Serial RX, so it is not driven
 
 // For eye
 const int EYE_TRIGGER_WIRE = 5;
@@ -52,15 +62,131 @@ const int EYE_SERVO_HOME_ANGLE = 90;
 const int EYE_DIVISIONS = 25;
 const int EYE_MIN_RANGE = 12;
 const int EYE_MAX_RANGE = 60;
+const float EYE_SERVO_SLEW_RATE = 0.6; // Degrees per millisecond (SG90: 0.1s/60 degrees at 4.8V)
+const int EYE_SERVO_SETTLE_MICROS = 2000; // Time for the servo to stop oscillating after a move
+const int EYE_SAMPLES_MAX = 3; // Most pings at one angle of a sweep, fewer are used when the readings agree
+const float EYE_FILTER_ALPHA = 0.5; // Alpha-beta filter for the distance when not sweeping
+const float EYE_FILTER_BETA = 0.1;
+const float EYE_FILTER_GATE = 6.0; // Readings further than this (inches) from the filter's prediction are taken as false echoes
+const int EYE_FILTER_MAX_MISSES = 2; // Missed and false echoes in a row ridden out on the prediction
+
+// For ultrasonic sensors
+const int ULTRASONIC_MAX_RANGE = 400; // Furthest distance the HC-SR04 can measure (inches)
+const int ULTRASONIC_ECHO_START_MICROS = 2000; // Longest wait for the echo line to rise after a trigger
+const float ULTRASONIC_AGREE_TOLERANCE = 1.0; // Readings this close (inches) are taken to be the same object
+const int ULTRASONIC_AGREE_COUNT = 2; // Readings in a row that must agree to stop pinging early
+const int ULTRASONIC_FIELD_OF_VIEW = 30; // Width of the HC-SR04 beam (degrees)
 
 // TODO: SWITCH TO INSTANCE BASED FOR PWM
 const int EYE_PWM_WIRE = 33;
 const int EYE_PWM_CHANNEL = 4;
 const int EYE_PWM_FREQENCY = 50;
-const int EYE_PWM_RESOLUTION = 12;
+const int EYE_PWM_RESOLUTION = 16;
+
+// For the range sensors, fixed HC-SR04s run by PingScheduler. Headings are in degrees like the eye:
+// 0 is the right of the car, 90 straight ahead, 180 the left and 270 behind
+const int LEFT_RANGE_TRIGGER_WIRE = 19;
+const int LEFT_RANGE_ECHO_WIRE = 34;
+const int LEFT_RANGE_HEADING = 135;
+const int RIGHT_RANGE_TRIGGER_WIRE = 21;
+const int RIGHT_RANGE_ECHO_WIRE = 35;
+const int RIGHT_RANGE_HEADING = 45;
+const int REAR_RANGE_TRIGGER_WIRE = 22;
+const int REAR_RANGE_ECHO_WIRE = 36;
+const int REAR_RANGE_HEADING = 270;
+const int RANGE_MAX_RANGE = 60; // Inches
+const int CORNER_RANGE_PRIORITY = 2;
+const int REAR_RANGE_PRIORITY = 1;
+const int EYE_PING_PRIORITY = 8; // The eye takes turns with the range sensors it could hear
+
+// For PingScheduler
+const int PING_BASE_INTERVAL_MICROS = 60000; // Time between pings of a priority 1 sensor
+const int PING_CROSSTALK_RANGE = 72; // Echoes from further than this (inches) are too faint for another sensor to hear
+const float PING_TRAVEL_GAIN = 3.0; // Sensors facing the way the car goes ping up to 1 + 3 times as often at full speed
+const int PING_AWAY_SLOWDOWN = 2; // Sensors facing away from the way the car goes ping half as often
+
+// For SensingTask
+const bool SPLIT_CORE_MODE = true; // Run the eye on its own core, otherwise it runs in loop()
+const int SENSING_CORE = 0; // loop() runs on core 1
+const int SENSING_TASK_STACK = 4096;
+const int SENSING_TASK_PRIORITY = 1;
+const int CONTROL_PERIOD_MILLIS = 5; // Fixed period of the control loop in split core mode
+
+// For Profiler
+#define ARC_PROFILING // Times each stage of the loop, comment out to compile the profiler out
+const int CPU_FREQUENCY_MHZ = 240;
+
+// For Telemetry
+const int TELEMETRY_STATE_DECIMATION = 4; // Controller and actuator frames are sent every 4th loop
+const int TELEMETRY_STATUS_MILLIS = 1000; // Time between status frames
 
 // For ControllerAction
 const float REGULAR_SPEED = 0.5;
 const float FAST_SPEED = 1.0;
+const int MODE_TOGGLE_BUTTONS = 0x0C; // Select and Start pressed together switch between manual and autonomous
+
+// For ObstacleMap and the autonomous mode
+const float OBSTACLE_MAP_GAIN = 0.6; // How much a new reading replaces the old ones in a bin
+const float OBSTACLE_MAP_THRESHOLD = 0.4; // Bins this dense are blocked (an obstacle closer than 36 in)
+const float OBSTACLE_MAP_STOP = 0.6; // Stop if straight ahead is this dense (an obstacle closer than 24 in)
+const float OBSTACLE_MAP_MEMORY_SWEEPS = 2.5; // A bin not measured for this many sweep periods is unknown (blocked)
+const int OBSTACLE_MAP_UNTIMED_MEMORY_MILLIS = 1500; // Memory until the first sweep has been timed
+const float OBSTACLE_MAP_CLEARANCE_WEIGHT = 160; // Degrees off the goal worth as much as a bin of density 1
+const float AUTONOMOUS_SPEED = 0.5; // Speed with nothing in the way
+
+// For MotionProfile, ramps of the rear motor (speed from -1 to 1) and the steering servo (degrees)
+const int MOTION_PROFILE_PERIOD_MICROS = 2000; // The ramps are stepped by a timer at 500 Hz
+const float DRIVE_SLEW_RATE = 2.0; // Speed per second, stopped to full speed in half a second
+const float DRIVE_ACCELERATION = 12.0; // Change in the slew rate per second
+const float DRIVE_JERK = 300.0; // Change in the acceleration per second
+const float STEERING_SLEW_RATE = 300.0; // Degrees per second, half what the servo can do
+const float STEERING_ACCELERATION = 3000.0;
+const float STEERING_JERK = 60000.0;
+
+// For ObjectTracker
+const float OBJECT_CLUSTER_GAP = 6.0; // Neighbouring readings closer than this (inches) are the same object
+const float OBJECT_TRACK_GATE_DISTANCE = 12.0; // A cluster further than this (inches) from a track's prediction is another object
+const float OBJECT_TRACK_GATE_ANGLE = 15.0; // Likewise in degrees, about three steps of the sweep
+const float OBJECT_TRACK_ALPHA = 0.6; // How much of the error corrects a track's position
+const float OBJECT_TRACK_BETA = 0.3; // How much of the error corrects its velocity
+const int OBJECT_TRACK_CONFIRM_HITS = 3; // Sweeps a track must be seen in before its velocity is used
+const int OBJECT_TRACK_MAX_MISSES = 2; // Sweeps in a row a track can go unseen before it is dropped
+
+// For EmergencyStop
+const float EMERGENCY_STOP_DISTANCE = 10.0; // An echo this close (inches) straight ahead brakes at once
+const int EMERGENCY_STOP_ANGLE = 15; // Eye angles this far either side of straight ahead count as ahead
+const float EMERGENCY_STOP_RELEASE_MARGIN = 5.0; // A reading ahead this much further than the stop distance lets the brake go
+const int EMERGENCY_STOP_HORIZON_MILLIS = 750; // Longest the eye is away from straight ahead in a sweep, added to the age of the last reading
+const float CAR_TOP_SPEED = 60.0; // Inches per second at full throttle
+
+// For FlashLog
+const char FLASH_LOG_PARTITION[] = "arclog"; // Raw data partition in partitions.csv
+const int FLASH_LOG_QUEUE_PAGES = 4; // Pages held in memory waiting to be written
+const int FLASH_LOG_ERASE_AHEAD = 16; // Sectors kept erased ahead of the writes (64 KB)
+const int FLASH_LOG_ERASE_SPACING_MILLIS = 200; // Least time between sector erases, each stalls both cores for about 45 ms
+const int FLASH_LOG_FLUSH_MILLIS = 2000; // A part filled page is written after this long
+const int FLASH_LOG_CORE = 0;
+const int FLASH_LOG_TASK_STACK = 2048;
+const int FLASH_LOG_TASK_PRIORITY = 1;
+const int FLASH_LOG_TASK_PERIOD_MILLIS = 10;
+
+// For LoopSupervisor, the deadline is worked out from CONTROL_PERIOD_MILLIS
+const int LOOP_DEADLINE_PERCENT = 80; // A pass of the loop longer than this much of the period is an overrun
+const int CONTROLLER_BUDGET_MICROS = 250; // A controller read takes about 110 us
+const int RESPOND_BUDGET_MICROS = 250;
+const int SENSING_BUDGET_MICROS = 1000; // A sensing step in loop(), without the split core
+const int REPORT_BUDGET_MICROS = 1000;
+const int SUPERVISOR_WINDOW_TICKS = 40; // Overruns are counted over 40 passes (200 ms)
+const int SUPERVISOR_DEGRADE_OVERRUNS = 4; // This many overruns in a window steps down a level
+const int SUPERVISOR_RECOVER_WINDOWS = 10; // Windows in a row without an overrun before stepping back up
+const int DEGRADED_TELEMETRY_DECIMATION = 16; // Controller and actuator frames every 16th loop once degraded
+const int DEGRADED_EYE_DIVISIONS = 13; // Readings per sweep once degraded, every other angle
+const int SENSING_STALL_MILLIS = 250; // No sensor snapshot for this long stops the car
+const int WATCHDOG_TIMEOUT_MILLIS = 1000; // The ESP32 resets if loop() is stuck for this long (whole seconds)
+
+// For CommandLink, commands from a phone or PC over Serial
+const int COMMAND_LINK_MAX_BYTES = 64; // Most bytes read per loop, 115200 baud brings about 58 per 5 ms
+const int COMMAND_MAX_TTL_MILLIS = 1000; // Setpoints and waypoints are followed for this long at most
+const int COMMAND_AHEAD_MAX_AGE_MILLIS = 1000; // A waypoint only goes forward on a reading straight ahead this recent
   
  #endif
@@ -0,0 +1,105 @@
+/* Configuration checks
+ * 18 October 2026
+ * 
+ * Lists every pin and PWM (LEDC) channel used in config.h and fails the build with a
+ * static_assert if two parts of the car share a pin or a channel, if an output is on an
+ * input-only pin, or if two channels share an LEDC timer at different settings.
+ * 
+ * Any pin or channel added to config.h should be added to the lists below, a pin to either the
+ * output or the input list. Pins are checked for repeats within each list and between the two.
+ */ 
+
+#ifndef CONFIGCHECK_H
+#define CONFIGCHECK_H
+
+#include "config.h"
+
+ // Settings of one PWM output
+ struct PWMOutputConfig {
+  int channel;
+  long frequency;
+  int resolution;
+ };
+
+ // Output pins, including the PWM pins
+ constexpr int CONFIG_OUTPUT_PINS[] = {
+  REAR_MOTOR_CONTROL_WIRE1, REAR_MOTOR_CONTROL_WIRE2, REAR_MOTOR_ENABLE_WIRE,
+  STEERING_SERVO_PWM_WIRE,
+  CONTROLLER_LATCH_WIRE, CONTROLLER_CLOCK_WIRE,
+  SERIAL_TX_WIRE,
+  EYE_TRIGGER_WIRE, EYE_PWM_WIRE,
+  LEFT_RANGE_TRIGGER_WIRE, RIGHT_RANGE_TRIGGER_WIRE, REAR_RANGE_TRIGGER_WIRE
+ };
+
+ // Input pins
+ constexpr int CONFIG_INPUT_PINS[] = {
+  CONTROLLER_DATA_WIRE, SERIAL_RX_WIRE, EYE_ECHO_WIRE,
+  LEFT_RANGE_ECHO_WIRE, RIGHT_RANGE_ECHO_WIRE, REAR_RANGE_ECHO_WIRE
+ };
+
+ constexpr PWMOutputConfig CONFIG_PWM_OUTPUTS[] = {
+  {REAR_MOTOR_PWM_CHANNEL, REAR_MOTOR_PWM_FREQENCY, REAR_MOTOR_PWM_RESOLUTION},
+  {STEERING_SERVO_PWM_CHANNEL, STEERING_SERVO_PWM_FREQENCY, STEERING_SERVO_PWM_RESOLUTION},
+  {EYE_PWM_CHANNEL, EYE_PWM_FREQENCY, EYE_PWM_RESOLUTION}
+ };
+
+ const int CONFIG_OUTPUT_PIN_COUNT = sizeof(CONFIG_OUTPUT_PINS) / sizeof(CONFIG_OUTPUT_PINS[0]);
+ const int CONFIG_INPUT_PIN_COUNT = sizeof(CONFIG_INPUT_PINS) / sizeof(CONFIG_INPUT_PINS[0]);
+ const int CONFIG_PWM_OUTPUT_COUNT = sizeof(CONFIG_PWM_OUTPUTS) / sizeof(CONFIG_PWM_OUTPUTS[0]);
+
+ // The ESP32 Arduino core gives each pair of channels a timer, channels 8 to 15 use a second set of timers
+ constexpr int ledcTimer(int channel) {
+  return (channel / 8) * 4 + (channel / 2) % 4;
+ }
+
+ // C++11 constexpr functions are a single return, so the lists are checked with recursion
+ constexpr bool isPinRepeated(const int* pins,int count,int index,int other) {
+  return index >= count ? false :
+    other >= count ? isPinRepeated(pins,count,index + 1,index + 2) :
+    pins[index] == pins[other] || isPinRepeated(pins,count,index,other + 1);
+ }
+
+ constexpr bool isPinShared(const int* pins,int count,const int* others,int otherCount,int index,int other) {
+  return index >= count ? false :
+    other >= otherCount ? isPinShared(pins,count,others,otherCount,index + 1,0) :
+    pins[index] == others[other] || isPinShared(pins,count,others,otherCount,index,other + 1);
+ }
+
+ constexpr bool isPinValid(const int* pins,int count,int index,int maxPin) {
+  return index >= count ? true :
+    pins[index] >= 0 && pins[index] <= maxPin &&
+    !(pins[index] >= 6 && pins[index] <= 11) && // Connected to the flash
+    isPinValid(pins,count,index + 1,maxPin);
+ }
+
+ constexpr bool isChannelRepeated(const PWMOutputConfig* outputs,int count,int index,int other) {
+  return index >= count ? false :
+    other >= count ? isChannelRepeated(outputs,count,index + 1,index + 2) :
+    outputs[index].channel == outputs[other].channel || isChannelRepeated(outputs,count,index,other + 1);
+ }
+
+ constexpr bool isTimerShared(const PWMOutputConfig* outputs,int count,int index,int other) {
+  return index >= count ? false :
+    other >= count ? isTimerShared(outputs,count,index + 1,index + 2) :
+    (ledcTimer(outputs[index].channel) == ledcTimer(outputs[other].channel) &&
+      (outputs[index].frequency != outputs[other].frequency || outputs[index].resolution != outputs[other].resolution)) ||
+    isTimerShared(outputs,count,index,other + 1);
+ }
+
+ constexpr bool isChannelValid(const PWMOutputConfig* outputs,int count,int index) {
+  return index >= count ? true :
+    outputs[index].channel >= 0 && outputs[index].channel < 16 && isChannelValid(outputs,count,index + 1);
+ }
+
+ static_assert(isPinValid(CONFIG_INPUT_PINS,CONFIG_INPUT_PIN_COUNT,0,39),"An input in config.h is not a usable GPIO");
+ static_assert(isPinValid(CONFIG_OUTPUT_PINS,CONFIG_OUTPUT_PIN_COUNT,0,33),
+   "An output in config.h is not a usable GPIO or is on an input-only pin (34 to 39)");
+ static_assert(!isPinRepeated(CONFIG_OUTPUT_PINS,CONFIG_OUTPUT_PIN_COUNT,0,1),"An output pin is used twice in config.h");
+ static_assert(!isPinRepeated(CONFIG_INPUT_PINS,CONFIG_INPUT_PIN_COUNT,0,1),"An input pin is used twice in config.h");
+ static_assert(!isPinShared(CONFIG_OUTPUT_PINS,CONFIG_OUTPUT_PIN_COUNT,CONFIG_INPUT_PINS,CONFIG_INPUT_PIN_COUNT,0,0),
+   "A pin is used as both an output and an input in config.h");
+ static_assert(isChannelValid(CONFIG_PWM_OUTPUTS,CONFIG_PWM_OUTPUT_COUNT,0),"A PWM channel in config.h is out of range (0 to 15)");
+ static_assert(!isChannelRepeated(CONFIG_PWM_OUTPUTS,CONFIG_PWM_OUTPUT_COUNT,0,1),"A PWM channel is used twice in config.h");
+ static_assert(!isTimerShared(CONFIG_PWM_OUTPUTS,CONFIG_PWM_OUTPUT_COUNT,0,1),
+   "Two PWM channels share an LEDC timer (channels 2n and 2n+1) with different frequencies or resolutions");
+#endif
@@ -1,10 +1,17 @@
-/* Controller Class Version 1
+/* Controller Class Version 2
  * Developed by Isaiah Knorr
  * 29 August 2020
  * - Added base attrubutes and behavior
  * - Implemented getData() to successfully read from NES controller
  * 31 August 2020
  * - Improved class structure
+ * 18 October 2026
+ * - Replaced the 1ms delays in getData() with microsecond timed latch and clock pulses
+ * - Added poll(), a non-blocking state machine that clocks one edge per call
+ * - Added getReadTime() to report how long the last complete read took
+ * - Hardware access goes through hal.h
+ * - Latch, clock and data pins are accessed through the GPIO registers
+ * - Added begin(), which sets up the pins with the latch and clock low
  * 
  *** For use with Nintendo NES conroller or other compatible controller using 5V/3.3V ***
  *** Note: NES controller works at 3.3 or 5V, 8bitdo retro reciecer works at 5V only ***
@@ -14,56 +21,171 @@
 #ifndef CONTROLLER_H
 #define CONTROLLER_H
 
+#include "config.h"
+#include "hal.h"
+
+ // Steps of the non-blocking read, see poll()
+ enum ControllerReadState {
+  READ_IDLE,       // No read in progress
+  READ_LATCHING,   // Latch is high, buttons are being loaded into the 4021
+  READ_CLOCK_LOW,  // Clock is low, the current bit is valid on the data wire
+  READ_CLOCK_HIGH  // Clock is high, the 4021 is shifting to the next bit
+ };
+
  class Controller {
   private:
     byte data;
-    int dataWire;
-    int latchWire;
-    int clockWire;
+    byte pendingData; // Bits collected so far by poll()
+    HalFastPin dataWire;
+    HalFastPin latchWire;
+    HalFastPin clockWire;
+    int bitIndex;
+    bool isNewData;
+    ControllerReadState readState;
+    unsigned long edgeTime; // Time of the last edge written by poll()
+    unsigned long readStartTime;
+    unsigned long readTime; // Duration of the last complete read in microseconds
     
   public:
     Controller(int latchWire,int clockWire,int dataWire);
+    void begin();
     byte getData();
+    bool poll();
+    byte getLatest();
+    bool hasNewData();
+    unsigned long getReadTime();
  };
 
 // Constructor
 Controller::Controller(int latchWire,int clockWire,int dataWire) {
-  this->latchWire = latchWire;
-  this->clockWire = clockWire;
-  this->dataWire = dataWire;
+  this->latchWire = halFastPin(latchWire);
+  this->clockWire = halFastPin(clockWire);
+  this->dataWire = halFastPin(dataWire);
+  data = 0x00;
+  pendingData = 0x00;
+  bitIndex = 0;
+  isNewData = false;
+  readState = READ_IDLE;
+  edgeTime = 0;
+  readStartTime = 0;
+  readTime = 0;
+}
+
+// Sets up the pins, the latch and clock are written low before they are made outputs
+void Controller::begin() {
+  halFastWrite(latchWire,LOW);
+  halFastWrite(clockWire,LOW);
+  halPinMode(latchWire.pin,OUTPUT);
+  halPinMode(clockWire.pin,OUTPUT);
+  halPinMode(dataWire.pin,INPUT);
 }
 
 /* Read data from controller and return the value.
  *  The data corresponds to the following buttons:
  *  data[7:0] <--> [A,B,Select,Start,Up,Down,Left,Right]
+ *  The pulse widths come from the NES timing (12us latch, 6us clock half period),
+ *  so a full read takes roughly 110us instead of the 18ms it took with delay(1).
  */
 byte Controller::getData() {
+  unsigned long startTime = halMicros();
+  
   // Reset data value from last read
   data = 0x00;
   
   // Trigger the latch to cause controller to read buttons pressed
-  // *** TODO: Check if a lower delay is possible to reduce delay during reads ***
-  digitalWrite(latchWire,HIGH);
-  delay(1);
-  digitalWrite(latchWire,LOW);
-  delay(1);
+  halFastWrite(latchWire,HIGH);
+  halDelayMicros(CONTROLLER_LATCH_PULSE_MICROS);
+  halFastWrite(latchWire,LOW);
+  halDelayMicros(CONTROLLER_CLOCK_PULSE_MICROS);
 // Repeat 8 times to read each button
   for(int i = 0; i < 8; i++) {
     // Shift the data right
     data = data >> 1;
     
     // Read button value, switch to non inverted signal format
-    if(digitalRead(dataWire) == LOW) data = data | 0x80;
+    if(halFastRead(dataWire) == LOW) data = data | 0x80;
     
     // Set clock high
-    digitalWrite(clockWire,HIGH);
-    delay(1);
+    halFastWrite(clockWire,HIGH);
+    halDelayMicros(CONTROLLER_CLOCK_PULSE_MICROS);
     
     // Set clock low
-    digitalWrite(clockWire,LOW);
-    delay(1);
+    halFastWrite(clockWire,LOW);
+    halDelayMicros(CONTROLLER_CLOCK_PULSE_MICROS);
   }
+
+  // A blocking read restarts any read poll() had in progress
+  readState = READ_IDLE;
+  readTime = halMicros() - startTime;
+  isNewData = true;
   
   return data;
 }
+
+/* Non-blocking read. Each call writes at most one latch or clock edge, and only once
+ * the previous pulse has lasted long enough, so the caller is never delayed.
+ * Returns true when a complete byte has been read, which is then available from getLatest().
+ */
+bool Controller::poll() {
+  unsigned long currentTime = halMicros();
+  unsigned long pulseWidth = CONTROLLER_CLOCK_PULSE_MICROS;
+
+  if(readState == READ_LATCHING) pulseWidth = CONTROLLER_LATCH_PULSE_MICROS;
+
+  // Wait for the current pulse to finish
+  if(readState != READ_IDLE && currentTime - edgeTime < pulseWidth) {
+    return false;
+  }
+
+  switch(readState) {
+    case READ_IDLE: // Start a new read by raising the latch
+      pendingData = 0x00;
+      bitIndex = 0;
+      readStartTime = currentTime;
+      halFastWrite(latchWire,HIGH);
+      readState = READ_LATCHING;
+      break;
+    case READ_LATCHING: // Buttons are loaded, first bit is now on the data wire
+      halFastWrite(latchWire,LOW);
+      readState = READ_CLOCK_LOW;
+      break;
+    case READ_CLOCK_LOW: // Read the current bit and shift the next one in
+      pendingData = pendingData >> 1;
+      if(halFastRead(dataWire) == LOW) pendingData = pendingData | 0x80;
+      halFastWrite(clockWire,HIGH);
+      readState = READ_CLOCK_HIGH;
+      break;
+    case READ_CLOCK_HIGH:
+      halFastWrite(clockWire,LOW);
+      bitIndex++;
+      if(bitIndex == 8) {
+        // All buttons read, publish the byte
+        data = pendingData;
+        readTime = currentTime - readStartTime;
+        isNewData = true;
+        readState = READ_IDLE;
+        return true;
+      }
+      readState = READ_CLOCK_LOW;
+      break;
+  }
+  edgeTime = currentTime;
+  return false;
+}
+
+// Returns the most recent complete read without touching the controller
+byte Controller::getLatest() {
+  isNewData = false;
+  return data;
+}
+
+// Returns true if a read has completed since the last call to getLatest()
+bool Controller::hasNewData() {
+  return isNewData;
+}
+
+// Returns the duration of the last complete read in microseconds
+unsigned long Controller::getReadTime() {
+  return readTime;
+}
 #endif
@@ -4,6 +4,10 @@
  * 23 November 2020
  * 
  * This class processes the raw controller data and transforms reference parameters to create the desired action
+ * 
+ * 18 October 2026
+ * - Added update(), which turns each controller byte into press and release events so the
+ *   targets are only worked out again when the buttons change
  */ 
 
 #ifndef CONTROLLER_ACTION_H
@@ -13,13 +17,43 @@
 
  class ControllerAction {
   private:
+    byte lastData; // Controller data from the last update()
+    byte pressed; // Buttons pressed since the last update()
+    byte released; // Buttons released since the last update()
   public:
     ControllerAction();
+    bool update(byte controllerData);
+    byte getPressed();
+    byte getReleased();
     void respond(byte controllerData,float* targetSpeed,int* steeringAngle,int* eyeAngle); 
  };
 
  ControllerAction::ControllerAction() {
-    // Nothing needs to be done here
+    lastData = 0x00;
+    pressed = 0x00;
+    released = 0x00;
+ }
+
+ /* Compares the controller data with the last update() to find the buttons pressed and released.
+  * Returns true if respond() needs to be called: when a button changed, or while A is held with
+  * Left or Right, which keeps moving the eye.
+  */
+ bool ControllerAction::update(byte controllerData) {
+    pressed = controllerData & ~lastData;
+    released = lastData & ~controllerData;
+    lastData = controllerData;
+    if(pressed || released) return true;
+    return controllerData != 0xFF && (controllerData & 0x01) && (controllerData & 0xC0);
+ }
+
+ // Buttons that went down in the last update()
+ byte ControllerAction::getPressed() {
+    return pressed;
+ }
+
+ // Buttons that went up in the last update()
+ byte ControllerAction::getReleased() {
+    return released;
  }
 
  // This method will modify the speed, steering angle, and eye angle values based on the controller data
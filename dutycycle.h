@@ -0,0 +1,76 @@
+/* Duty cycle generator
+ * 18 October 2026
+ * 
+ * Integer (fixed-point) conversions from servo angles and motor speeds to LEDC duty cycles, for
+ * any PWM resolution and frequency. The functions are constexpr, so the same code works out the
+ * duty cycles at run time and checks the PWM settings in config.h when compiling.
+ * 
+ * ServoDutyCycle and MotorDutyCycle are templates on the settings of one PWM output. They hold
+ * the duty cycles for those settings as compile time constants and fail the build with a
+ * static_assert if the LEDC cannot produce the signal, e.g. a resolution too high for the
+ * frequency or too low to move the servo one degree at a time. A resolution too low for the
+ * frequency fails as well: the LEDC timer divides its clock by at most LEDC_MAX_DIVIDER, so
+ * FREQUENCY << RESOLUTION must be at least LEDC_CLOCK_FREQUENCY / LEDC_MAX_DIVIDER.
+ */ 
+
+#ifndef DUTYCYCLE_H
+#define DUTYCYCLE_H
+
+#include "config.h"
+
+ const long LEDC_CLOCK_FREQUENCY = 80000000; // APB clock that drives the LEDC timers
+ const int LEDC_MAX_RESOLUTION = 20;
+ const long LEDC_MAX_DIVIDER = 1023; // Integer part of the LEDC timer's clock divider is 10 bits
+ const int DUTY_FRACTION_BITS = 16; // Motor speeds are converted to fractions of 2^16
+
+ // Largest duty cycle for a resolution (always on)
+ constexpr uint32_t dutyMax(int resolution) {
+  return (1UL << resolution) - 1;
+ }
+
+ // Duty cycle for a pulse width in microseconds, rounded to the nearest step
+ constexpr uint32_t dutyFromPulse(uint32_t pulseMicros,uint32_t frequency,int resolution) {
+  return ((uint64_t)pulseMicros * frequency * (1ULL << resolution) + 500000) / 1000000;
+ }
+
+ // Duty cycle for an angle, minDuty at 0 degrees and minDuty + dutySpan at maxAngle
+ constexpr uint32_t dutyFromAngle(int angle,uint32_t minDuty,uint32_t dutySpan,int maxAngle) {
+  return minDuty + (dutySpan * (uint32_t)angle + maxAngle / 2) / maxAngle;
+ }
+
+ // Duty cycle for a fraction of full power (0 to 2^DUTY_FRACTION_BITS)
+ constexpr uint32_t dutyFromFraction(uint32_t fraction,int resolution) {
+  return ((uint64_t)fraction * dutyMax(resolution) + (1UL << (DUTY_FRACTION_BITS - 1))) >> DUTY_FRACTION_BITS;
+ }
+
+ // Duty cycles of a servo output, checked when compiling
+ template <int RESOLUTION,long FREQUENCY,int MIN_PULSE_MICROS,int MAX_PULSE_MICROS,int MAX_ANGLE>
+ struct ServoDutyCycle {
+  static_assert(RESOLUTION >= 1 && RESOLUTION <= LEDC_MAX_RESOLUTION,"Servo PWM resolution is out of range");
+  static_assert(FREQUENCY * (1LL << RESOLUTION) <= LEDC_CLOCK_FREQUENCY,"Servo PWM resolution is too high for its frequency");
+  static_assert(FREQUENCY * (1LL << RESOLUTION) * LEDC_MAX_DIVIDER >= LEDC_CLOCK_FREQUENCY,
+    "Servo PWM resolution is too low for its frequency, the LEDC clock divider would overflow");
+  static_assert((long)MAX_PULSE_MICROS * FREQUENCY < 1000000,"Servo pulse is longer than the PWM period");
+  static_assert(MIN_PULSE_MICROS < MAX_PULSE_MICROS && MAX_ANGLE > 0,"Servo pulse range is empty");
+  static const uint32_t MIN_DUTY = dutyFromPulse(MIN_PULSE_MICROS,FREQUENCY,RESOLUTION);
+  static const uint32_t DUTY_SPAN = dutyFromPulse(MAX_PULSE_MICROS,FREQUENCY,RESOLUTION) - MIN_DUTY;
+  static_assert(DUTY_SPAN >= MAX_ANGLE,"Servo PWM resolution is too low for one degree steps");
+ };
+
+ // Duty cycles of a motor output, checked when compiling
+ template <int RESOLUTION,long FREQUENCY>
+ struct MotorDutyCycle {
+  static_assert(RESOLUTION >= 1 && RESOLUTION <= LEDC_MAX_RESOLUTION,"Motor PWM resolution is out of range");
+  static_assert(FREQUENCY * (1LL << RESOLUTION) <= LEDC_CLOCK_FREQUENCY,"Motor PWM resolution is too high for its frequency");
+  static_assert(FREQUENCY * (1LL << RESOLUTION) * LEDC_MAX_DIVIDER >= LEDC_CLOCK_FREQUENCY,
+    "Motor PWM resolution is too low for its frequency, the LEDC clock divider would overflow");
+  static const uint32_t MAX_DUTY = dutyMax(RESOLUTION);
+ };
+
+ // Check the PWM outputs in config.h
+ static_assert(ServoDutyCycle<STEERING_SERVO_PWM_RESOLUTION,STEERING_SERVO_PWM_FREQENCY,SERVO_MIN_PULSE_MICROS,
+   SERVO_MAX_PULSE_MICROS,SERVO_ANGLE_RANGE>::DUTY_SPAN > 0,"Steering servo PWM settings");
+ static_assert(ServoDutyCycle<EYE_PWM_RESOLUTION,EYE_PWM_FREQENCY,SERVO_MIN_PULSE_MICROS,
+   SERVO_MAX_PULSE_MICROS,SERVO_ANGLE_RANGE>::DUTY_SPAN > 0,"Eye servo PWM settings");
+ static_assert(MotorDutyCycle<REAR_MOTOR_PWM_RESOLUTION,REAR_MOTOR_PWM_FREQENCY>::MAX_DUTY > 0,"Rear motor PWM settings");
+#endif
@@ -11,15 +11,65 @@
  * - Created basic class structure and operation
  * - Implemented the getAngle and setAngle functions
  * - Implemented the sweep function, which returns the average distance of a sweep
- * TODO: Store all values of sweep in an array and return this value (may need to create a struct)
+ * 18 October 2026
+ * - The ultrasonic timeout is now bounded by maxRange
+ * - Added updateDistance() to read the distance without blocking
+ * - Every reading of a sweep is now stored in a ScanFrame (angle, distance, validity, timestamp)
+ * - Added update(), which advances the sweep by one step per call and publishes the frame when complete
+ * - Fixed the average distance leaking from one sweep into the next
+ * - Pings are fired as soon as the servo motion model predicts the servo has settled, and the
+ *   next move starts as soon as the echo has been captured, instead of a fixed 10ms wait
+ * - Added getSweepRate() to report the achieved sweeps per second
+ * - Hardware access goes through hal.h
+ * - Each angle of a sweep is pinged until the readings agree (up to EYE_SAMPLES_MAX), a reading
+ *   that agrees with the last sweep is trusted straight away
+ * - The distance from updateDistance() is smoothed by an alpha-beta filter, which also gives
+ *   the closing rate, throws out false echoes and rides out missed ones
+ * - Added setEchoCallback(), to act on an echo from the interrupt that captured it, and
+ *   getPingAngle(), the angle of the ping in flight, which the interrupt can read
+ * - Added getSensor(), so a PingScheduler can take turns with the eye's sensor, and isSettled()
+ * - Added begin(), which starts the servo PWM and the sensor from setup()
+ * - Added setDivisions(), which changes the number of readings from the next sweep on
  * For use with the HC-SR04 Ultrasonic module and SG90 servo motor
  */ 
 
 #ifndef ECHOSWEEPER_H
 #define ECHOSWEEPER_H
 
+#include "config.h"
+#include "hal.h"
 #include "ultrasonic.h"
 #include "servoesp32.h"
+#include "filter.h"
+
+ // Most readings a sweep can hold, one per division
+ const int SCAN_FRAME_CAPACITY = EYE_DIVISIONS;
+
+ // A single reading taken during a sweep
+ struct ScanPoint {
+  int angle;
+  double distance; // Distance in inches, -1 if nothing was detected
+  bool isValid; // True if the distance is between minRange and maxRange
+  unsigned long timestamp; // Time the reading was taken (micros)
+ };
+
+ // All of the readings of one sweep, stored in order of increasing angle
+ struct ScanFrame {
+  ScanPoint points[SCAN_FRAME_CAPACITY];
+  int count;
+  bool isForward; // Direction the sweep was taken in
+  int pingCount; // Pings taken for the whole sweep
+  unsigned long sequence; // Number of the sweep, increases by one per frame
+  unsigned long startTime;
+  unsigned long endTime;
+ };
+
+ // Steps of the incremental sweep, see update()
+ enum SweepState {
+  SWEEP_MOVE,   // Move the servo to the next angle
+  SWEEP_SETTLE, // Wait for the servo to settle, then ping
+  SWEEP_PING    // Wait for the echo
+ };
 
  class EchoSweeper {
 
@@ -29,78 +79,268 @@
     int minRange;
     int maxRange;
     int divisions;
-    double averageDistance;
+    int nextDivisions; // Divisions of the next sweep, set by setDivisions()
     bool isForward;
     ServoESP32 servoMotor;
     Ultrasonic ultrasonicSensor;   
+    ScanFrame frames[2]; // One frame is being filled while the other is published
+    int publishedFrame;
+    int stepIndex; // Number of readings taken in the current sweep
+    SweepState sweepState;
+    unsigned long sweepCount;
+    MedianFilter stepFilter; // Readings at the current angle of the sweep
+    AlphaBetaFilter distanceFilter; // Readings from updateDistance()
+    int filterAngle; // Angle of the readings in distanceFilter
+    volatile int pingAngle; // Angle of the last ping started, read by the echo interrupt
+    int getPointIndex(int step);
+    void moveToStep();
+    bool isStepAgreed(int index);
+    ScanPoint newPoint; // Last reading stored by update()
+    bool isNewPoint;
 
   public:
     EchoSweeper(int minAngle,int maxAngle,int homeAngle,int PWMChannel,int PWMWire,int PWMFrequency,int PWMResolution,int triggerPin,int echoPin,int divisions,int minRange,int maxRange);
+    void begin();
     double sweep();
+    bool update();
+    void restartSweep();
+    const ScanFrame& getFrame();
+    bool getNewPoint(ScanPoint* point);
+    double getAverageDistance();
+    double getSweepRate();
+    int getDivisions();
+    void setDivisions(int divisions);
+    int getStepAngle(int index);
     double getDistance();
+    bool updateDistance();
+    double getLastDistance();
+    double getClosingRate();
     bool setAngle(int angle);
     int getAngle();
+    int IRAM_ATTR getPingAngle();
+    bool isSettled();
+    void setEchoCallback(EchoCallback callback,void* arg);
+    Ultrasonic* getSensor();
   
  };
 
  // Constructor
  EchoSweeper::EchoSweeper(int minAngle,int maxAngle,int homeAngle,int PWMChannel,int PWMWire,int PWMFrequency,int PWMResolution,int triggerPin,int echoPin,int divisions,int minRange,int maxRange)
-    : servoMotor(minAngle,maxAngle,homeAngle,PWMChannel,PWMWire,PWMFrequency,PWMResolution), ultrasonicSensor(triggerPin,echoPin) // This is the initilization list for the sub classes of EchoSweeper
+    : servoMotor(minAngle,maxAngle,homeAngle,PWMChannel,PWMWire,PWMFrequency,PWMResolution), ultrasonicSensor(triggerPin,echoPin,maxRange), // This is the initilization list for the sub classes of EchoSweeper
+      stepFilter(ULTRASONIC_AGREE_TOLERANCE), distanceFilter(EYE_FILTER_ALPHA,EYE_FILTER_BETA,EYE_FILTER_GATE,EYE_FILTER_MAX_MISSES)
   {
   //Servo servoMotor(minAngle,maxAngle,homeAngle,PWMChannel);
   this->minAngle = minAngle;
   this->maxAngle = maxAngle;
   this->minRange = minRange;
   this->maxRange = maxRange;
+
+  // Frames have a fixed size, so the number of divisions is limited to what fits
+  if(divisions > SCAN_FRAME_CAPACITY) divisions = SCAN_FRAME_CAPACITY;
+  if(divisions < 2) divisions = 2;
   this->divisions = divisions;
-  averageDistance = 0;
+  nextDivisions = divisions;
+
+  isForward = true;
+  publishedFrame = 0;
+  sweepCount = 0;
+  filterAngle = homeAngle;
+  pingAngle = homeAngle;
+  isNewPoint = false;
+  for(int i = 0; i < 2; i++) {
+    frames[i].count = 0;
+    frames[i].isForward = true;
+    frames[i].pingCount = 0;
+    frames[i].sequence = 0;
+    frames[i].startTime = 0;
+    frames[i].endTime = 0;
+  }
+  servoMotor.setMotionModel(EYE_SERVO_SLEW_RATE,EYE_SERVO_SETTLE_MICROS);
+  restartSweep();
+ }
+
+ // Starts the servo at the angle set so far and sets up the sensor, from setup()
+ void EchoSweeper::begin() {
+  servoMotor.begin();
+  ultrasonicSensor.begin();
  }
 
  // The sweep function will sweep between two angles, reading the distance at each position
+ // Blocks until the whole sweep is done, see update() for the non-blocking version
  double EchoSweeper::sweep() {
-  // TODO: check for valid ranges
-  double currentDistance = 0;
-  int hitCount = 0;
-  // When sweeping from the min to max angle
-  if(isForward) {
-    for(int i = minAngle; i < maxAngle; i = i +((maxAngle - minAngle)/divisions)) {
-      // Set angle for current reading
-      servoMotor.setAngle(i);
-      delay(10);
-      currentDistance  = ultrasonicSensor.getDistance();
-      // Check for a read in range being observed
-      if(currentDistance >= minRange && currentDistance <= maxRange) {
-        hitCount++;
-        averageDistance += currentDistance;
-      }
-    }
+  // Collect any ping left in flight, then take a complete sweep from the first step
+  while(ultrasonicSensor.isBusy()) {
+    ultrasonicSensor.poll();
+  }
+  restartSweep();
+  while(!update()) {
   }
-  // When sweeping from max to min angle
-  else {
-    // Split the sweep up into pieces, based on the # of divisions
-    for(int i = maxAngle; i > minAngle; i = i - ((maxAngle - minAngle)/divisions)) {
-      // Set angle for current reading
-      servoMotor.setAngle(i);
-      delay(10);
-      currentDistance  = ultrasonicSensor.getDistance();
-      // Check for a read in range being observed
-      if(currentDistance >= minRange && currentDistance <= maxRange) {
-        hitCount++;
-        averageDistance += currentDistance;
+  return getAverageDistance();
+ }
+
+ /* Advances the sweep without blocking. Each call moves the servo, starts a ping or collects
+  * an echo once it is time to do so. Returns true when a sweep has been completed, the
+  * readings are then available from getFrame() until the next sweep completes.
+  */
+ bool EchoSweeper::update() {
+  ScanFrame* frame = &frames[1 - publishedFrame];
+  int index;
+  bool isComplete = false;
+
+  switch(sweepState) {
+    case SWEEP_MOVE:
+      moveToStep();
+      return false;
+    case SWEEP_SETTLE:
+      // Fire the ping as soon as the servo is predicted to have settled
+      if(!servoMotor.isSettled()) return false;
+      // Throw away a ping started before the sweep (by updateDistance), it was taken at another angle
+      if(ultrasonicSensor.isBusy()) {
+        ultrasonicSensor.poll();
+        return false;
       }
-    }
+      // The sensor may still be busy with a previous echo, try again on the next call
+      pingAngle = servoMotor.getAngle();
+      if(!ultrasonicSensor.startPing()) return false;
+      sweepState = SWEEP_PING;
+      return false;
+    case SWEEP_PING:
+      // The ping was collected elsewhere (by updateDistance), take it again
+      if(!ultrasonicSensor.isBusy()) {
+        sweepState = SWEEP_SETTLE;
+        return false;
+      }
+      if(!ultrasonicSensor.poll()) return false;
+      break;
   }
-  // Swap sweep direction for next sweep (this creates the back and forth motion)
-  isForward = !isForward;
+
+  // Ping again at this angle until the readings agree, the servo is already there
+  index = getPointIndex(stepIndex);
+  stepFilter.add(ultrasonicSensor.getLastDistance());
+  frame->pingCount++;
+  if(!isStepAgreed(index) && stepFilter.getCount() < EYE_SAMPLES_MAX) {
+    sweepState = SWEEP_SETTLE;
+    return false;
+  }
+
+  // Store the reading
+  frame->points[index].angle = getStepAngle(index);
+  frame->points[index].distance = stepFilter.getEstimate();
+  stepFilter.reset();
+  frame->points[index].timestamp = halMicros();
+  // Check for a read in range being observed
+  frame->points[index].isValid = frame->points[index].distance >= minRange && frame->points[index].distance <= maxRange;
+  newPoint = frame->points[index];
+  isNewPoint = true;
+  stepIndex++;
+
+  if(stepIndex == divisions) {
+    // Sweep complete, publish the frame
+    frame->endTime = halMicros();
+    frame->sequence = ++sweepCount;
+    publishedFrame = 1 - publishedFrame;
+    stepIndex = 0;
   
-  // Compute average distance
-  if(hitCount > 0) {
-    averageDistance = averageDistance / hitCount;
+    // Swap sweep direction for next sweep (this creates the back and forth motion)
+    isForward = !isForward;
+    isComplete = true;
+  }
+
+  // The echo is in, so the servo can start moving to the next angle right away
+  moveToStep();
+  return isComplete;
+ }
+
+ // Sends the servo to the angle of the current step
+ void EchoSweeper::moveToStep() {
+  if(stepIndex == 0) {
+    ScanFrame* frame = &frames[1 - publishedFrame];
+    divisions = nextDivisions;
+    frame->startTime = halMicros();
+    frame->isForward = isForward;
+    frame->count = divisions;
+    frame->pingCount = 0;
+  }
+  // Set angle for current reading
+  servoMotor.setAngle(getStepAngle(getPointIndex(stepIndex)));
+  sweepState = SWEEP_SETTLE;
+ }
+
+ // Starts the next call to update() from the first step of a sweep
+ void EchoSweeper::restartSweep() {
+  stepIndex = 0;
+  sweepState = SWEEP_MOVE;
+  stepFilter.reset();
+ }
+
+ /* Returns true once the readings at the current step can be trusted: the last readings agree,
+  * or the first reading agrees with the reading at the same angle in the last sweep.
+  */
+ bool EchoSweeper::isStepAgreed(int index) {
+  const ScanFrame& lastFrame = frames[publishedFrame];
+  if(stepFilter.isAgreed(ULTRASONIC_AGREE_COUNT)) return true;
+  if(stepFilter.getCount() != 1 || lastFrame.sequence == 0 || lastFrame.count != divisions) return false;
+  return stepFilter.agrees(stepFilter.getLatest(),lastFrame.points[index].distance);
+ }
+
+ // Copies the reading stored by the last update() into point, returns false if it was already taken
+ bool EchoSweeper::getNewPoint(ScanPoint* point) {
+  if(!isNewPoint) return false;
+  *point = newPoint;
+  isNewPoint = false;
+  return true;
+ }
+
+ // Returns the most recently completed sweep
+ const ScanFrame& EchoSweeper::getFrame() {
+  return frames[publishedFrame];
+ }
+
+ // Returns the average distance of the readings in range of the last sweep, -1 if there were none
+ double EchoSweeper::getAverageDistance() {
+  const ScanFrame& frame = frames[publishedFrame];
+  double totalDistance = 0;
+  int hitCount = 0;
+  for(int i = 0; i < frame.count; i++) {
+    if(frame.points[i].isValid) {
+      totalDistance += frame.points[i].distance;
+      hitCount++;
+    }
   }
-  else {
-    averageDistance = -1; // This indicates no object detected in range
+  if(hitCount == 0) {
+    return -1; // This indicates no object detected in range
   }
-    return averageDistance;
+  return totalDistance / hitCount;
+ }
+
+ // Returns the sweeps per second achieved by the last sweep
+ double EchoSweeper::getSweepRate() {
+  const ScanFrame& frame = frames[publishedFrame];
+  if(frame.endTime == frame.startTime) return 0;
+  return 1000000.0 / (frame.endTime - frame.startTime);
+ }
+
+ // Returns the number of readings in a sweep
+ int EchoSweeper::getDivisions() {
+  return divisions;
+ }
+
+ // Sets the number of readings in a sweep, the sweep under way finishes with the old number
+ void EchoSweeper::setDivisions(int divisions) {
+  if(divisions > SCAN_FRAME_CAPACITY) divisions = SCAN_FRAME_CAPACITY;
+  if(divisions < 2) divisions = 2;
+  nextDivisions = divisions;
+ }
+
+ // Returns the angle of a reading, readings are evenly spaced from minAngle to maxAngle
+ int EchoSweeper::getStepAngle(int index) {
+  return minAngle + (index * (maxAngle - minAngle)) / (divisions - 1);
+ }
+
+ // Converts a step of the sweep into a point in the frame, based on the sweep direction
+ int EchoSweeper::getPointIndex(int step) {
+  if(isForward) return step;
+  return divisions - 1 - step;
  }
 
 // Returns the distance of an object to the ultrasonic sensor
@@ -109,11 +349,55 @@
   return ultrasonicSensor.getDistance();
  }
 
+// Keeps a ping in flight without blocking, returns true when a new distance is available
+ bool EchoSweeper::updateDistance() {
+  // An idle sensor pings now, at the angle the servo was set to
+  if(!ultrasonicSensor.isBusy()) pingAngle = servoMotor.getAngle();
+  if(!ultrasonicSensor.update()) return false;
+  // Readings from another angle are of something else, start the filter again
+  if(servoMotor.getAngle() != filterAngle) {
+    distanceFilter.reset();
+    filterAngle = servoMotor.getAngle();
+  }
+  distanceFilter.update(ultrasonicSensor.getLastDistance(),halMicros());
+  return true;
+ }
+
+// Returns the filtered distance from the last call to updateDistance() that returned true, -1 if nothing is in range
+ double EchoSweeper::getLastDistance() {
+  return distanceFilter.getDistance();
+ }
+
+// Returns how fast the distance from updateDistance() is changing (inches per second), negative when closing
+ double EchoSweeper::getClosingRate() {
+  return distanceFilter.getRate();
+ }
+
 // Returns the current angle of the servo
 int EchoSweeper::getAngle() {
   return servoMotor.getAngle();
 }
 
+// Returns the angle of the last ping started, kept in RAM so the echo interrupt can read it while the flash is busy
+int IRAM_ATTR EchoSweeper::getPingAngle() {
+  return pingAngle;
+}
+
+// Returns true once the servo is predicted to have reached getAngle(), until then it points somewhere on the way
+bool EchoSweeper::isSettled() {
+  return servoMotor.isSettled();
+}
+
+// Sets a function to be called from the interrupt as soon as an echo is captured, getPingAngle() is the angle pinged
+void EchoSweeper::setEchoCallback(EchoCallback callback,void* arg) {
+  ultrasonicSensor.setCallback(callback,arg);
+}
+
+// Returns the eye's sensor, for a PingScheduler to gate its pings
+Ultrasonic* EchoSweeper::getSensor() {
+  return &ultrasonicSensor;
+}
+
 // Sets the angle of the servo
 bool EchoSweeper::setAngle(int angle) {
   // Check for valid angle
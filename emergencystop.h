@@ -0,0 +1,116 @@
+/* EmergencyStop class
+ * 18 October 2026
+ * 
+ * Safety fast path from the eye to the rear motor. The check runs in the echo interrupt, so
+ * an obstacle closer than EMERGENCY_STOP_DISTANCE straight ahead brakes the car as soon as
+ * its echo is captured, rather than after the control loop comes round again. The brake is
+ * latched in the Motor and blocks forward speeds until clear() is called, which the control
+ * loop does once the car is no longer being asked to go forward. In the modes that drive
+ * themselves the car keeps being asked to go forward while the map has a free heading, so
+ * releaseIfClear() also lets the brake go once a reading ahead taken after it latched is further
+ * than EMERGENCY_STOP_DISTANCE plus EMERGENCY_STOP_RELEASE_MARGIN, and a passing or false echo
+ * does not leave the car stopped for good.
+ * 
+ * Nothing here is filtered: a single close echo is enough to stop the car.
+ * 
+ * The echo interrupt is registered in IRAM (hal.h), and onEcho() and everything it calls are
+ * IRAM_ATTR and only read RAM (the eye caches the angle of each ping in getPingAngle()), so the
+ * brake is not held off while the flash log writes or erases a sector.
+ * 
+ * The brake only sees what the eye sees while it points within EMERGENCY_STOP_ANGLE of straight
+ * ahead. Sweeping from 25 to 155 degrees that is about a quarter of the time, and the corner
+ * range sensors (45 and 135 degrees) do not cover straight ahead, so for most of a sweep the
+ * brake is blind. getSpeedLimit() covers the gap: the control loop caps the forward speed so the
+ * car cannot reach EMERGENCY_STOP_DISTANCE from the last reading ahead before it is likely to
+ * look again, and the older that reading gets the slower the car goes.
+ */ 
+
+#ifndef EMERGENCYSTOP_H
+#define EMERGENCYSTOP_H
+
+#include "config.h"
+#include "hal.h"
+#include "motor.h"
+#include "ultrasonic.h"
+#include "echosweeper.h"
+
+ class EmergencyStop {
+  private:
+    Motor* motor;
+    EchoSweeper* eye;
+    unsigned long thresholdMicros; // Echoes shorter than this are too close
+    volatile unsigned long stopCount;
+    unsigned long latchedTime; // When the control loop first saw the brake latched (millis), 0 if not latched
+    static void IRAM_ATTR onEcho(unsigned long echoMicros,void* arg);
+  public:
+    EmergencyStop(Motor* motor,EchoSweeper* eye);
+    bool isStopped();
+    void clear();
+    void releaseIfClear(double distanceAhead,unsigned long aheadTime);
+    unsigned long getStopCount();
+    static float getSpeedLimit(double distanceAhead,unsigned long age);
+ };
+
+ // Constructor, the check starts with the first echo
+ EmergencyStop::EmergencyStop(Motor* motor,EchoSweeper* eye) {
+  this->motor = motor;
+  this->eye = eye;
+  thresholdMicros = Ultrasonic::toMicros(EMERGENCY_STOP_DISTANCE);
+  stopCount = 0;
+  latchedTime = 0;
+  eye->setEchoCallback(onEcho,this);
+ }
+
+ // Brakes if the echo came from close by straight ahead, runs in interrupt context (no floating point)
+ void IRAM_ATTR EmergencyStop::onEcho(unsigned long echoMicros,void* arg) {
+  EmergencyStop* stop = (EmergencyStop*)arg;
+  if(echoMicros > stop->thresholdMicros) return;
+  int angle = stop->eye->getPingAngle();
+  if(angle < 90 - EMERGENCY_STOP_ANGLE || angle > 90 + EMERGENCY_STOP_ANGLE) return;
+  if(!stop->motor->isBrakeLatched()) stop->stopCount++;
+  stop->motor->emergencyBrake();
+ }
+
+ // Returns true while the brake is latched
+ bool EmergencyStop::isStopped() {
+  return motor->isBrakeLatched();
+ }
+
+ // Lets the car go forward again, the next close echo stops it again
+ void EmergencyStop::clear() {
+  motor->clearBrake();
+  latchedTime = 0;
+ }
+
+ /* Lets the car go forward again once the reading ahead (inches, -1 if nothing was in range) was
+  * taken after the brake latched and is clear of it. Called every pass of the control loop
+  */
+ void EmergencyStop::releaseIfClear(double distanceAhead,unsigned long aheadTime) {
+  if(!motor->isBrakeLatched()) {
+    latchedTime = 0;
+    return;
+  }
+  if(latchedTime == 0) latchedTime = halMillis();
+  if((long)(aheadTime - latchedTime) <= 0) return;
+  if(distanceAhead >= 0 && distanceAhead < EMERGENCY_STOP_DISTANCE + EMERGENCY_STOP_RELEASE_MARGIN) return;
+  clear();
+ }
+
+ // Returns the number of times the brake has been latched
+ unsigned long EmergencyStop::getStopCount() {
+  return stopCount;
+ }
+
+ /* Returns the fastest the car may go forward (0 to 1) given the last reading ahead (inches, -1
+  * if nothing was in range) and its age (millis). At CAR_TOP_SPEED the car must not cover the
+  * room left before EMERGENCY_STOP_DISTANCE in the age of the reading plus
+  * EMERGENCY_STOP_HORIZON_MILLIS.
+  */
+ float EmergencyStop::getSpeedLimit(double distanceAhead,unsigned long age) {
+  if(distanceAhead < 0) distanceAhead = EYE_MAX_RANGE;
+  float room = distanceAhead - EMERGENCY_STOP_DISTANCE;
+  if(room <= 0) return 0;
+  float limit = room * 1000.0 / (CAR_TOP_SPEED * (age + EMERGENCY_STOP_HORIZON_MILLIS));
+  return limit > 1.0 ? 1.0 : limit;
+ }
+#endif
@@ -0,0 +1,194 @@
+/* Distance filters
+ * 18 October 2026
+ * 
+ * Small fixed-size filters for ultrasonic readings, which have jitter, the odd echo from the
+ * wrong object and the odd missed echo. Readings below 0 are misses (nothing in range).
+ * 
+ * MedianFilter keeps the last few readings at one angle. Its estimate is the mean of the
+ * readings close to the median, so a single bad echo is thrown out, and isAgreed() says when
+ * the latest readings agree well enough to stop pinging.
+ * 
+ * AlphaBetaFilter follows a distance that changes over time (the eye held at one angle while
+ * the car moves), estimating the distance and how fast it is closing. A reading further than
+ * the gate from the prediction is thrown out as a false echo, and a miss is ridden out on the
+ * prediction, up to maxMisses in a row. Past that the readings are believed: a miss then means
+ * nothing is in range, and a reading out of the gate starts the filter again from it.
+ */ 
+
+#ifndef FILTER_H
+#define FILTER_H
+
+#include "config.h"
+
+ const int FILTER_WINDOW = 5; // Most readings kept by a MedianFilter
+
+ class MedianFilter {
+  private:
+    double samples[FILTER_WINDOW]; // Oldest reading is overwritten first
+    int count;
+    int next;
+    double tolerance; // Readings this close (inches) agree
+    static bool isClose(double a,double b,double tolerance);
+  public:
+    MedianFilter(double tolerance);
+    void reset();
+    void add(double sample);
+    int getCount();
+    double getLatest();
+    bool isAgreed(int agreeCount);
+    double getMedian();
+    double getEstimate();
+    bool agrees(double sample,double other);
+ };
+
+ // Constructor
+ MedianFilter::MedianFilter(double tolerance) {
+  this->tolerance = tolerance;
+  reset();
+ }
+
+ void MedianFilter::reset() {
+  count = 0;
+  next = 0;
+ }
+
+ void MedianFilter::add(double sample) {
+  samples[next] = sample;
+  next = (next + 1) % FILTER_WINDOW;
+  if(count < FILTER_WINDOW) count++;
+ }
+
+ int MedianFilter::getCount() {
+  return count;
+ }
+
+ double MedianFilter::getLatest() {
+  return samples[(next + FILTER_WINDOW - 1) % FILTER_WINDOW];
+ }
+
+ // Two readings agree if both are misses, or both are in range and within the tolerance
+ bool MedianFilter::isClose(double a,double b,double tolerance) {
+  if(a < 0 || b < 0) return a < 0 && b < 0;
+  return fabs(a - b) <= tolerance;
+ }
+
+ bool MedianFilter::agrees(double sample,double other) {
+  return isClose(sample,other,tolerance);
+ }
+
+ // Returns true if the last agreeCount readings all agree with each other
+ bool MedianFilter::isAgreed(int agreeCount) {
+  if(agreeCount < 1 || count < agreeCount) return false;
+  double latest = getLatest();
+  for(int i = 2; i <= agreeCount; i++) {
+    if(!isClose(samples[(next + FILTER_WINDOW - i) % FILTER_WINDOW],latest,tolerance)) return false;
+  }
+  return true;
+ }
+
+ // Returns the median reading, misses count as the lowest readings
+ double MedianFilter::getMedian() {
+  double sorted[FILTER_WINDOW];
+  if(count == 0) return -1.0;
+  // Insertion sort, the window is tiny
+  for(int i = 0; i < count; i++) {
+    double sample = samples[i];
+    int j = i;
+    while(j > 0 && sorted[j - 1] > sample) {
+      sorted[j] = sorted[j - 1];
+      j--;
+    }
+    sorted[j] = sample;
+  }
+  return sorted[count / 2];
+ }
+
+ // Returns the mean of the readings that agree with the median, -1 if the median is a miss
+ double MedianFilter::getEstimate() {
+  double median = getMedian();
+  double total = 0;
+  int used = 0;
+  if(median < 0) return -1.0;
+  for(int i = 0; i < count; i++) {
+    if(isClose(samples[i],median,tolerance)) {
+      total += samples[i];
+      used++;
+    }
+  }
+  return total / used;
+ }
+
+ class AlphaBetaFilter {
+  private:
+    float alpha; // How much of the error corrects the distance
+    float beta; // How much of the error corrects the rate
+    double distance; // Estimated distance (inches)
+    double rate; // Estimated change in distance (inches per second), negative when closing
+    unsigned long lastTime;
+    bool isStarted;
+    double gate; // Readings further than this (inches) from the prediction are thrown out
+    int maxMisses; // Misses and thrown out readings in a row ridden out on the prediction
+    int misses;
+  public:
+    AlphaBetaFilter(float alpha,float beta,double gate,int maxMisses);
+    void reset();
+    double update(double measurement,unsigned long timestamp);
+    double getDistance();
+    double getRate();
+ };
+
+ // Constructor
+ AlphaBetaFilter::AlphaBetaFilter(float alpha,float beta,double gate,int maxMisses) {
+  this->alpha = alpha;
+  this->beta = beta;
+  this->gate = gate;
+  this->maxMisses = maxMisses;
+  reset();
+ }
+
+ void AlphaBetaFilter::reset() {
+  distance = -1.0;
+  rate = 0;
+  lastTime = 0;
+  isStarted = false;
+  misses = 0;
+ }
+
+ // Adds a reading taken at timestamp (micros) and returns the new estimate, -1 once nothing is in range
+ double AlphaBetaFilter::update(double measurement,unsigned long timestamp) {
+  if(!isStarted) {
+    if(measurement < 0) return distance;
+    distance = measurement;
+    rate = 0;
+    isStarted = true;
+    lastTime = timestamp;
+    return distance;
+  }
+  double seconds = (timestamp - lastTime) / 1000000.0;
+  double predicted = distance + rate * seconds;
+  double error = measurement - predicted;
+  lastTime = timestamp;
+  // A miss or a reading out of the gate only moves the estimate on by the rate, until there are too many in a row
+  if(measurement < 0 || fabs(error) > gate) {
+    misses++;
+    if(misses <= maxMisses) {
+      distance = predicted;
+      return distance;
+    }
+    reset();
+    return update(measurement,timestamp);
+  }
+  misses = 0;
+  distance = predicted + alpha * error;
+  if(seconds > 0) rate += beta * error / seconds;
+  return distance;
+ }
+
+ double AlphaBetaFilter::getDistance() {
+  return distance;
+ }
+
+ double AlphaBetaFilter::getRate() {
+  return rate;
+ }
+#endif
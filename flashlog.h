@@ -0,0 +1,265 @@
+/* FlashLog class
+ * 18 October 2026
+ *
+ * Records the controller, actuator targets and eye readings to a raw flash partition
+ * (FLASH_LOG_PARTITION in partitions.csv), so there is something to look at when the car
+ * misbehaves in the field. The partition is a ring of pages in the format of logcodec.h, and
+ * the oldest sector is erased to make room once it is full.
+ *
+ * Records are encoded into a page in memory, so adding one never touches the flash. Full pages
+ * are queued (up to FLASH_LOG_QUEUE_PAGES) and a low priority task writes them one page per
+ * step. The ESP32 stalls both cores during a flash erase (about 45 ms a sector), so sectors are
+ * only erased ahead of the writes while setEraseAllowed() says the car is stopped,
+ * FLASH_LOG_ERASE_AHEAD at most, and FLASH_LOG_ERASE_SPACING_MILLIS apart so the control loop
+ * and the motion timer run in between. getEraseCount() lets the loop keep a pass an erase
+ * landed in out of its overrun count. A page write or erase that fails is counted and tried
+ * again on a later step.
+ * If the queue is full or nothing erased is left, records are dropped and counted rather than
+ * holding up the control loop.
+ *
+ * Only the control loop may add records. Read the partition back with esptool (see README.md)
+ * and replay it with the simulator (sim/README.md).
+ */
+
+#ifndef FLASHLOG_H
+#define FLASHLOG_H
+
+#include <atomic>
+#include "config.h"
+#include "hal.h"
+#include "logcodec.h"
+
+ class FlashLog {
+  private:
+    uint8_t queue[FLASH_LOG_QUEUE_PAGES][LOG_PAGE_SIZE];
+    std::atomic<unsigned long> head; // Pages queued by the loop, the page being filled is head % FLASH_LOG_QUEUE_PAGES
+    std::atomic<unsigned long> tail; // Pages written by the task
+    std::atomic<bool> isEraseAllowed;
+    LogEncoder encoder;
+    bool isEnabled;
+    bool isPageOpen;
+    unsigned long pageTime; // Time the open page was started (millis)
+    uint32_t sequence; // Sequence number of the next page
+    uint32_t flashSize;
+    uint32_t writePosition; // Offset of the next page to write
+    uint32_t erasedAhead; // Bytes from writePosition on that are erased
+    unsigned long recordsDropped;
+    unsigned long lastEraseTime; // Time the last sector erase started (millis)
+    std::atomic<unsigned long> eraseCount;
+    unsigned long flashErrors; // Page writes and sector erases that failed
+    byte lastController;
+    int32_t lastActuators[3];
+    bool openPage(unsigned long time);
+    void commitPage();
+    bool add(const LogRecord& record);
+    void resume();
+    bool writeStep();
+    static void taskStep(void* arg);
+  public:
+    FlashLog();
+    bool begin();
+    void logController(unsigned long time,byte controllerData);
+    void logActuators(unsigned long time,float speed,int steeringAngle,int eyeAngle);
+    void logDistance(unsigned long time,int angle,double distance);
+    void logScanPoint(unsigned long time,int angle,double distance);
+    void flush(unsigned long currentTime);
+    void setEraseAllowed(bool isAllowed);
+    void close();
+    bool isWriting();
+    unsigned long getPagesWritten();
+    unsigned long getRecordsDropped();
+    unsigned long getEraseCount();
+    unsigned long getFlashErrors();
+ };
+
+ // Constructor, nothing is recorded until begin()
+ FlashLog::FlashLog() : head(0), tail(0), isEraseAllowed(false), eraseCount(0) {
+  isEnabled = false;
+  isPageOpen = false;
+  pageTime = 0;
+  sequence = 0;
+  flashSize = 0;
+  writePosition = 0;
+  erasedAhead = 0;
+  recordsDropped = 0;
+  lastEraseTime = 0;
+  flashErrors = 0;
+  lastController = 0xFF;
+  for(int i = 0; i < 3; i++) lastActuators[i] = -1;
+ }
+
+ /* Opens the partition, carries on after the newest page already in it and starts the task
+  * that writes the pages. Returns false if there is no log partition, nothing is recorded then.
+  */
+ bool FlashLog::begin() {
+  flashSize = halFlashBegin(FLASH_LOG_PARTITION);
+  flashSize -= flashSize % HAL_FLASH_SECTOR_SIZE;
+  if(flashSize < (FLASH_LOG_ERASE_AHEAD + 1) * HAL_FLASH_SECTOR_SIZE) return false;
+  resume();
+  isEnabled = halStartTask(taskStep,this,"flashlog",FLASH_LOG_TASK_STACK,FLASH_LOG_TASK_PRIORITY,FLASH_LOG_CORE,
+    FLASH_LOG_TASK_PERIOD_MILLIS);
+  return isEnabled;
+ }
+
+ /* Finds the newest page from the first page of each sector, then the end of the pages in
+  * that sector. The rest of that sector is still erased, everything else may not be.
+  */
+ void FlashLog::resume() {
+  uint8_t header[LOG_PAGE_HEADER];
+  LogDecoder decoder;
+  bool isFound = false;
+  uint32_t newestSector = 0;
+  uint32_t newestSequence = 0;
+
+  for(uint32_t sector = 0; sector < flashSize; sector += HAL_FLASH_SECTOR_SIZE) {
+    halFlashRead(sector,header,LOG_PAGE_HEADER);
+    if(!decoder.beginPage(header)) continue;
+    if(!isFound || (int32_t)(decoder.getSequence() - newestSequence) > 0) {
+      isFound = true;
+      newestSector = sector;
+      newestSequence = decoder.getSequence();
+    }
+  }
+  if(!isFound) return;
+
+  writePosition = newestSector;
+  sequence = newestSequence;
+  while(writePosition < newestSector + HAL_FLASH_SECTOR_SIZE) {
+    halFlashRead(writePosition,header,LOG_PAGE_HEADER);
+    if(!decoder.beginPage(header)) break;
+    sequence = decoder.getSequence() + 1;
+    writePosition += LOG_PAGE_SIZE;
+  }
+  erasedAhead = newestSector + HAL_FLASH_SECTOR_SIZE - writePosition;
+  writePosition %= flashSize;
+ }
+
+ // Starts a page in the queue, returns false if the queue is full
+ bool FlashLog::openPage(unsigned long time) {
+  if(head - tail >= (unsigned long)FLASH_LOG_QUEUE_PAGES) return false;
+  encoder.beginPage(queue[head % FLASH_LOG_QUEUE_PAGES],sequence++,time);
+  pageTime = time;
+  isPageOpen = true;
+  return true;
+ }
+
+ // Hands the open page to the task
+ void FlashLog::commitPage() {
+  head++;
+  isPageOpen = false;
+ }
+
+ // Adds a record to the open page, starting a new page if it is full. Returns false if it was dropped
+ bool FlashLog::add(const LogRecord& record) {
+  if(!isEnabled) return false;
+  if(isPageOpen && encoder.add(record)) return true;
+  if(isPageOpen) commitPage();
+  if(openPage(record.time) && encoder.add(record)) return true;
+  recordsDropped++;
+  return false;
+ }
+
+ // Records the controller buttons, only when they change
+ void FlashLog::logController(unsigned long time,byte controllerData) {
+  if(controllerData == lastController) return;
+  LogRecord record = {LOG_CONTROLLER,time,{controllerData,0,0}};
+  if(add(record)) lastController = controllerData;
+ }
+
+ // Records the actuator targets, only when they change
+ void FlashLog::logActuators(unsigned long time,float speed,int steeringAngle,int eyeAngle) {
+  LogRecord record = {LOG_ACTUATORS,time,{(int32_t)(speed * 100),steeringAngle,eyeAngle}};
+  if(memcmp(record.values,lastActuators,sizeof(lastActuators)) == 0) return;
+  if(add(record)) memcpy(lastActuators,record.values,sizeof(lastActuators));
+ }
+
+ // Records a reading from the eye when it is not sweeping (distance in inches, -1 if nothing in range)
+ void FlashLog::logDistance(unsigned long time,int angle,double distance) {
+  LogRecord record = {LOG_DISTANCE,time,{angle,logTenths(distance),0}};
+  add(record);
+ }
+
+ // Records one reading of a sweep, as it arrives
+ void FlashLog::logScanPoint(unsigned long time,int angle,double distance) {
+  LogRecord record = {LOG_SCAN_POINT,time,{angle,logTenths(distance),0}};
+  add(record);
+ }
+
+ // Queues a part filled page once it is old enough, so a quiet log still reaches the flash
+ void FlashLog::flush(unsigned long currentTime) {
+  if(isPageOpen && currentTime - pageTime >= (unsigned long)FLASH_LOG_FLUSH_MILLIS) commitPage();
+ }
+
+ // Erasing stalls both cores, so it is only allowed while the car is stopped
+ void FlashLog::setEraseAllowed(bool isAllowed) {
+  isEraseAllowed = isAllowed;
+ }
+
+ // Step of the task
+ void FlashLog::taskStep(void* arg) {
+  ((FlashLog*)arg)->writeStep();
+ }
+
+ /* Writes one queued page, or erases one sector ahead if there is nothing to write. Returns
+  * false if there was nothing it could do, or the flash refused it.
+  */
+ bool FlashLog::writeStep() {
+  if(tail != head && erasedAhead >= (uint32_t)LOG_PAGE_SIZE) {
+    if(!halFlashWrite(writePosition,queue[tail % FLASH_LOG_QUEUE_PAGES],LOG_PAGE_SIZE)) {
+      flashErrors++;
+      return false;
+    }
+    writePosition = (writePosition + LOG_PAGE_SIZE) % flashSize;
+    erasedAhead -= LOG_PAGE_SIZE;
+    tail++;
+    return true;
+  }
+  // Pages are sector aligned at the end of the erased part, so this is the start of a sector
+  if(isEraseAllowed && erasedAhead < (uint32_t)FLASH_LOG_ERASE_AHEAD * HAL_FLASH_SECTOR_SIZE &&
+    halMillis() - lastEraseTime >= (unsigned long)FLASH_LOG_ERASE_SPACING_MILLIS) {
+    lastEraseTime = halMillis();
+    eraseCount++;
+    if(!halFlashErase((writePosition + erasedAhead) % flashSize,HAL_FLASH_SECTOR_SIZE)) {
+      flashErrors++;
+      return false;
+    }
+    erasedAhead += HAL_FLASH_SECTOR_SIZE;
+    return true;
+  }
+  return false;
+ }
+
+ /* Queues the page being filled and lets the task erase whatever it needs to write everything.
+  * For the end of a run or before the power is turned off, wait for isWriting() to be false.
+  */
+ void FlashLog::close() {
+  if(!isEnabled) return;
+  if(isPageOpen) commitPage();
+  isEraseAllowed = true;
+ }
+
+ // Returns true while there are pages waiting to be written
+ bool FlashLog::isWriting() {
+  return tail != head;
+ }
+
+ // Returns the number of pages written to the flash since begin()
+ unsigned long FlashLog::getPagesWritten() {
+  return tail;
+ }
+
+ // Returns the number of records dropped because the queue was full or nothing was erased
+ unsigned long FlashLog::getRecordsDropped() {
+  return recordsDropped;
+ }
+
+ // Returns the number of sector erases started, each one stalls both cores
+ unsigned long FlashLog::getEraseCount() {
+  return eraseCount;
+ }
+
+ // Returns the number of page writes and sector erases the flash refused
+ unsigned long FlashLog::getFlashErrors() {
+  return flashErrors;
+ }
+#endif
@@ -0,0 +1,365 @@
+/* Hardware Abstraction Layer (HAL)
+ * 18 October 2026
+ * 
+ * Every class talks to the hardware through these functions instead of calling the
+ * Arduino/ESP32 functions directly. On the car they are thin inline wrappers that compile
+ * down to the same calls as before. When ARC_SIMULATOR is defined they are routed to the
+ * simulated board in sim/, which has a virtual clock, so the same headers and ARC.ino can
+ * be run and profiled on a PC (see sim/README.md).
+ */ 
+
+#ifndef HAL_H
+#define HAL_H
+
+#include <Arduino.h>
+
+#ifdef ARC_SIMULATOR
+#include "simboard.h"
+#else
+#include "soc/gpio_struct.h"
+#include "esp_partition.h"
+#include "esp_timer.h"
+#include "esp_task_wdt.h"
+#include "driver/gpio.h"
+#endif
+
+ // Function run over and over by a task started with halStartTask()
+ typedef void (*HalTaskStep)(void* arg);
+
+ // Most tasks that can be started with halStartTask()
+ const int HAL_MAX_TASKS = 4;
+
+ // Function called by a timer started with halStartTimer()
+ typedef void (*HalTimerHandler)(void* arg);
+
+ // Smallest part of the flash that can be erased
+ const uint32_t HAL_FLASH_SECTOR_SIZE = 4096;
+
+ // Pin with its GPIO register bit worked out once, for halFastWrite() and halFastRead()
+ struct HalFastPin {
+  int pin;
+  uint32_t mask;
+  bool isHighBank; // GPIO 32 to 39 are in a second set of registers
+ };
+
+#ifndef ARC_SIMULATOR
+
+ // Holds what a task needs to run its step function
+ struct HalTask {
+  HalTaskStep step;
+  void* arg;
+  TickType_t period;
+ };
+
+ // Body of every task started with halStartTask()
+ inline void halTaskLoop(void* arg) {
+  HalTask* task = (HalTask*)arg;
+  for(;;) {
+    task->step(task->arg);
+    vTaskDelay(task->period);
+  }
+ }
+
+#endif
+
+ // Digital pins
+ inline void halPinMode(int pin,int mode) {
+#ifdef ARC_SIMULATOR
+  SimBoard::get().setPinMode(pin,mode);
+#else
+  pinMode(pin,mode);
+#endif
+ }
+
+ inline void halWritePin(int pin,int value) {
+#ifdef ARC_SIMULATOR
+  SimBoard::get().writePin(pin,value);
+#else
+  digitalWrite(pin,value);
+#endif
+ }
+
+ inline int halReadPin(int pin) {
+#ifdef ARC_SIMULATOR
+  return SimBoard::get().readPin(pin);
+#else
+  return digitalRead(pin);
+#endif
+ }
+
+ // Counts of output writes made and skipped because the output would not have changed
+ struct OutputStats {
+  unsigned long writeCount;
+  unsigned long elidedCount;
+ };
+
+ // Shared by every output (PWM channels and motor direction pins), the counts are not atomic so
+ // writes from the sensing core can occasionally be missed
+ inline OutputStats& getOutputStats() {
+  static OutputStats stats = {0,0};
+  return stats;
+ }
+
+ /* Fast pins skip the checks and pin lookup of digitalWrite() and digitalRead(), a write is a
+  * single store to the GPIO set or clear register. A write only sets the output level, so the
+  * begin() functions write the level first and set the pin mode after, and the pin comes up
+  * driving that level. A read needs the pin to be an input already.
+  */
+ inline HalFastPin halFastPin(int pin) {
+  HalFastPin fastPin;
+  fastPin.pin = pin;
+  fastPin.isHighBank = pin >= 32;
+  fastPin.mask = pin < 0 ? 0 : 1UL << (pin & 31); // An unused pin (-1) writes nothing
+  return fastPin;
+ }
+
+ inline void IRAM_ATTR halFastWrite(const HalFastPin& pin,int value) {
+#ifdef ARC_SIMULATOR
+  SimBoard::get().writePin(pin.pin,value,SIM_COST_FAST_PIN);
+#else
+  if(pin.isHighBank) {
+    if(value) GPIO.out1_w1ts.val = pin.mask;
+    else GPIO.out1_w1tc.val = pin.mask;
+  }
+  else {
+    if(value) GPIO.out_w1ts = pin.mask;
+    else GPIO.out_w1tc = pin.mask;
+  }
+#endif
+ }
+
+ inline int IRAM_ATTR halFastRead(const HalFastPin& pin) {
+#ifdef ARC_SIMULATOR
+  return SimBoard::get().readPin(pin.pin,SIM_COST_FAST_PIN);
+#else
+  if(pin.isHighBank) return (GPIO.in1.data & pin.mask) ? HIGH : LOW;
+  return (GPIO.in & pin.mask) ? HIGH : LOW;
+#endif
+ }
+
+ /* Calls handler(arg) from an interrupt when the pin changes (mode is RISING, FALLING or CHANGE).
+  * The GPIO interrupt is registered with ESP_INTR_FLAG_IRAM, so it still runs while the flash
+  * is being written or erased and the cache is off. The handler and everything it calls must be
+  * IRAM_ATTR (or inline) and only touch data in RAM, otherwise the car crashes on the first
+  * echo that lands during a flash write.
+  */
+ inline void halAttachInterrupt(int pin,void (*handler)(void*),void* arg,int mode) {
+#ifdef ARC_SIMULATOR
+  SimBoard::get().attachInterrupt(pin,handler,arg,mode);
+#else
+  // Only the first call installs the service, later ones return ESP_ERR_INVALID_STATE
+  gpio_install_isr_service(ESP_INTR_FLAG_IRAM);
+  gpio_set_intr_type((gpio_num_t)pin,mode == RISING ? GPIO_INTR_POSEDGE : (mode == FALLING ? GPIO_INTR_NEGEDGE : GPIO_INTR_ANYEDGE));
+  gpio_isr_handler_add((gpio_num_t)pin,handler,arg);
+  gpio_intr_enable((gpio_num_t)pin);
+#endif
+ }
+
+ // Returns the length of a pulse in microseconds, 0 if it did not complete within the timeout
+ inline unsigned long halPulseIn(int pin,int state,unsigned long timeout) {
+#ifdef ARC_SIMULATOR
+  return SimBoard::get().pulseIn(pin,state,timeout);
+#else
+  return pulseIn(pin,state,timeout);
+#endif
+ }
+
+ // PWM (LEDC)
+ inline void halPWMSetup(int channel,int frequency,int resolution) {
+#ifdef ARC_SIMULATOR
+  SimBoard::get().pwmSetup(channel,frequency,resolution);
+#else
+  ledcSetup(channel,frequency,resolution);
+#endif
+ }
+
+ inline void halPWMAttach(int pin,int channel) {
+#ifdef ARC_SIMULATOR
+  SimBoard::get().pwmAttach(pin,channel);
+#else
+  ledcAttachPin(pin,channel);
+#endif
+ }
+
+ inline void halPWMWrite(int channel,uint32_t dutyCycle) {
+#ifdef ARC_SIMULATOR
+  SimBoard::get().pwmWrite(channel,dutyCycle);
+#else
+  ledcWrite(channel,dutyCycle);
+#endif
+ }
+
+ // Time, halMicros() is safe to call from an IRAM interrupt (esp_timer_get_time() is in IRAM, micros() may not be)
+ inline unsigned long IRAM_ATTR halMicros() {
+#ifdef ARC_SIMULATOR
+  return SimBoard::get().micros();
+#else
+  return (unsigned long)esp_timer_get_time();
+#endif
+ }
+
+ inline unsigned long halMillis() {
+#ifdef ARC_SIMULATOR
+  return SimBoard::get().micros() / 1000;
+#else
+  return millis();
+#endif
+ }
+
+ inline void halDelay(unsigned long milliseconds) {
+#ifdef ARC_SIMULATOR
+  SimBoard::get().delayMillis(milliseconds);
+#else
+  delay(milliseconds);
+#endif
+ }
+
+ inline void halDelayMicros(unsigned long microseconds) {
+#ifdef ARC_SIMULATOR
+  SimBoard::get().delayMicros(microseconds);
+#else
+  delayMicroseconds(microseconds);
+#endif
+ }
+
+ // Returns the CPU cycle counter, which wraps around every few seconds
+ inline uint32_t halCycleCount() {
+#ifdef ARC_SIMULATOR
+  return SimBoard::get().getCycleCount();
+#else
+  return ESP.getCycleCount();
+#endif
+ }
+
+ // Returns the current time in RTOS ticks (milliseconds)
+ inline unsigned long halTicks() {
+#ifdef ARC_SIMULATOR
+  return SimBoard::get().micros() / 1000;
+#else
+  return xTaskGetTickCount();
+#endif
+ }
+
+ // Waits until period ticks after *lastTick, then advances *lastTick by the period
+ inline void halDelayUntil(unsigned long* lastTick,unsigned long period) {
+#ifdef ARC_SIMULATOR
+  SimBoard::get().delayUntilMicros(((unsigned long long)*lastTick + period) * 1000);
+  *lastTick += period;
+#else
+  TickType_t tick = *lastTick;
+  vTaskDelayUntil(&tick,period);
+  *lastTick = tick;
+#endif
+ }
+
+ /* Runs step(arg) over and over on the given core, waiting periodMillis between calls so
+  * lower priority tasks on that core can run. Returns false if the task could not be started.
+  * The simulator runs the step on its virtual clock, as if on a second core.
+  */
+ inline bool halStartTask(HalTaskStep step,void* arg,const char* name,int stackSize,int priority,int core,int periodMillis) {
+#ifdef ARC_SIMULATOR
+  return SimBoard::get().startTask(step,arg,periodMillis * 1000000ULL);
+#else
+  static HalTask tasks[HAL_MAX_TASKS];
+  static int taskCount = 0;
+  if(taskCount == HAL_MAX_TASKS) return false;
+  HalTask* task = &tasks[taskCount++];
+  task->step = step;
+  task->arg = arg;
+  task->period = pdMS_TO_TICKS(periodMillis);
+  return xTaskCreatePinnedToCore(halTaskLoop,name,stackSize,task,priority,NULL,core) == pdPASS;
+#endif
+ }
+
+ /* Calls handler(arg) every periodMicros from a hardware timer, whatever the loop and tasks are
+  * doing. On the ESP32 this is an esp_timer, dispatched from its own high priority task rather
+  * than an interrupt, so the handler may use floating point and write PWM channels but must be
+  * short. Returns false if the timer could not be started. The simulator runs the handler on
+  * its virtual clock like a task step.
+  */
+ inline bool halStartTimer(HalTimerHandler handler,void* arg,const char* name,unsigned long periodMicros) {
+#ifdef ARC_SIMULATOR
+  return SimBoard::get().startTask(handler,arg,periodMicros * 1000ULL);
+#else
+  esp_timer_create_args_t timerArgs = {};
+  esp_timer_handle_t timer;
+  timerArgs.callback = handler;
+  timerArgs.arg = arg;
+  timerArgs.dispatch_method = ESP_TIMER_TASK;
+  timerArgs.name = name;
+  timerArgs.skip_unhandled_events = true; // A late call is not made up for, the handler uses the time that passed
+  if(esp_timer_create(&timerArgs,&timer) != ESP_OK) return false;
+  return esp_timer_start_periodic(timer,periodMicros) == ESP_OK;
+#endif
+ }
+
+ /* Starts the task watchdog for the calling task, which must then call halWatchdogFeed() at
+  * least every timeoutMillis or the ESP32 resets. The timeout is rounded up to whole seconds
+  * on the ESP32. Returns false if the watchdog could not be started. The simulator times the
+  * gaps between feeds instead of resetting.
+  */
+ inline bool halWatchdogBegin(unsigned long timeoutMillis) {
+#ifdef ARC_SIMULATOR
+  SimBoard::get().watchdogBegin(timeoutMillis * 1000000ULL);
+  return true;
+#else
+  // Reconfigures the watchdog if the Arduino core already started it for the idle tasks
+  esp_task_wdt_init((timeoutMillis + 999) / 1000,true);
+  return esp_task_wdt_add(NULL) == ESP_OK;
+#endif
+ }
+
+ inline void halWatchdogFeed() {
+#ifdef ARC_SIMULATOR
+  SimBoard::get().watchdogFeed();
+#else
+  esp_task_wdt_reset();
+#endif
+ }
+
+#ifndef ARC_SIMULATOR
+ // Partition opened by halFlashBegin()
+ inline const esp_partition_t*& halFlashPartition() {
+  static const esp_partition_t* partition = 0;
+  return partition;
+ }
+#endif
+
+ /* Raw flash, in the data partition with this label (see partitions.csv). Returns the size of
+  * the partition, 0 if there is none. Offsets are from the start of the partition, erases are
+  * whole HAL_FLASH_SECTOR_SIZE sectors. The ESP32 stalls both cores while it writes or erases
+  * flash, so an erase (tens of milliseconds) should only be done when nothing is moving.
+  */
+ inline uint32_t halFlashBegin(const char* label) {
+#ifdef ARC_SIMULATOR
+  return SimBoard::get().getFlashSize();
+#else
+  halFlashPartition() = esp_partition_find_first(ESP_PARTITION_TYPE_DATA,ESP_PARTITION_SUBTYPE_ANY,label);
+  return halFlashPartition() ? halFlashPartition()->size : 0;
+#endif
+ }
+
+ inline bool halFlashErase(uint32_t offset,uint32_t length) {
+#ifdef ARC_SIMULATOR
+  return SimBoard::get().flashErase(offset,length);
+#else
+  return halFlashPartition() && esp_partition_erase_range(halFlashPartition(),offset,length) == ESP_OK;
+#endif
+ }
+
+ inline bool halFlashWrite(uint32_t offset,const void* data,uint32_t length) {
+#ifdef ARC_SIMULATOR
+  return SimBoard::get().flashWrite(offset,data,length);
+#else
+  return halFlashPartition() && esp_partition_write(halFlashPartition(),offset,data,length) == ESP_OK;
+#endif
+ }
+
+ inline bool halFlashRead(uint32_t offset,void* data,uint32_t length) {
+#ifdef ARC_SIMULATOR
+  return SimBoard::get().flashRead(offset,data,length);
+#else
+  return halFlashPartition() && esp_partition_read(halFlashPartition(),offset,data,length) == ESP_OK;
+#endif
+ }
+#endif
@@ -0,0 +1,229 @@
+/* Log codec
+ * 18 October 2026
+ *
+ * Encoding of the flash log (flashlog.h), shared by the firmware and the simulator's replay so
+ * both sides always agree on the format. The log is a series of LOG_PAGE_SIZE pages, one
+ * flash page each. The delta state starts again with every page, so each page can be decoded
+ * on its own and losing the oldest pages to the ring only loses their records.
+ *
+ * Page format (header values are little endian):
+ *   [0..1]  LOG_PAGE_MAGIC
+ *   [2..5]  u32 sequence, increases by one per page
+ *   [6..9]  u32 time of the page start (millis)
+ *   [10..]  records, then 0xFF (erased flash) up to the end of the page
+ *
+ * Record: u8 type (LogRecordType), varint time since the last record (millis), then each
+ * value as a zigzag varint of its change from the last record of the same type:
+ *   CONTROLLER  buttons
+ *   ACTUATORS   speed (percent), steering angle, eye angle
+ *   DISTANCE    eye angle, distance (tenths of an inch, -1 if nothing in range)
+ *   SCAN_POINT  angle, distance (tenths of an inch, -1 if nothing in range)
+ * Varints are 7 bits per byte, lowest first, with the top bit set on all but the last byte.
+ */
+
+#ifndef LOGCODEC_H
+#define LOGCODEC_H
+
+#include <stdint.h>
+#include <string.h>
+
+ const int LOG_PAGE_SIZE = 256; // One flash page
+ const uint16_t LOG_PAGE_MAGIC = 0x4C41; // "AL"
+ const int LOG_PAGE_HEADER = 10;
+ const int LOG_MAX_VALUES = 3;
+ const int LOG_MAX_RECORD = 1 + 5 + 5 * LOG_MAX_VALUES; // Type, time and values at their longest
+
+ enum LogRecordType {
+  LOG_CONTROLLER = 1,
+  LOG_ACTUATORS,
+  LOG_DISTANCE,
+  LOG_SCAN_POINT,
+  LOG_TYPE_COUNT
+ };
+
+ struct LogRecord {
+  int type; // LogRecordType
+  unsigned long time; // Millis
+  int32_t values[LOG_MAX_VALUES];
+ };
+
+ // Returns the number of values in a record of this type, 0 if the type is unknown
+ inline int logValueCount(int type) {
+  switch(type) {
+    case LOG_CONTROLLER: return 1;
+    case LOG_ACTUATORS: return 3;
+    case LOG_DISTANCE: return 2;
+    case LOG_SCAN_POINT: return 2;
+  }
+  return 0;
+ }
+
+ // Converts a distance in inches (-1 if nothing in range) to the tenths stored in the log
+ inline int32_t logTenths(double distance) {
+  if(distance < 0) return -1;
+  return (int32_t)(distance * 10 + 0.5);
+ }
+
+ // Writes records into a page, see the format above
+ class LogEncoder {
+  private:
+    uint8_t* page;
+    int length;
+    unsigned long lastTime;
+    int32_t last[LOG_TYPE_COUNT][LOG_MAX_VALUES]; // Values of the last record of each type
+    static int putVarint(uint8_t* data,uint32_t value);
+  public:
+    LogEncoder();
+    void beginPage(uint8_t* page,uint32_t sequence,unsigned long time);
+    bool add(const LogRecord& record);
+    int getLength();
+ };
+
+ // Reads records back out of a page
+ class LogDecoder {
+  private:
+    const uint8_t* page;
+    int position;
+    uint32_t sequence;
+    unsigned long lastTime;
+    int32_t last[LOG_TYPE_COUNT][LOG_MAX_VALUES];
+    bool getVarint(uint32_t* value);
+  public:
+    LogDecoder();
+    bool beginPage(const uint8_t* page);
+    bool next(LogRecord* record);
+    uint32_t getSequence();
+    unsigned long getStartTime();
+ };
+
+ // Constructor
+ LogEncoder::LogEncoder() {
+  page = 0;
+  length = 0;
+  lastTime = 0;
+ }
+
+ // Starts a new page in memory, erased (0xFF) except for the header
+ void LogEncoder::beginPage(uint8_t* page,uint32_t sequence,unsigned long time) {
+  this->page = page;
+  memset(page,0xFF,LOG_PAGE_SIZE);
+  page[0] = LOG_PAGE_MAGIC & 0xFF;
+  page[1] = LOG_PAGE_MAGIC >> 8;
+  for(int i = 0; i < 4; i++) {
+    page[2 + i] = (sequence >> (8 * i)) & 0xFF;
+    page[6 + i] = (time >> (8 * i)) & 0xFF;
+  }
+  length = LOG_PAGE_HEADER;
+  lastTime = time;
+  memset(last,0,sizeof(last));
+ }
+
+ // Adds a record to the page, returns false if it does not fit (the page is left as it was)
+ bool LogEncoder::add(const LogRecord& record) {
+  uint8_t data[LOG_MAX_RECORD];
+  int count = logValueCount(record.type);
+  if(page == 0 || count == 0) return false;
+
+  int size = 0;
+  data[size++] = record.type;
+  size += putVarint(data + size,record.time - lastTime);
+  for(int i = 0; i < count; i++) {
+    // Zigzag puts small changes either way into small numbers: 0,-1,1,-2 become 0,1,2,3
+    int32_t change = record.values[i] - last[record.type][i];
+    size += putVarint(data + size,((uint32_t)change << 1) ^ (uint32_t)(change >> 31));
+  }
+  if(length + size > LOG_PAGE_SIZE) return false;
+
+  memcpy(page + length,data,size);
+  length += size;
+  lastTime = record.time;
+  for(int i = 0; i < count; i++) last[record.type][i] = record.values[i];
+  return true;
+ }
+
+ // Returns the bytes used in the page so far
+ int LogEncoder::getLength() {
+  return length;
+ }
+
+ // Writes a varint, returns the number of bytes written (at most 5)
+ int LogEncoder::putVarint(uint8_t* data,uint32_t value) {
+  int size = 0;
+  while(value >= 0x80) {
+    data[size++] = (value & 0x7F) | 0x80;
+    value >>= 7;
+  }
+  data[size++] = value;
+  return size;
+ }
+
+ // Constructor
+ LogDecoder::LogDecoder() {
+  page = 0;
+  position = 0;
+  sequence = 0;
+  lastTime = 0;
+ }
+
+ // Starts reading a page, returns false if it is not a log page (erased or something else)
+ bool LogDecoder::beginPage(const uint8_t* page) {
+  if((page[0] | (page[1] << 8)) != LOG_PAGE_MAGIC) return false;
+  this->page = page;
+  sequence = 0;
+  lastTime = 0;
+  for(int i = 0; i < 4; i++) {
+    sequence |= (uint32_t)page[2 + i] << (8 * i);
+    lastTime |= (unsigned long)page[6 + i] << (8 * i);
+  }
+  position = LOG_PAGE_HEADER;
+  memset(last,0,sizeof(last));
+  return true;
+ }
+
+ // Reads the next record, returns false at the end of the page or if the rest cannot be read
+ bool LogDecoder::next(LogRecord* record) {
+  if(page == 0 || position >= LOG_PAGE_SIZE) return false;
+  int type = page[position];
+  int count = logValueCount(type);
+  if(count == 0) return false;
+  position++;
+
+  uint32_t value;
+  if(!getVarint(&value)) return false;
+  lastTime += value;
+  record->type = type;
+  record->time = lastTime;
+  for(int i = 0; i < LOG_MAX_VALUES; i++) {
+    if(i >= count) {
+      record->values[i] = 0;
+      continue;
+    }
+    if(!getVarint(&value)) return false;
+    last[type][i] += (int32_t)(value >> 1) ^ -(int32_t)(value & 1);
+    record->values[i] = last[type][i];
+  }
+  return true;
+ }
+
+ // Returns the sequence number of the page being read
+ uint32_t LogDecoder::getSequence() {
+  return sequence;
+ }
+
+ // Returns the time of the first record of the page being read, before next() is called
+ unsigned long LogDecoder::getStartTime() {
+  return lastTime;
+ }
+
+ // Reads a varint, returns false if it runs off the end of the page
+ bool LogDecoder::getVarint(uint32_t* value) {
+  *value = 0;
+  for(int shift = 0; shift < 35; shift += 7) {
+    if(position >= LOG_PAGE_SIZE) return false;
+    uint8_t data = page[position++];
+    *value |= (uint32_t)(data & 0x7F) << shift;
+    if(!(data & 0x80)) return true;
+  }
+  return false;
+ }
+#endif
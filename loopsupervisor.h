@@ -0,0 +1,287 @@
+/* LoopSupervisor class
+ * 18 October 2026
+ *
+ * Holds the control loop to its deadline. Each pass of loop() is timed as a whole, and the
+ * stages that can run long (the controller read, the response, a sensing step without a core
+ * of its own, and the report) are timed against their own budgets. A pass or stage that runs
+ * over is counted, so a slow echo or sweep that stretches the loop shows up instead of going
+ * unnoticed.
+ *
+ * Overruns are counted over windows of SUPERVISOR_WINDOW_TICKS passes. A window with
+ * SUPERVISOR_DEGRADE_OVERRUNS or more steps the car down to a cheaper way of running, one
+ * level per window: fewer telemetry frames, then fewer readings per sweep, then a single
+ * ping straight ahead instead of sweeping. After SUPERVISOR_RECOVER_WINDOWS windows in a row
+ * without an overrun it steps back up a level. The loop applies the level, the supervisor
+ * only decides it.
+ *
+ * A pass the loop has excused with excuseTick() (a flash erase stalled both cores during it)
+ * is counted apart if it runs over, and does not count towards stepping down.
+ *
+ * The supervisor also watches the snapshots from the sensing side. If none arrives for
+ * SENSING_STALL_MILLIS the sensors are taken to be wedged, and the loop stops the car rather
+ * than drive blind. The loop itself being wedged is left to the task watchdog
+ * (halWatchdogBegin()), which resets the ESP32 into setup() with the motor braked.
+ */
+
+#ifndef LOOPSUPERVISOR_H
+#define LOOPSUPERVISOR_H
+
+#include "config.h"
+#include "hal.h"
+
+ // Stages of the loop with a budget of their own
+ enum SuperviseStage {
+  SUPERVISE_CONTROLLER, // Controller read
+  SUPERVISE_RESPOND,    // Buttons or the obstacle map turned into targets
+  SUPERVISE_SENSING,    // A sensing step in loop(), when the eye has no core of its own
+  SUPERVISE_REPORT,     // Telemetry and the flash log
+  SUPERVISE_STAGE_COUNT
+ };
+
+ const char* const SUPERVISE_STAGE_NAMES[SUPERVISE_STAGE_COUNT] = {
+  "controller","respond","sensing","report"
+ };
+
+ // Ways of running, each cheaper than the one before
+ enum DegradeLevel {
+  DEGRADE_NONE,        // Everything as configured
+  DEGRADE_TELEMETRY,   // Controller and actuator frames sent less often
+  DEGRADE_DIVISIONS,   // Fewer readings per sweep
+  DEGRADE_SINGLE_PING, // The eye pings where it points instead of sweeping
+  DEGRADE_LEVEL_COUNT
+ };
+
+ const char* const DEGRADE_LEVEL_NAMES[DEGRADE_LEVEL_COUNT] = {
+  "none","telemetry","divisions","single ping"
+ };
+
+ class LoopSupervisor {
+  private:
+    unsigned long deadline; // Longest pass of the loop (micros)
+    unsigned long budgets[SUPERVISE_STAGE_COUNT]; // Longest time for each stage (micros)
+    unsigned long stageOverruns[SUPERVISE_STAGE_COUNT];
+    unsigned long tickOverruns;
+    unsigned long excusedOverruns; // Passes over the deadline that were excused
+    bool isExcused; // True if the pass under way was excused
+    unsigned long tickCount;
+    unsigned long maxTickTime;
+    unsigned long tickStart;
+    unsigned long stageStart;
+    int windowTicks; // Passes so far in this window
+    int windowOverruns; // Passes over the deadline so far in this window
+    int cleanWindows; // Windows in a row without an overrun
+    DegradeLevel level;
+    DegradeLevel maxLevel;
+    unsigned long lastSequence; // Sequence of the last sensor snapshot seen
+    unsigned long lastSequenceTime; // Time it was first seen (millis)
+    bool isStalled;
+    unsigned long stallCount;
+  public:
+    LoopSupervisor(unsigned long periodMicros,int deadlinePercent);
+    void setPeriod(unsigned long periodMicros,int deadlinePercent);
+    void setBudget(SuperviseStage stage,unsigned long budgetMicros);
+    void begin();
+    void startTick();
+    void startStage();
+    void endStage(SuperviseStage stage);
+    void excuseTick();
+    bool endTick();
+    DegradeLevel getLevel();
+    DegradeLevel getMaxLevel();
+    unsigned long getTickCount();
+    unsigned long getTickOverruns();
+    unsigned long getExcusedOverruns();
+    unsigned long getStageOverruns(SuperviseStage stage);
+    unsigned long getMaxTickTime();
+    void watchSensing(unsigned long sequence);
+    bool isSensingStalled();
+    unsigned long getStallCount();
+    template <typename Output> void dump(Output& output);
+ };
+
+ /* Constructor, a pass of the loop may take deadlinePercent of periodMicros. The stages have
+  * no budget until one is set.
+  */
+ LoopSupervisor::LoopSupervisor(unsigned long periodMicros,int deadlinePercent) {
+  setPeriod(periodMicros,deadlinePercent);
+  for(int i = 0; i < SUPERVISE_STAGE_COUNT; i++) {
+    budgets[i] = 0;
+    stageOverruns[i] = 0;
+  }
+  tickOverruns = 0;
+  excusedOverruns = 0;
+  isExcused = false;
+  tickCount = 0;
+  maxTickTime = 0;
+  tickStart = 0;
+  stageStart = 0;
+  windowTicks = 0;
+  windowOverruns = 0;
+  cleanWindows = 0;
+  level = DEGRADE_NONE;
+  maxLevel = DEGRADE_NONE;
+  lastSequence = 0;
+  lastSequenceTime = 0;
+  isStalled = false;
+  stallCount = 0;
+ }
+
+ // Changes the control period the deadline is worked out from
+ void LoopSupervisor::setPeriod(unsigned long periodMicros,int deadlinePercent) {
+  deadline = periodMicros * deadlinePercent / 100;
+ }
+
+ // Sets the longest time a stage may take, 0 stops it being checked
+ void LoopSupervisor::setBudget(SuperviseStage stage,unsigned long budgetMicros) {
+  budgets[stage] = budgetMicros;
+ }
+
+ // Called at the end of setup(), the sensing side has had no time to publish before then
+ void LoopSupervisor::begin() {
+  lastSequenceTime = halMillis();
+ }
+
+ // Called at the top of loop()
+ void LoopSupervisor::startTick() {
+  tickStart = halMicros();
+  stageStart = tickStart;
+ }
+
+ void LoopSupervisor::startStage() {
+  stageStart = halMicros();
+ }
+
+ // Checks the time since startStage() (or startTick()) against the stage's budget
+ void LoopSupervisor::endStage(SuperviseStage stage) {
+  unsigned long now = halMicros();
+  if(budgets[stage] != 0 && now - stageStart > budgets[stage]) stageOverruns[stage]++;
+  stageStart = now;
+ }
+
+ // Keeps the pass under way out of the overrun count, for a stall the loop had no part in
+ void LoopSupervisor::excuseTick() {
+  isExcused = true;
+ }
+
+ /* Called at the end of loop(), before any wait for the next period. Checks the pass against
+  * the deadline, and at the end of each window decides the degrade level. Returns true if the
+  * level changed.
+  */
+ bool LoopSupervisor::endTick() {
+  unsigned long tickTime = halMicros() - tickStart;
+  tickCount++;
+  if(tickTime > maxTickTime) maxTickTime = tickTime;
+  if(tickTime > deadline && isExcused) {
+    excusedOverruns++;
+  }
+  else if(tickTime > deadline) {
+    tickOverruns++;
+    windowOverruns++;
+  }
+  isExcused = false;
+  if(++windowTicks < SUPERVISOR_WINDOW_TICKS) return false;
+
+  DegradeLevel lastLevel = level;
+  if(windowOverruns >= SUPERVISOR_DEGRADE_OVERRUNS) {
+    cleanWindows = 0;
+    if(level < DEGRADE_LEVEL_COUNT - 1) level = (DegradeLevel)(level + 1);
+  }
+  else if(windowOverruns == 0) {
+    // Step back up only once the loop has kept its deadline for a while
+    if(++cleanWindows >= SUPERVISOR_RECOVER_WINDOWS && level > DEGRADE_NONE) {
+      level = (DegradeLevel)(level - 1);
+      cleanWindows = 0;
+    }
+  }
+  else {
+    cleanWindows = 0;
+  }
+  windowTicks = 0;
+  windowOverruns = 0;
+  if(level > maxLevel) maxLevel = level;
+  return level != lastLevel;
+ }
+
+ DegradeLevel LoopSupervisor::getLevel() {
+  return level;
+ }
+
+ // Returns the lowest level the loop has stepped down to
+ DegradeLevel LoopSupervisor::getMaxLevel() {
+  return maxLevel;
+ }
+
+ unsigned long LoopSupervisor::getTickCount() {
+  return tickCount;
+ }
+
+ // Returns the number of passes over the deadline
+ unsigned long LoopSupervisor::getTickOverruns() {
+  return tickOverruns;
+ }
+
+ // Returns the number of excused passes over the deadline, not included in getTickOverruns()
+ unsigned long LoopSupervisor::getExcusedOverruns() {
+  return excusedOverruns;
+ }
+
+ unsigned long LoopSupervisor::getStageOverruns(SuperviseStage stage) {
+  return stageOverruns[stage];
+ }
+
+ // Returns the longest pass of the loop (micros)
+ unsigned long LoopSupervisor::getMaxTickTime() {
+  return maxTickTime;
+ }
+
+ // Called with the sequence of the newest sensor snapshot every pass
+ void LoopSupervisor::watchSensing(unsigned long sequence) {
+  unsigned long now = halMillis();
+  if(sequence != lastSequence) {
+    lastSequence = sequence;
+    lastSequenceTime = now;
+  }
+  bool wasStalled = isStalled;
+  isStalled = now - lastSequenceTime > SENSING_STALL_MILLIS;
+  if(isStalled && !wasStalled) stallCount++;
+ }
+
+ // Returns true while no sensor snapshot has arrived for SENSING_STALL_MILLIS
+ bool LoopSupervisor::isSensingStalled() {
+  return isStalled;
+ }
+
+ // Returns the number of times the sensing side has stalled
+ unsigned long LoopSupervisor::getStallCount() {
+  return stallCount;
+ }
+
+ // Prints the deadline and level, then the overruns of the whole loop and of each stage
+ template <typename Output>
+ void LoopSupervisor::dump(Output& output) {
+  output.print("#supervisor us deadline=");
+  output.print(deadline);
+  output.print(" level=");
+  output.print(DEGRADE_LEVEL_NAMES[level]);
+  output.print(" max=");
+  output.println(DEGRADE_LEVEL_NAMES[maxLevel]);
+  output.print("loop ");
+  output.print(tickCount);
+  output.print(" ");
+  output.print(tickOverruns);
+  output.print(" ");
+  output.println(maxTickTime);
+  output.print("excused ");
+  output.println(excusedOverruns);
+  for(int i = 0; i < SUPERVISE_STAGE_COUNT; i++) {
+    if(budgets[i] == 0) continue;
+    output.print(SUPERVISE_STAGE_NAMES[i]);
+    output.print(" ");
+    output.print(budgets[i]);
+    output.print(" ");
+    output.println(stageOverruns[i]);
+  }
+  output.print("stalls ");
+  output.println(stallCount);
+ }
+#endif
@@ -0,0 +1,222 @@
+/* MotionProfile and MotionProfiler classes
+ * 18 October 2026
+ *
+ * Ramps an actuator to its target instead of jumping there. A MotionProfile limits how fast
+ * the output changes (slew rate), how fast that rate changes (acceleration) and how fast the
+ * acceleration changes (jerk), so the motor driver and the steering servo never see a step in
+ * current. It heads for the target as fast as the limits allow while still being able to stop
+ * there, and a new target can be set at any time, the ramp carries on from where it is.
+ *
+ * A MotionProfiler steps its profiles from a hardware timer (halStartTimer()), every
+ * MOTION_PROFILE_PERIOD_MICROS, and writes each new value through a MotionOutput function. The
+ * ramps keep their timing however long the loop takes, and the loop only sets targets. The
+ * output function returns the value the actuator actually took (the value it was given if it
+ * only rounded it), and a profile whose actuator refused it (the motor's emergency brake)
+ * stops there and ramps on to its target from that value.
+ *
+ * Targets may be set from any task, everything else belongs to the timer once begin() has
+ * been called.
+ */
+
+#ifndef MOTIONPROFILE_H
+#define MOTIONPROFILE_H
+
+#include <atomic>
+#include "config.h"
+#include "hal.h"
+
+ // Writes a value to an actuator, returns the value it actually took
+ typedef float (*MotionOutput)(float value,void* arg);
+
+ const int MOTION_PROFILER_MAX_PROFILES = 4;
+ const int MOTION_PROFILE_MAX_TAPS = 64; // Longest smoothing, in periods
+ const int MOTION_PROFILER_MAX_CATCH_UP = 4; // Most periods stepped at once after the timer was held up
+
+ class MotionProfile {
+  private:
+    std::atomic<float> target;
+    float rampPosition; // Slew and acceleration limited ramp, before smoothing
+    float rampVelocity; // Units per second
+    float maxVelocity;
+    float maxAcceleration;
+    float minPosition;
+    float maxPosition;
+    float taps[MOTION_PROFILE_MAX_TAPS]; // The last rampPositions, their average is the output
+    float tapSum;
+    int tapCount;
+    int nextTap;
+    int restCount; // Steps the ramp has been at rest on the target
+    float position;
+  public:
+    MotionProfile(float maxVelocity,float maxAcceleration,float maxJerk,float minPosition,float maxPosition);
+    void setTarget(float target);
+    float getTarget();
+    void reset(float position);
+    void hold(float position);
+    bool step();
+    float getPosition();
+    bool isMoving();
+ };
+
+ /* Constructor, starts at rest at 0 (or the end of the range nearest it). The jerk limit sets
+  * how long the output is smoothed over, 2 * maxAcceleration / maxJerk, which must fit in
+  * MOTION_PROFILE_MAX_TAPS periods.
+  */
+ MotionProfile::MotionProfile(float maxVelocity,float maxAcceleration,float maxJerk,float minPosition,float maxPosition) : target(0) {
+  this->maxVelocity = maxVelocity;
+  this->maxAcceleration = maxAcceleration;
+  this->minPosition = minPosition;
+  this->maxPosition = maxPosition;
+  tapCount = 2 * maxAcceleration / maxJerk * 1000000.0 / MOTION_PROFILE_PERIOD_MICROS + 0.5;
+  if(tapCount < 1) tapCount = 1;
+  if(tapCount > MOTION_PROFILE_MAX_TAPS) tapCount = MOTION_PROFILE_MAX_TAPS;
+  reset(minPosition > 0 ? minPosition : (maxPosition < 0 ? maxPosition : 0));
+ }
+
+ // Sets where to ramp to, safe from any task
+ void MotionProfile::setTarget(float target) {
+  if(target < minPosition) target = minPosition;
+  if(target > maxPosition) target = maxPosition;
+  this->target = target;
+ }
+
+ float MotionProfile::getTarget() {
+  return target;
+ }
+
+ // Stops dead at position, which becomes the target too
+ void MotionProfile::reset(float position) {
+  hold(position);
+  target = position;
+ }
+
+ // Stops dead at position, the target is kept so the ramp starts again from there
+ void MotionProfile::hold(float position) {
+  this->position = position;
+  rampPosition = position;
+  rampVelocity = 0;
+  for(int i = 0; i < tapCount; i++) taps[i] = position;
+  tapSum = position * tapCount;
+  nextTap = 0;
+  restCount = tapCount;
+ }
+
+ /* Moves one period (MOTION_PROFILE_PERIOD_MICROS) along. Returns true if the position changed.
+  *
+  * The ramp goes as fast as the slew rate and acceleration allow while it can still stop on
+  * the target, like a trapezoid. The output is the average of the ramp over the last
+  * 2 * maxAcceleration / maxJerk seconds, which spreads every change in acceleration (at most
+  * from full one way to full the other) over that time, so the jerk stays within its limit.
+  * Neither the ramp nor its average passes the target.
+  */
+ bool MotionProfile::step() {
+  const float seconds = MOTION_PROFILE_PERIOD_MICROS / 1000000.0f;
+  float goal = target;
+  float error = goal - rampPosition;
+  if(error == 0 && rampVelocity == 0 && restCount >= tapCount) return false;
+
+  /* Fastest speed from which the ramp can still stop on the target, slowing by velocityStep
+   * each period: k steps of it cover velocityStep * seconds * k(k + 1) / 2
+   */
+  float velocityStep = maxAcceleration * seconds;
+  float stopSteps = (sqrtf(1 + 8 * fabsf(error) / (velocityStep * seconds)) - 1) / 2;
+  float stopVelocity = velocityStep * stopSteps;
+  if(stopVelocity > maxVelocity) stopVelocity = maxVelocity;
+  if(error < 0) stopVelocity = -stopVelocity;
+  if(stopVelocity > rampVelocity + velocityStep) stopVelocity = rampVelocity + velocityStep;
+  if(stopVelocity < rampVelocity - velocityStep) stopVelocity = rampVelocity - velocityStep;
+  rampVelocity = stopVelocity;
+  rampPosition += rampVelocity * seconds;
+
+  // Within a step of the target, or past it, the ramp stops on it
+  if((rampPosition - goal) * error >= 0 || fabsf(goal - rampPosition) <= velocityStep * seconds) {
+    if(fabsf(rampVelocity) <= velocityStep) {
+      rampPosition = goal;
+      rampVelocity = 0;
+    }
+  }
+  restCount = rampPosition == goal && rampVelocity == 0 ? restCount + 1 : 0;
+
+  // Running sum of the taps, started again from the goal once they all hold it so errors cannot build up
+  tapSum += rampPosition - taps[nextTap];
+  taps[nextTap] = rampPosition;
+  nextTap = (nextTap + 1) % tapCount;
+  if(restCount >= tapCount) tapSum = goal * tapCount;
+  float newPosition = restCount >= tapCount ? goal : tapSum / tapCount;
+  if(newPosition < minPosition) newPosition = minPosition;
+  if(newPosition > maxPosition) newPosition = maxPosition;
+  bool isChanged = newPosition != position;
+  position = newPosition;
+  return isChanged;
+ }
+
+ float MotionProfile::getPosition() {
+  return position;
+ }
+
+ // Returns true until the output has come to rest on the target
+ bool MotionProfile::isMoving() {
+  return position != target || restCount < tapCount;
+ }
+
+ class MotionProfiler {
+  private:
+    MotionProfile* profiles[MOTION_PROFILER_MAX_PROFILES];
+    MotionOutput outputs[MOTION_PROFILER_MAX_PROFILES];
+    void* outputArgs[MOTION_PROFILER_MAX_PROFILES];
+    int count;
+    unsigned long lastTime; // Time of the last step (micros)
+    static void onTimer(void* arg);
+  public:
+    MotionProfiler();
+    bool add(MotionProfile* profile,MotionOutput output,void* arg);
+    bool begin();
+    void update();
+ };
+
+ // Constructor, profiles are added before begin()
+ MotionProfiler::MotionProfiler() {
+  count = 0;
+  lastTime = 0;
+ }
+
+ // Adds a profile and the actuator it drives, returns false if there is no room
+ bool MotionProfiler::add(MotionProfile* profile,MotionOutput output,void* arg) {
+  if(count >= MOTION_PROFILER_MAX_PROFILES) return false;
+  profiles[count] = profile;
+  outputs[count] = output;
+  outputArgs[count] = arg;
+  count++;
+  return true;
+ }
+
+ /* Starts the timer that steps the profiles. Returns false if it could not be started, call
+  * update() from the loop instead then.
+  */
+ bool MotionProfiler::begin() {
+  lastTime = halMicros();
+  return halStartTimer(onTimer,this,"motion",MOTION_PROFILE_PERIOD_MICROS);
+ }
+
+ void MotionProfiler::onTimer(void* arg) {
+  ((MotionProfiler*)arg)->update();
+ }
+
+ // Steps every profile once per period since the last step and writes the ones that moved
+ void MotionProfiler::update() {
+  // Whole periods since the last step, a long gap (the timer held up) is made up a few periods at most
+  int steps = (halMicros() - lastTime) / MOTION_PROFILE_PERIOD_MICROS;
+  if(steps == 0) return;
+  lastTime += steps * (unsigned long)MOTION_PROFILE_PERIOD_MICROS;
+  if(steps > MOTION_PROFILER_MAX_CATCH_UP) steps = MOTION_PROFILER_MAX_CATCH_UP;
+
+  for(int i = 0; i < count; i++) {
+    bool isChanged = false;
+    for(int j = 0; j < steps; j++) isChanged |= profiles[i]->step();
+    if(!isChanged) continue;
+    float position = profiles[i]->getPosition();
+    float actual = outputs[i](position,outputArgs[i]);
+    if(actual != position) profiles[i]->hold(actual);
+  }
+ }
+#endif
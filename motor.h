@@ -5,6 +5,17 @@
  * - Added braking when speed is set to 0
  * 24 November 2020
  * - Updated to work with PWMController class
+ * 18 October 2026
+ * - Hardware access goes through hal.h
+ * - Duty cycle works for any PWM resolution (dutycycle.h)
+ * - Direction pins are written straight to the GPIO registers
+ * - Direction pins and PWM are only written when they change
+ * - Added emergencyBrake(), safe to call from an interrupt, which brakes at once and latches
+ *   until clearBrake(). Forward speeds are held at 0 while the brake is latched. isBrakeLatched()
+ *   is in IRAM too, for the same interrupt
+ * - Added profileOutput() so a MotionProfile can ramp the speed (motionprofile.h)
+ * - The PWM duty cycle is written before the direction pins
+ * - The pins are set up by begin(), braking, instead of in the constructor which runs before setup()
  * *** For use with the Drok 200337 Motor Drive Board ***
  * 
  * VERSION HISTORY:
@@ -27,21 +38,39 @@
  #ifndef MOTOR_H
  #define MOTOR_H
 
+ #include "hal.h"
  #include "pwmcontroller.h"
+ #include "dutycycle.h"
+
+ // States of the direction pins
+ enum MotorDirection {
+  MOTOR_BRAKE,
+  MOTOR_FORWARD,
+  MOTOR_REVERSE
+ };
  
 class Motor {
   private:
     float speed; // Speed of the motor, sign indicates direction
     int PWMChannel;
-    int controlWire1;
-    int controlWire2;
+    HalFastPin controlWire1;
+    HalFastPin controlWire2;
+    int PWMResolution;
+    volatile MotorDirection direction; // Last state written to the direction pins by setDirection()
+    volatile bool brakeLatched; // Set by emergencyBrake(), blocks forward speeds
+    void setDirection(MotorDirection direction);
     int calculateDutyCycle(float speed);
     PWMController pwmControl;
     
   public:
     Motor(int controlWire1,int controlWire2,int PWMChannel,int PWMWire,int PWMFrequency,int PWMResolution);
+    void begin();
     float getSpeed();
     bool setSpeed(float speed);
+    void IRAM_ATTR emergencyBrake();
+    bool IRAM_ATTR isBrakeLatched();
+    void clearBrake();
+    static float profileOutput(float speed,void* motor);
  };
 
 // Constructor
@@ -49,17 +78,30 @@ Motor::Motor(int controlWire1,int controlWire2,int PWMChannel,int PWMWire,int PW
   : pwmControl(PWMChannel,PWMWire,PWMFrequency,PWMResolution) { // Constructor parameters for pwmControl
   // Set speed to 0
   speed = 0.0;
-  this->controlWire1 = controlWire1;
-  this->controlWire2 = controlWire2;
+  this->controlWire1 = halFastPin(controlWire1);
+  this->controlWire2 = halFastPin(controlWire2);
   this->PWMChannel = PWMChannel;
-  digitalWrite(controlWire1,LOW);
-  digitalWrite(controlWire2,LOW);
+  this->PWMResolution = PWMResolution;
+  direction = MOTOR_BRAKE;
+  brakeLatched = false;
+}
+
+/* Sets up the pins with the motor braked: both direction pins low, then the PWM at 0% duty.
+ * The levels are written before the pins are made outputs, so they never drive anything else
+ */
+void Motor::begin() {
+  halFastWrite(controlWire1,LOW);
+  halFastWrite(controlWire2,LOW);
+  halPinMode(controlWire1.pin,OUTPUT);
+  halPinMode(controlWire2.pin,OUTPUT);
+  pwmControl.begin();
 }
 
 // Returns the duty cycle for the PWM signal connected to the enable pin
 int Motor::calculateDutyCycle(float speed) {
-  // TODO: Adjust to work with resolutions other than 8-bit
-  return abs(speed)*255;
+  // The speed is turned into a fraction of 2^16 once, the rest is integer
+  uint32_t fraction = abs(speed) * (1UL << DUTY_FRACTION_BITS);
+  return dutyFromFraction(fraction,PWMResolution);
 }
 
 // Returns the current speed of the motor
@@ -71,43 +113,80 @@ float Motor::getSpeed() {
 bool Motor::setSpeed(float speed) {
   // Local vars
   int dutyCycle = 0;
-  bool isForward = true;
   
   // Check for valid speed range
   if(speed < -1.0 || speed > 1.0) return false;
+
+  // Going forward is blocked by the emergency brake, reversing away is still allowed
+  if(speed > 0 && brakeLatched) speed = 0;
   
   // Update speed stored in instance
   this->speed = speed;
 
-  // This will cause motor to brake (TODO: Slow deceleration)
+  // This will cause motor to brake, ramp the speed with a MotionProfile to slow down gently
   if(speed == 0) {
-    digitalWrite(controlWire1,LOW);
-    digitalWrite(controlWire2,LOW);
+    setDirection(MOTOR_BRAKE);
     return true;
   }
-
-  // Determine direction
-  if(speed < 0) isForward = false;
   
   // Determine duty cycle corresponding to speed
   dutyCycle = calculateDutyCycle(speed);
 
-  // Update control pins
-  if(isForward) {
-    digitalWrite(controlWire1,HIGH);
-    digitalWrite(controlWire2,LOW);
-  }
-  else {
-    digitalWrite(controlWire1,LOW);
-    digitalWrite(controlWire2,HIGH);
-  }
-
   // Update PWM signal (NOTE: ESP32 for arduino doesn't support an analogWrite function, so PWMController is used)
+  // It goes first, coming off the brake the pins would otherwise drive at the old duty cycle for a moment
   pwmControl.update(dutyCycle);
+
+  // Update control pins
+  setDirection(speed > 0 ? MOTOR_FORWARD : MOTOR_REVERSE);
   
   // Update speed variable
   this->speed = speed;
+
+  // The brake may have been latched by an interrupt while the pins were being written
+  if(speed > 0 && brakeLatched) {
+    this->speed = 0;
+    setDirection(MOTOR_BRAKE);
+  }
   
   return true;
 }
+
+/* Brakes straight away if the motor is going forward, and blocks forward speeds until
+ * clearBrake(). Safe to call from an interrupt: it only writes the direction pins, and leaves
+ * direction alone so the next setSpeed() sees the pins need writing again.
+ */
+void IRAM_ATTR Motor::emergencyBrake() {
+  brakeLatched = true;
+  if(direction != MOTOR_FORWARD) return;
+  halFastWrite(controlWire1,LOW);
+  halFastWrite(controlWire2,LOW);
+}
+
+// Returns true while forward speeds are blocked by emergencyBrake()
+bool IRAM_ATTR Motor::isBrakeLatched() {
+  return brakeLatched;
+}
+
+// Allows forward speeds again
+void Motor::clearBrake() {
+  brakeLatched = false;
+}
+
+// MotionOutput for a MotionProfile, returns the speed taken (0 while the brake is latched)
+float Motor::profileOutput(float speed,void* motor) {
+  ((Motor*)motor)->setSpeed(speed);
+  return ((Motor*)motor)->getSpeed();
+}
+
+// Writes the direction pins, unless they are already in that state
+void Motor::setDirection(MotorDirection direction) {
+  if(direction == this->direction) {
+    getOutputStats().elidedCount += 2;
+    return;
+  }
+  this->direction = direction;
+  halFastWrite(controlWire1,direction == MOTOR_FORWARD ? HIGH : LOW);
+  halFastWrite(controlWire2,direction == MOTOR_REVERSE ? HIGH : LOW);
+  getOutputStats().writeCount += 2;
+}
 #endif
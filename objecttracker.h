@@ -0,0 +1,224 @@
+/* ObjectTracker class
+ * 18 October 2026
+ *
+ * Follows objects from one sweep of the eye to the next. Each ScanFrame is split into
+ * clusters, runs of neighbouring readings in range whose distances are close, and every
+ * cluster is matched to the track it is closest to after predicting where each track has
+ * moved. A track keeps its distance and angle, smoothed like AlphaBetaFilter, and the radial
+ * (inches per second, negative when closing) and angular (degrees per second) velocity.
+ *
+ * Sweeps alternate direction (ScanFrame::isForward), so the same object is seen a whole sweep
+ * apart at one edge and almost straight away at the other. Each cluster is given the mean time
+ * of its readings, and velocities use the time between sightings rather than the sweep period.
+ *
+ * Everything is in fixed arrays, OBJECT_TRACKER_MAX_TRACKS tracks at most, and the work per
+ * sweep is bounded by the clusters times the tracks.
+ */
+
+#ifndef OBJECTTRACKER_H
+#define OBJECTTRACKER_H
+
+#include "config.h"
+#include "echosweeper.h"
+
+ const int OBJECT_TRACKER_MAX_TRACKS = 8;
+ const int OBJECT_TRACKER_MAX_CLUSTERS = SCAN_FRAME_CAPACITY;
+
+ // An object followed from sweep to sweep
+ struct ObjectTrack {
+  unsigned long id; // Increases by one per new track
+  float angle; // Degrees, like the eye
+  float distance; // Inches
+  float angularVelocity; // Degrees per second
+  float radialVelocity; // Inches per second, negative when closing
+  int width; // Degrees covered by the last cluster
+  int hits; // Sweeps it has been seen in
+  int misses; // Sweeps in a row it has not been seen in
+  unsigned long timestamp; // Time it was last seen (micros)
+ };
+
+ // Readings of one object in a sweep
+ struct ObjectCluster {
+  float angle;
+  float distance;
+  int minAngle;
+  int maxAngle;
+  unsigned long timestamp; // Mean time of the readings
+  int track; // Index of the matched track, -1 if none
+ };
+
+ class ObjectTracker {
+  private:
+    ObjectTrack tracks[OBJECT_TRACKER_MAX_TRACKS];
+    int count;
+    unsigned long nextId;
+    unsigned long lastSequence; // Sequence of the last frame added
+    int findClusters(const ScanFrame& frame,ObjectCluster* clusters);
+    float getCost(const ObjectTrack& track,const ObjectCluster& cluster);
+    void updateTrack(ObjectTrack* track,const ObjectCluster& cluster);
+    void addTrack(const ObjectCluster& cluster);
+  public:
+    ObjectTracker();
+    void reset();
+    bool update(const ScanFrame& frame);
+    int getCount() const;
+    const ObjectTrack& getTrack(int index) const;
+    bool isConfirmed(int index) const;
+ };
+
+ // Constructor
+ ObjectTracker::ObjectTracker() {
+  nextId = 1;
+  reset();
+ }
+
+ // Forgets every track
+ void ObjectTracker::reset() {
+  count = 0;
+  lastSequence = 0;
+ }
+
+ /* Adds a complete sweep: matches its clusters to the tracks, starts tracks for the clusters
+  * left over and drops tracks that have not been seen for OBJECT_TRACK_MAX_MISSES sweeps.
+  * Returns false if the frame was already added.
+  */
+ bool ObjectTracker::update(const ScanFrame& frame) {
+  if(frame.sequence == lastSequence) return false;
+  lastSequence = frame.sequence;
+
+  ObjectCluster clusters[OBJECT_TRACKER_MAX_CLUSTERS];
+  int clusterCount = findClusters(frame,clusters);
+  bool isMatched[OBJECT_TRACKER_MAX_TRACKS];
+  for(int i = 0; i < count; i++) isMatched[i] = false;
+
+  // Cheapest pair first, until nothing is left inside the gates
+  while(true) {
+    int bestCluster = -1;
+    int bestTrack = -1;
+    float bestCost = 0;
+    for(int c = 0; c < clusterCount; c++) {
+      if(clusters[c].track >= 0) continue;
+      for(int t = 0; t < count; t++) {
+        if(isMatched[t]) continue;
+        float cost = getCost(tracks[t],clusters[c]);
+        if(cost >= 0 && (bestCluster < 0 || cost < bestCost)) {
+          bestCluster = c;
+          bestTrack = t;
+          bestCost = cost;
+        }
+      }
+    }
+    if(bestCluster < 0) break;
+    clusters[bestCluster].track = bestTrack;
+    isMatched[bestTrack] = true;
+    updateTrack(&tracks[bestTrack],clusters[bestCluster]);
+  }
+
+  // Tracks not seen this sweep, removed by moving the last track into their place
+  for(int t = count - 1; t >= 0; t--) {
+    if(isMatched[t] || ++tracks[t].misses <= OBJECT_TRACK_MAX_MISSES) continue;
+    tracks[t] = tracks[--count];
+  }
+
+  for(int c = 0; c < clusterCount; c++) {
+    if(clusters[c].track < 0) addTrack(clusters[c]);
+  }
+  return true;
+ }
+
+ /* Splits a frame into clusters of neighbouring readings in range whose distances are within
+  * OBJECT_CLUSTER_GAP of each other. Returns the number of clusters.
+  */
+ int ObjectTracker::findClusters(const ScanFrame& frame,ObjectCluster* clusters) {
+  int clusterCount = 0;
+  int first = -1;
+  float angleSum = 0;
+  float distanceSum = 0;
+  long timeSum = 0; // From the first reading, so it cannot overflow (negative when sweeping back)
+
+  // One past the end closes the last cluster
+  for(int i = 0; i <= frame.count; i++) {
+    const ScanPoint* point = i < frame.count ? &frame.points[i] : 0;
+    bool isJoined = point && point->isValid && first >= 0 &&
+      fabs(point->distance - frame.points[i - 1].distance) <= OBJECT_CLUSTER_GAP;
+    if(first >= 0 && !isJoined) {
+      int size = i - first;
+      ObjectCluster& cluster = clusters[clusterCount++];
+      cluster.angle = angleSum / size;
+      cluster.distance = distanceSum / size;
+      cluster.minAngle = frame.points[first].angle;
+      cluster.maxAngle = frame.points[i - 1].angle;
+      cluster.timestamp = frame.points[first].timestamp + timeSum / size;
+      cluster.track = -1;
+      first = -1;
+    }
+    if(!point || !point->isValid || clusterCount >= OBJECT_TRACKER_MAX_CLUSTERS) continue;
+    if(first < 0) {
+      first = i;
+      angleSum = 0;
+      distanceSum = 0;
+      timeSum = 0;
+    }
+    angleSum += point->angle;
+    distanceSum += point->distance;
+    timeSum += (long)(point->timestamp - frame.points[first].timestamp);
+  }
+  return clusterCount;
+ }
+
+ /* Returns how far a cluster is from where a track is predicted to be at the cluster's time,
+  * as a fraction of the gates, or -1 if it is outside them
+  */
+ float ObjectTracker::getCost(const ObjectTrack& track,const ObjectCluster& cluster) {
+  float seconds = (long)(cluster.timestamp - track.timestamp) / 1000000.0;
+  float distanceError = fabs(track.distance + track.radialVelocity * seconds - cluster.distance);
+  float angleError = fabs(track.angle + track.angularVelocity * seconds - cluster.angle);
+  if(distanceError >= OBJECT_TRACK_GATE_DISTANCE || angleError >= OBJECT_TRACK_GATE_ANGLE) return -1;
+  return distanceError / OBJECT_TRACK_GATE_DISTANCE + angleError / OBJECT_TRACK_GATE_ANGLE;
+ }
+
+ // Corrects a track with the cluster it was matched to, an alpha-beta step in distance and angle
+ void ObjectTracker::updateTrack(ObjectTrack* track,const ObjectCluster& cluster) {
+  float seconds = (long)(cluster.timestamp - track->timestamp) / 1000000.0;
+  float distanceError = cluster.distance - (track->distance + track->radialVelocity * seconds);
+  float angleError = cluster.angle - (track->angle + track->angularVelocity * seconds);
+  track->distance += track->radialVelocity * seconds + OBJECT_TRACK_ALPHA * distanceError;
+  track->angle += track->angularVelocity * seconds + OBJECT_TRACK_ALPHA * angleError;
+  if(seconds > 0) {
+    track->radialVelocity += OBJECT_TRACK_BETA * distanceError / seconds;
+    track->angularVelocity += OBJECT_TRACK_BETA * angleError / seconds;
+  }
+  track->width = cluster.maxAngle - cluster.minAngle;
+  track->hits++;
+  track->misses = 0;
+  track->timestamp = cluster.timestamp;
+ }
+
+ // Starts a track for a cluster nothing matched, if there is room
+ void ObjectTracker::addTrack(const ObjectCluster& cluster) {
+  if(count >= OBJECT_TRACKER_MAX_TRACKS) return;
+  ObjectTrack& track = tracks[count++];
+  track.id = nextId++;
+  track.angle = cluster.angle;
+  track.distance = cluster.distance;
+  track.angularVelocity = 0;
+  track.radialVelocity = 0;
+  track.width = cluster.maxAngle - cluster.minAngle;
+  track.hits = 1;
+  track.misses = 0;
+  track.timestamp = cluster.timestamp;
+ }
+
+ int ObjectTracker::getCount() const {
+  return count;
+ }
+
+ const ObjectTrack& ObjectTracker::getTrack(int index) const {
+  return tracks[index];
+ }
+
+ // Returns true once a track has been seen in enough sweeps for its velocity to mean something
+ bool ObjectTracker::isConfirmed(int index) const {
+  return tracks[index].hits >= OBJECT_TRACK_CONFIRM_HITS;
+ }
+#endif
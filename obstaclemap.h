@@ -0,0 +1,151 @@
+/* ObstacleMap class
+ * 18 October 2026
+ * 
+ * Polar histogram of the obstacles around the front of the car, covering the eye's range of
+ * angles in OBSTACLE_MAP_BINS bins. Each ping is folded into the bin of its angle as soon as it
+ * arrives, so the map is never more than one ping behind. A bin keeps its density until it is
+ * measured again, so an obstacle does not fade into free space while the eye looks elsewhere.
+ * A bin that has not been measured for OBSTACLE_MAP_MEMORY_SWEEPS sweep periods is unknown and
+ * is treated as blocked. The sweep period is measured by the sweeps themselves (setSweepPeriod()),
+ * so the memory follows a slow or degraded sweep.
+ * 
+ * chooseHeading() picks the free heading closest to a goal heading, weighing how far off the
+ * goal it is against how close its obstacles are, and a speed for it. The work and memory are
+ * fixed by the number of bins.
+ */ 
+
+#ifndef OBSTACLEMAP_H
+#define OBSTACLEMAP_H
+
+#include "config.h"
+
+ const int OBSTACLE_MAP_BINS = 13; // 10 degrees each over the eye's 130 degrees
+
+ class ObstacleMap {
+  private:
+    float density[OBSTACLE_MAP_BINS]; // 0 is free, 1 is an obstacle right at the car
+    unsigned long updateTime[OBSTACLE_MAP_BINS]; // Time of the last reading (millis), 0 if never seen
+    int minAngle;
+    int maxAngle;
+    unsigned long memory; // Readings older than this (millis) are unknown
+  public:
+    ObstacleMap();
+    void reset();
+    void addReading(int angle,double distance,unsigned long timestamp);
+    void setSweepPeriod(unsigned long periodMillis);
+    unsigned long getMemory() const;
+    int getBin(int angle) const;
+    int getBinAngle(int bin) const;
+    float getDensity(int bin,unsigned long currentTime) const;
+    bool chooseHeading(unsigned long currentTime,int goal,int* heading,float* speed) const;
+ };
+
+ // Constructor, the map covers the angles of the eye
+ ObstacleMap::ObstacleMap() {
+  minAngle = EYE_SERVO_MIN_ANGLE;
+  maxAngle = EYE_SERVO_MAX_ANGLE;
+  memory = OBSTACLE_MAP_UNTIMED_MEMORY_MILLIS;
+  reset();
+ }
+
+ // Forgets everything
+ void ObstacleMap::reset() {
+  for(int i = 0; i < OBSTACLE_MAP_BINS; i++) {
+    density[i] = 0;
+    updateTime[i] = 0;
+  }
+ }
+
+ /* Adds one ping (distance in inches, -1 if nothing in range) taken at timestamp (millis).
+  * A close obstacle counts for more than a distant one, and a reading blends with the older
+  * ones in its bin while they are still known.
+  */
+ void ObstacleMap::addReading(int angle,double distance,unsigned long timestamp) {
+  int bin = getBin(angle);
+  float strength = 0;
+  if(distance >= 0 && distance < EYE_MAX_RANGE) {
+    strength = 1.0 - distance / EYE_MAX_RANGE;
+  }
+  float current = getDensity(bin,timestamp);
+  if(current < 0) current = strength;
+  density[bin] = current + OBSTACLE_MAP_GAIN * (strength - current);
+  updateTime[bin] = timestamp == 0 ? 1 : timestamp;
+ }
+
+ /* Sets how long a reading is remembered from the time a sweep took (millis), a bin at the end of
+  * the sweep is measured again after up to two sweeps
+  */
+ void ObstacleMap::setSweepPeriod(unsigned long periodMillis) {
+  memory = OBSTACLE_MAP_MEMORY_SWEEPS * periodMillis;
+ }
+
+ // Returns how long a reading is remembered (millis)
+ unsigned long ObstacleMap::getMemory() const {
+  return memory;
+ }
+
+ // Returns the bin an angle falls in
+ int ObstacleMap::getBin(int angle) const {
+  if(angle <= minAngle) return 0;
+  if(angle >= maxAngle) return OBSTACLE_MAP_BINS - 1;
+  return ((angle - minAngle) * OBSTACLE_MAP_BINS) / (maxAngle - minAngle + 1);
+ }
+
+ // Returns the angle at the middle of a bin
+ int ObstacleMap::getBinAngle(int bin) const {
+  return minAngle + ((2 * bin + 1) * (maxAngle - minAngle)) / (2 * OBSTACLE_MAP_BINS);
+ }
+
+ // Returns the density of a bin as last measured, -1 if it is unknown
+ float ObstacleMap::getDensity(int bin,unsigned long currentTime) const {
+  if(updateTime[bin] == 0 || currentTime - updateTime[bin] >= memory) return -1;
+  return density[bin];
+ }
+
+ /* Picks the free heading (eye angle) closest to goal (90 is straight ahead) and a speed that
+  * drops as obstacles get closer, both on the heading and straight ahead where the car is still
+  * going. A bin is only free if its neighbours are too, so there is room for the car. Its
+  * obstacles count as OBSTACLE_MAP_CLEARANCE_WEIGHT degrees off the goal per unit of density, so
+  * the car steers round an obstacle instead of slowing to a stop in front of it. Returns
+  * false, with a speed of 0, if there is no free heading or an obstacle is too close straight
+  * ahead to turn away from.
+  */
+ bool ObstacleMap::chooseHeading(unsigned long currentTime,int goal,int* heading,float* speed) const {
+  float blocked[OBSTACLE_MAP_BINS];
+  int best = -1;
+  float bestCost = 0;
+  float ahead = 0;
+
+  // Unknown bins count as blocked
+  for(int i = 0; i < OBSTACLE_MAP_BINS; i++) {
+    blocked[i] = getDensity(i,currentTime);
+    if(blocked[i] < 0) blocked[i] = 1.0;
+  }
+
+  for(int i = getBin(90) - 1; i <= getBin(90) + 1; i++) {
+    if(i >= 0 && i < OBSTACLE_MAP_BINS && blocked[i] > ahead) ahead = blocked[i];
+  }
+
+  for(int i = 0; i < OBSTACLE_MAP_BINS; i++) {
+    float worst = blocked[i];
+    if(i > 0 && blocked[i - 1] > worst) worst = blocked[i - 1];
+    if(i < OBSTACLE_MAP_BINS - 1 && blocked[i + 1] > worst) worst = blocked[i + 1];
+    if(worst >= OBSTACLE_MAP_THRESHOLD) continue;
+    float cost = abs(getBinAngle(i) - goal) + OBSTACLE_MAP_CLEARANCE_WEIGHT * worst;
+    if(best < 0 || cost < bestCost) {
+      best = i;
+      bestCost = cost;
+      *speed = AUTONOMOUS_SPEED * (1.0 - worst / OBSTACLE_MAP_THRESHOLD);
+    }
+  }
+
+  if(best < 0 || ahead >= OBSTACLE_MAP_STOP) {
+    *heading = 90;
+    *speed = 0;
+    return false;
+  }
+  *heading = getBinAngle(best);
+  *speed *= 1.0 - ahead / OBSTACLE_MAP_STOP;
+  return true;
+ }
+#endif
@@ -0,0 +1,312 @@
+/* PingScheduler class
+ * 18 October 2026
+ *
+ * Runs several HC-SR04 sensors (the range sensors at the corners and the rear) together, so
+ * adding a sensor does not add to the time spent waiting for echoes. Each sensor has a heading
+ * and a field of view, in degrees like the eye (90 is straight ahead). Sensors whose fields of
+ * view overlap could hear each other's bursts as ghost echoes, so they take turns: a sensor
+ * only pings once the pings of the sensors it conflicts with have finished and their bursts
+ * have had time to come back from PING_CROSSTALK_RANGE. Sensors that cannot hear each other
+ * ping at the same time, and a sensor that is nearly due joins a ping that is starting, so
+ * they keep sharing their turns.
+ *
+ * Each sensor pings every PING_BASE_INTERVAL_MICROS / priority. While the car moves, sensors
+ * facing the way it is going ping up to 1 + PING_TRAVEL_GAIN times as often, and sensors facing
+ * away PING_AWAY_SLOWDOWN times less often. Sensors that are due take their turn most overdue
+ * first, and one that is waiting keeps the sensors it conflicts with from starting ahead of it.
+ *
+ * A sensor pinged by something else (the eye's sensor, pinged by EchoSweeper) is added with
+ * addShared(). Its pings are gated: held back while a sensor it conflicts with is pinging, and
+ * giving way to one that is more overdue. Its heading can follow the servo with setHeading(),
+ * and while the servo is moving a wide field of view keeps it clear of all the others.
+ *
+ * Not thread safe, only the sensing task may use it (the gate runs inside startPing()).
+ */
+
+#ifndef PINGSCHEDULER_H
+#define PINGSCHEDULER_H
+
+#include "config.h"
+#include "hal.h"
+#include "ultrasonic.h"
+
+ const int PING_SCHEDULER_MAX_SENSORS = 6;
+
+ class PingScheduler;
+
+ // A sensor and its turn
+ struct PingSlot {
+  PingScheduler* scheduler;
+  Ultrasonic* sensor;
+  bool isOwned; // Pinged by the scheduler, otherwise only gated
+  int heading;
+  int fieldOfView;
+  int priority;
+  uint32_t conflicts; // Bit per sensor that could hear this one
+  uint32_t pingConflicts; // conflicts when the last ping started, its burst keeps that heading
+  unsigned long interval; // Time between pings at the current travel (micros)
+  unsigned long pingTime; // Time the last ping started
+  bool isNewReading;
+  double distance; // Last reading in inches, -1 if nothing in range
+  unsigned long pingCount;
+ };
+
+ class PingScheduler {
+  private:
+    Ultrasonic sensors[PING_SCHEDULER_MAX_SENSORS]; // The owned sensors, at the index of their slot
+    PingSlot slots[PING_SCHEDULER_MAX_SENSORS];
+    int count;
+    float travelSpeed;
+    unsigned long crosstalkMicros; // Time for a burst to come back from PING_CROSSTALK_RANGE
+    int addSlot(Ultrasonic* sensor,bool isOwned,int heading,int fieldOfView,int priority);
+    void updateConflicts(int index);
+    void updateInterval(int index);
+    bool startPing(int index,unsigned long currentTime);
+    bool isDue(int index,unsigned long currentTime,unsigned long interval);
+    long getLateness(int index,unsigned long currentTime);
+    bool isClear(int index,unsigned long currentTime);
+    bool isConflictClear(int index,unsigned long currentTime);
+    static int angleBetween(int a,int b);
+  public:
+    PingScheduler();
+    int addSensor(int triggerPin,int echoPin,int maxRange,int heading,int fieldOfView,int priority);
+    int addShared(Ultrasonic* sensor,int heading,int fieldOfView,int priority);
+    void setHeading(int index,int heading,int fieldOfView);
+    void setTravel(float speed);
+    int update();
+    bool getNewReading(int index,double* distance);
+    int getCount();
+    int getHeading(int index);
+    unsigned long getPingCount(int index);
+    bool isConflict(int a,int b);
+    static bool gate(void* arg);
+ };
+
+ // Constructor, sensors are added in setup()
+ PingScheduler::PingScheduler() {
+  count = 0;
+  travelSpeed = 0;
+  crosstalkMicros = ULTRASONIC_ECHO_START_MICROS + Ultrasonic::toMicros(PING_CROSSTALK_RANGE);
+ }
+
+ /* Adds a sensor for the scheduler to ping and sets up its pins. Returns its index, or -1 if
+  * there is no room. A priority of 0 never pings.
+  */
+ int PingScheduler::addSensor(int triggerPin,int echoPin,int maxRange,int heading,int fieldOfView,int priority) {
+  if(count >= PING_SCHEDULER_MAX_SENSORS) return -1;
+  sensors[count] = Ultrasonic(triggerPin,echoPin,maxRange);
+  sensors[count].begin();
+  return addSlot(&sensors[count],true,heading,fieldOfView,priority);
+ }
+
+ /* Adds a sensor pinged by something else, which from now on waits for its turn. The priority
+  * sets how overdue it gets before the owned sensors give way to it. Returns its index, or -1
+  */
+ int PingScheduler::addShared(Ultrasonic* sensor,int heading,int fieldOfView,int priority) {
+  if(count >= PING_SCHEDULER_MAX_SENSORS) return -1;
+  int index = addSlot(sensor,false,heading,fieldOfView,priority);
+  sensor->setGate(gate,&slots[index]);
+  return index;
+ }
+
+ // Fills in a slot and works out which of the others it conflicts with
+ int PingScheduler::addSlot(Ultrasonic* sensor,bool isOwned,int heading,int fieldOfView,int priority) {
+  int index = count++;
+  PingSlot& slot = slots[index];
+  slot.scheduler = this;
+  slot.sensor = sensor;
+  slot.isOwned = isOwned;
+  slot.heading = heading;
+  slot.fieldOfView = fieldOfView;
+  slot.priority = priority;
+  slot.conflicts = 0;
+  slot.pingConflicts = 0;
+  slot.interval = 0;
+  slot.pingTime = 0;
+  slot.isNewReading = false;
+  slot.distance = -1.0;
+  slot.pingCount = 0;
+  updateConflicts(index);
+  updateInterval(index);
+  return index;
+ }
+
+ // Points a sensor a new way (the eye follows its servo), a ping already going keeps its old conflicts
+ void PingScheduler::setHeading(int index,int heading,int fieldOfView) {
+  if(index < 0 || index >= count) return;
+  if(slots[index].heading == heading && slots[index].fieldOfView == fieldOfView) return;
+  slots[index].heading = heading;
+  slots[index].fieldOfView = fieldOfView;
+  updateConflicts(index);
+  updateInterval(index);
+ }
+
+ // Two sensors conflict when their fields of view overlap
+ void PingScheduler::updateConflicts(int index) {
+  PingSlot& slot = slots[index];
+  slot.conflicts = 0;
+  for(int i = 0; i < count; i++) {
+    if(i == index) continue;
+    if(angleBetween(slot.heading,slots[i].heading) < (slot.fieldOfView + slots[i].fieldOfView) / 2) {
+      slot.conflicts |= 1UL << i;
+      slots[i].conflicts |= 1UL << index;
+    }
+    else {
+      slots[i].conflicts &= ~(1UL << index);
+    }
+  }
+ }
+
+ /* Sets how the car is moving (the target speed, negative when reversing), the sensors facing
+  * that way ping more often
+  */
+ void PingScheduler::setTravel(float speed) {
+  if(speed == travelSpeed) return;
+  travelSpeed = speed;
+  for(int i = 0; i < count; i++) updateInterval(i);
+ }
+
+ void PingScheduler::updateInterval(int index) {
+  PingSlot& slot = slots[index];
+  if(slot.priority <= 0) return;
+  slot.interval = PING_BASE_INTERVAL_MICROS / slot.priority;
+  if(travelSpeed == 0) return;
+  int angle = angleBetween(slot.heading,travelSpeed > 0 ? 90 : 270);
+  if(angle <= 45) slot.interval /= 1 + PING_TRAVEL_GAIN * fabs(travelSpeed);
+  else if(angle >= 135) slot.interval *= PING_AWAY_SLOWDOWN;
+ }
+
+ /* Collects the echoes of the owned sensors and starts the ones that are due and clear.
+  * Returns the number of new readings.
+  */
+ int PingScheduler::update() {
+  unsigned long currentTime = halMicros();
+  int readings = 0;
+  for(int i = 0; i < count; i++) {
+    if(!slots[i].isOwned || !sensors[i].isBusy() || !sensors[i].poll()) continue;
+    slots[i].distance = sensors[i].getLastDistance();
+    slots[i].isNewReading = true;
+    readings++;
+  }
+
+  // Most overdue first, a sensor left waiting reserves its turn against the ones it conflicts with
+  uint32_t tried = 0;
+  uint32_t reserved = 0;
+  bool isStarted = false;
+  while(true) {
+    int next = -1;
+    for(int i = 0; i < count; i++) {
+      if((tried & (1UL << i)) || !isDue(i,currentTime,slots[i].interval)) continue;
+      if(next < 0 || getLateness(i,currentTime) > getLateness(next,currentTime)) next = i;
+    }
+    if(next < 0) break;
+    tried |= 1UL << next;
+    if((slots[next].conflicts & reserved) || !isClear(next,currentTime) || !isConflictClear(next,currentTime)) {
+      reserved |= 1UL << next;
+    }
+    else if(startPing(next,currentTime)) {
+      isStarted = true;
+    }
+  }
+
+  // Sensors half way to being due join in, so the ones that can ping together stay in step
+  for(int i = 0; i < count && isStarted; i++) {
+    if((tried & (1UL << i)) || !isDue(i,currentTime,slots[i].interval / 2)) continue;
+    if(!(slots[i].conflicts & reserved) && isClear(i,currentTime) && isConflictClear(i,currentTime)) {
+      startPing(i,currentTime);
+    }
+  }
+  return readings;
+ }
+
+ // Starts a ping of an owned sensor, returns false if the sensor could not start one
+ bool PingScheduler::startPing(int index,unsigned long currentTime) {
+  PingSlot& slot = slots[index];
+  if(!slot.sensor->startPing()) return false;
+  slot.pingTime = currentTime;
+  slot.pingConflicts = slot.conflicts;
+  slot.pingCount++;
+  return true;
+ }
+
+ // Returns true if an owned sensor is idle and interval has passed since its last ping
+ bool PingScheduler::isDue(int index,unsigned long currentTime,unsigned long interval) {
+  const PingSlot& slot = slots[index];
+  return slot.isOwned && slot.priority > 0 && !slot.sensor->isBusy() && currentTime - slot.pingTime >= interval;
+ }
+
+ // Returns how long a sensor has been due in micros, negative if it is not due yet
+ long PingScheduler::getLateness(int index,unsigned long currentTime) {
+  return (long)(currentTime - slots[index].pingTime - slots[index].interval);
+ }
+
+ // Returns true once a sensor's last ping has finished and its burst can no longer be heard
+ bool PingScheduler::isClear(int index,unsigned long currentTime) {
+  return !slots[index].sensor->isBusy() && currentTime - slots[index].pingTime >= crosstalkMicros;
+ }
+
+ /* Returns true if no sensor that could hear this one is pinging, from where it points now or
+  * from where it pointed when its ping started
+  */
+ bool PingScheduler::isConflictClear(int index,unsigned long currentTime) {
+  for(int i = 0; i < count; i++) {
+    bool isConflicting = (slots[index].conflicts & (1UL << i)) || (slots[i].pingConflicts & (1UL << index));
+    if(isConflicting && !isClear(i,currentTime)) return false;
+  }
+  return true;
+ }
+
+ /* Gate of a shared sensor, called by its startPing(). Lets the ping go if it is clear and no
+  * owned sensor it conflicts with is ready and more overdue, that sensor gets its turn first.
+  */
+ bool PingScheduler::gate(void* arg) {
+  PingSlot* slot = (PingSlot*)arg;
+  PingScheduler* scheduler = slot->scheduler;
+  int index = slot - scheduler->slots;
+  unsigned long currentTime = halMicros();
+  if(!scheduler->isConflictClear(index,currentTime)) return false;
+  for(int i = 0; i < scheduler->count; i++) {
+    if(!(slot->conflicts & (1UL << i)) || !scheduler->isDue(i,currentTime,scheduler->slots[i].interval)) continue;
+    if(scheduler->isClear(i,currentTime) && scheduler->getLateness(i,currentTime) > scheduler->getLateness(index,currentTime)) {
+      return false;
+    }
+  }
+  slot->pingTime = currentTime;
+  slot->pingConflicts = slot->conflicts;
+  slot->pingCount++;
+  return true;
+ }
+
+ // Copies the newest reading of an owned sensor into distance, returns false if it was already taken
+ bool PingScheduler::getNewReading(int index,double* distance) {
+  if(index < 0 || index >= count || !slots[index].isNewReading) return false;
+  *distance = slots[index].distance;
+  slots[index].isNewReading = false;
+  return true;
+ }
+
+ // Returns the number of sensors, owned and shared
+ int PingScheduler::getCount() {
+  return count;
+ }
+
+ int PingScheduler::getHeading(int index) {
+  return slots[index].heading;
+ }
+
+ // Returns the number of pings a sensor has made, or been allowed if it is shared
+ unsigned long PingScheduler::getPingCount(int index) {
+  return slots[index].pingCount;
+ }
+
+ // Returns true if two sensors could hear each other where they point now
+ bool PingScheduler::isConflict(int a,int b) {
+  return (slots[a].conflicts & (1UL << b)) != 0;
+ }
+
+ // Returns the angle between two headings, 0 to 180 degrees
+ int PingScheduler::angleBetween(int a,int b) {
+  int angle = ((a - b) % 360 + 360) % 360;
+  return angle > 180 ? 360 - angle : angle;
+ }
+#endif
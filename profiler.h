@@ -0,0 +1,172 @@
+/* Profiler class
+ * 18 October 2026
+ * 
+ * Times each stage of the main loop with the CPU cycle counter and keeps a histogram per
+ * stage in a fixed amount of memory. Recording a sample is a handful of instructions, so the
+ * profiler can be left on in the field. dump() prints one compact line per stage with the
+ * count, min, percentiles and max in CPU cycles.
+ * 
+ * Stages are timed with PROFILE_START(stage) and PROFILE_END(stage). Without ARC_PROFILING
+ * (see config.h) these expand to nothing, so the profiler costs nothing when compiled out.
+ * 
+ * Histogram buckets are log-linear: each power of two is split into 4 buckets, so a
+ * percentile is accurate to within 25%, and the buckets cover the full 32 bit range.
+ */ 
+
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include "config.h"
+#include "hal.h"
+
+ // Stages of the loop that are timed
+ enum ProfileStage {
+  STAGE_CONTROLLER, // Controller::getData()
+  STAGE_RESPOND,    // ControllerAction::respond()
+  STAGE_MOTOR,      // Rear motor target, ramped by MotionProfiler
+  STAGE_SERVO,      // Steering target, ramped by MotionProfiler
+  STAGE_PING,       // A step of the single ping (sensing side)
+  STAGE_SWEEP,      // A step of the sweep (sensing side)
+  STAGE_RANGES,     // PingScheduler::update() for the range sensors (sensing side)
+  STAGE_TRACK,      // ObjectTracker::update() once per sweep (sensing side)
+  STAGE_REPORT,     // Sending readings over Serial
+  STAGE_LOOP,       // The whole loop, not counting the wait for the next period
+  PROFILE_STAGE_COUNT
+ };
+
+ const char* const PROFILE_STAGE_NAMES[PROFILE_STAGE_COUNT] = {
+  "controller","respond","motor","servo","ping","sweep","ranges","track","report","loop"
+ };
+
+ const int PROFILE_SUB_BUCKETS = 4; // Buckets per power of two
+ const int PROFILE_BUCKETS = 124; // Enough for every 32 bit value
+
+ struct StageStats {
+  uint32_t count;
+  uint32_t minCycles;
+  uint32_t maxCycles;
+  uint32_t buckets[PROFILE_BUCKETS];
+ };
+
+ class Profiler {
+  private:
+    StageStats stats[PROFILE_STAGE_COUNT];
+    static int getBucket(uint32_t cycles);
+    static uint32_t getBucketLimit(int bucket);
+  public:
+    Profiler();
+    void reset();
+    void record(int stage,uint32_t cycles);
+    uint32_t getCount(int stage);
+    uint32_t getMin(int stage);
+    uint32_t getMax(int stage);
+    uint32_t getPercentile(int stage,int percent);
+    template <typename Output> void dump(Output& output);
+ };
+
+ // Returns the profiler shared by the whole program
+ inline Profiler& getProfiler() {
+  static Profiler profiler;
+  return profiler;
+ }
+
+#ifdef ARC_PROFILING
+ #define PROFILE_START(stage) uint32_t profileStart_##stage = halCycleCount()
+ #define PROFILE_END(stage) getProfiler().record(stage,halCycleCount() - profileStart_##stage)
+#else
+ #define PROFILE_START(stage)
+ #define PROFILE_END(stage)
+#endif
+
+ // Constructor
+ Profiler::Profiler() {
+  reset();
+ }
+
+ // Clears every histogram
+ void Profiler::reset() {
+  memset(stats,0,sizeof(stats));
+  for(int i = 0; i < PROFILE_STAGE_COUNT; i++) {
+    stats[i].minCycles = 0xFFFFFFFF;
+  }
+ }
+
+ // Values below 4 have a bucket each, above that each power of two is split into 4
+ int Profiler::getBucket(uint32_t cycles) {
+  if(cycles < PROFILE_SUB_BUCKETS) return cycles;
+  int topBit = 31 - __builtin_clz(cycles);
+  return PROFILE_SUB_BUCKETS * (topBit - 1) + ((cycles >> (topBit - 2)) & (PROFILE_SUB_BUCKETS - 1));
+ }
+
+ // Returns the largest value that falls in a bucket
+ uint32_t Profiler::getBucketLimit(int bucket) {
+  if(bucket < PROFILE_SUB_BUCKETS) return bucket;
+  int topBit = bucket / PROFILE_SUB_BUCKETS + 1;
+  uint32_t lowest = (uint32_t)(PROFILE_SUB_BUCKETS + bucket % PROFILE_SUB_BUCKETS) << (topBit - 2);
+  return lowest + ((1UL << (topBit - 2)) - 1);
+ }
+
+ // Adds a sample to a stage
+ void Profiler::record(int stage,uint32_t cycles) {
+  StageStats* stageStats = &stats[stage];
+  stageStats->count++;
+  if(cycles < stageStats->minCycles) stageStats->minCycles = cycles;
+  if(cycles > stageStats->maxCycles) stageStats->maxCycles = cycles;
+  stageStats->buckets[getBucket(cycles)]++;
+ }
+
+ uint32_t Profiler::getCount(int stage) {
+  return stats[stage].count;
+ }
+
+ uint32_t Profiler::getMin(int stage) {
+  return stats[stage].count ? stats[stage].minCycles : 0;
+ }
+
+ uint32_t Profiler::getMax(int stage) {
+  return stats[stage].maxCycles;
+ }
+
+ // Returns the value that percent of the samples are at or below, rounded up to the bucket limit
+ uint32_t Profiler::getPercentile(int stage,int percent) {
+  const StageStats* stageStats = &stats[stage];
+  uint32_t target = ((uint64_t)stageStats->count * percent + 99) / 100;
+  uint32_t seen = 0;
+  if(stageStats->count == 0) return 0;
+  for(int i = 0; i < PROFILE_BUCKETS; i++) {
+    seen += stageStats->buckets[i];
+    if(seen >= target && seen > 0) {
+      // The bucket limit can be above the largest sample
+      uint32_t limit = getBucketLimit(i);
+      return limit < stageStats->maxCycles ? limit : stageStats->maxCycles;
+    }
+  }
+  return stageStats->maxCycles;
+ }
+
+ /* Prints one line per stage that has samples:
+  *   stage count min p50 p90 p99 max
+  * with times in CPU cycles, after a header line with the CPU frequency.
+  */
+ template <typename Output>
+ void Profiler::dump(Output& output) {
+  output.print("#profile cycles mhz=");
+  output.println(CPU_FREQUENCY_MHZ);
+  for(int i = 0; i < PROFILE_STAGE_COUNT; i++) {
+    if(stats[i].count == 0) continue;
+    output.print(PROFILE_STAGE_NAMES[i]);
+    output.print(" ");
+    output.print((unsigned long)stats[i].count);
+    output.print(" ");
+    output.print((unsigned long)getMin(i));
+    output.print(" ");
+    output.print((unsigned long)getPercentile(i,50));
+    output.print(" ");
+    output.print((unsigned long)getPercentile(i,90));
+    output.print(" ");
+    output.print((unsigned long)getPercentile(i,99));
+    output.print(" ");
+    output.println((unsigned long)getMax(i));
+  }
+ }
+#endif
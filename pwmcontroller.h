@@ -14,11 +14,18 @@
  * 24 November 2020
  * - Created structure to store channel information
  * - Eliminated need for static function
+ * 18 October 2026
+ * - Hardware access goes through hal.h
+ * - update() skips the write when the duty cycle has not changed
+ * - The hardware is set up by begin() instead of the constructor, which runs before setup().
+ *   The channel is set up and given its duty cycle before the pin is attached to it
  */ 
 
 #ifndef PWMCONTROLLER_H
 #define PWMCONTROLLER_H
 
+#include "hal.h"
+
  struct ChannelData {
   int channelNumber;
   int wireNumber;
@@ -29,31 +36,60 @@
  class PWMController {
   private:
     ChannelData channelData;
+    int dutyCycle; // Last duty cycle written
+    bool isStarted;
   public:
     PWMController(int channelNumber,int wireNumber,int frequency,int resolution);
-    void update(int dutyCycle);
+    void begin();
+    bool update(int dutyCycle);
+    int getFrequency();
+    int getResolution();
  };
 
  PWMController::PWMController(int channelNumber,int wireNumber,int frequency,int resolution) {
-  // TODO:
-  // Check for valid and open channel number
-
+  // Channel numbers are checked for range and reuse when compiling (configcheck.h)
   channelData.channelNumber = channelNumber;
   channelData.wireNumber = wireNumber;
   channelData.frequency = frequency;
   channelData.resolution = resolution;
-  
-  // Attach pin to channel
-  ledcAttachPin(channelData.wireNumber,channelData.channelNumber);
 
-  // Initialize channel
-  ledcSetup(channelData.channelNumber,channelData.frequency,channelData.resolution);
+  // 0% duty cycle until update() is called, nothing is written until begin()
+  dutyCycle = 0;
+  isStarted = false;
+ }
+
+ /* Starts the PWM signal. The channel is set up and loaded with the duty cycle first, so the
+  * first thing on the pin once it is attached is the right signal
+  */
+ void PWMController::begin() {
+  halPWMSetup(channelData.channelNumber,channelData.frequency,channelData.resolution);
+  halPWMWrite(channelData.channelNumber,dutyCycle);
+  halPWMAttach(channelData.wireNumber,channelData.channelNumber);
+  isStarted = true;
+ }
+
+ // Writes the duty cycle if it changed, returns false if the write was skipped
+ // Before begin() the duty cycle is only kept, to be written when the signal starts
+ bool PWMController::update(int dutyCycle) {
+  if(!isStarted) {
+    this->dutyCycle = dutyCycle;
+    return false;
+  }
+  if(dutyCycle == this->dutyCycle) {
+    getOutputStats().elidedCount++;
+    return false;
+  }
+  this->dutyCycle = dutyCycle;
+  halPWMWrite(channelData.channelNumber,dutyCycle);
+  getOutputStats().writeCount++;
+  return true;
+ }
 
-  // Set to 0% duty cycle
-  ledcWrite(channelData.channelNumber,0);
+ int PWMController::getFrequency() {
+  return channelData.frequency;
  }
 
- void PWMController::update(int dutyCycle) {
-  ledcWrite(channelData.channelNumber,dutyCycle);
+ int PWMController::getResolution() {
+  return channelData.resolution;
  }
 #endif
@@ -0,0 +1,244 @@
+/* SensingTask class
+ * 18 October 2026
+ * 
+ * Runs the eye (EchoSweeper and its Ultrasonic sensor) apart from the control loop. With
+ * begin() the sensing work gets a FreeRTOS task pinned to its own core, so a slow echo or a
+ * sweep can never hold up the controller and actuators. Without it, runOnce() is called
+ * from loop() and does one non-blocking step.
+ * 
+ * The control side sends a SensorCommand and receives a SensorSnapshot, each through a
+ * lock-free TripleBuffer, so neither side ever waits for the other.
+ * 
+ * Every ping is also folded into an ObstacleMap, which is published with each new reading
+ * along with the reading itself.
+ * 
+ * The range sensors (a PingScheduler) are run in the same step. Their readings are published
+ * too, and the ones in the eye's range of angles go on the map. The eye's sensor is added to
+ * the scheduler as a shared sensor that follows the servo, so it takes turns with the range
+ * sensors pointing the same way.
+ * 
+ * Each complete sweep is passed to an ObjectTracker, and the tracks are published with the
+ * sweep.
+ * 
+ * The latest reading of the eye within EMERGENCY_STOP_ANGLE of straight ahead is kept with its
+ * time, so the control loop can slow down while it has not looked ahead for a while.
+ */ 
+
+#ifndef SENSINGTASK_H
+#define SENSINGTASK_H
+
+#include "config.h"
+#include "hal.h"
+#include "echosweeper.h"
+#include "triplebuffer.h"
+#include "profiler.h"
+#include "obstaclemap.h"
+#include "pingscheduler.h"
+#include "objecttracker.h"
+
+ // What the control loop wants the eye to do
+ struct SensorCommand {
+  bool isSweeping;
+  int eyeAngle; // Angle to point the eye when not sweeping
+  float travelSpeed; // Target speed of the car, the range sensors facing that way ping more often
+  int divisions; // Readings per sweep, a change takes effect from the next sweep
+ };
+
+ // Latest readings, published by the sensing side
+ struct SensorSnapshot {
+  double distance; // Last ping, or the average of the last sweep when sweeping (-1 if nothing in range)
+  bool isSweeping; // True from the moment a sweep command is taken, distance is then from a sweep
+  int eyeAngle; // Angle the last ping was taken at when not sweeping
+  unsigned long distanceTime; // Time the last ping was read when not sweeping (micros), 0 if none yet
+  double aheadDistance; // Latest reading of the eye straight ahead, sweeping or not (-1 if nothing in range)
+  unsigned long aheadTime; // Time it was read (millis), 0 if none yet
+  double sweepRate; // Sweeps per second achieved by the last sweep
+  double closingRate; // Change in distance (inches per second) when not sweeping, negative when closing
+  ScanFrame frame; // Last complete sweep
+  ScanPoint point; // Newest reading of the sweep
+  ObstacleMap map; // Obstacles seen by the latest pings
+  ObjectTracker objects; // Objects followed over the sweeps, updated when a sweep completes
+  double ranges[PING_SCHEDULER_MAX_SENSORS]; // Latest reading of each range sensor, -1 if nothing in range
+  unsigned long timestamp; // Time the snapshot was published (micros)
+  unsigned long sequence; // Increases by one per snapshot
+ };
+
+ class SensingTask {
+  private:
+    EchoSweeper* eye;
+    PingScheduler* rangeSensors;
+    int eyeSlot; // Index of the eye's sensor in rangeSensors, -1 if there is none
+    TripleBuffer<SensorCommand> commands;
+    TripleBuffer<SensorSnapshot> snapshots;
+    SensorSnapshot state; // Built up here, then copied into the snapshot buffer
+    bool wasSweeping;
+    void publish();
+    void updateEyeHeading();
+    void updateAhead(int angle,double distance);
+    static void taskStep(void* arg);
+    static SensorCommand initialCommand();
+    static SensorSnapshot initialSnapshot();
+  public:
+    SensingTask(EchoSweeper* eye,PingScheduler* rangeSensors);
+    bool begin(int core);
+    void runOnce();
+    void setCommand(bool isSweeping,int eyeAngle,float travelSpeed,int divisions);
+    bool update();
+    const SensorSnapshot& read();
+ };
+
+ // Constructor, rangeSensors may be 0 if there are none
+ SensingTask::SensingTask(EchoSweeper* eye,PingScheduler* rangeSensors) : commands(initialCommand()), snapshots(initialSnapshot()) {
+  this->eye = eye;
+  this->rangeSensors = rangeSensors;
+  eyeSlot = rangeSensors ? rangeSensors->addShared(eye->getSensor(),EYE_SERVO_HOME_ANGLE,ULTRASONIC_FIELD_OF_VIEW,
+    EYE_PING_PRIORITY) : -1;
+  state = initialSnapshot();
+  wasSweeping = false;
+ }
+
+ // Starts the sensing task pinned to a core, returns false if the task could not be created
+ bool SensingTask::begin(int core) {
+  // Waiting one tick between steps lets the idle task on that core run, a tick is short compared to a ping
+  return halStartTask(taskStep,this,"sensing",SENSING_TASK_STACK,SENSING_TASK_PRIORITY,core,1);
+ }
+
+ // Step of the sensing task
+ void SensingTask::taskStep(void* arg) {
+  ((SensingTask*)arg)->runOnce();
+ }
+
+ // Does one non-blocking step of sensing work, publishing a snapshot when there is a new reading
+ void SensingTask::runOnce() {
+  commands.update();
+  const SensorCommand& command = commands.read();
+  // A single ping from before the command is not reported as new once the eye sweeps
+  state.isSweeping = command.isSweeping;
+
+  if(command.isSweeping) {
+    eye->setDivisions(command.divisions);
+    // Start each sweep from the first step
+    if(!wasSweeping) eye->restartSweep();
+    updateEyeHeading();
+    PROFILE_START(STAGE_SWEEP);
+    bool isComplete = eye->update();
+    PROFILE_END(STAGE_SWEEP);
+    ScanPoint point;
+    bool isNewPoint = eye->getNewPoint(&point);
+    if(isNewPoint) {
+      state.map.addReading(point.angle,point.distance,halMillis());
+      updateAhead(point.angle,point.isValid ? point.distance : -1.0);
+      state.point = point;
+    }
+    if(isComplete) {
+      state.distance = eye->getAverageDistance();
+      state.sweepRate = eye->getSweepRate();
+      state.frame = eye->getFrame();
+      state.map.setSweepPeriod((state.frame.endTime - state.frame.startTime) / 1000);
+      PROFILE_START(STAGE_TRACK);
+      state.objects.update(state.frame);
+      PROFILE_END(STAGE_TRACK);
+    }
+    // Publish every ping so the map is always up to date
+    if(isNewPoint || isComplete) publish();
+  }
+  else {
+    eye->setAngle(command.eyeAngle);
+    updateEyeHeading();
+    PROFILE_START(STAGE_PING);
+    bool isReady = eye->updateDistance();
+    PROFILE_END(STAGE_PING);
+    if(isReady) {
+      state.distance = eye->getLastDistance();
+      state.closingRate = eye->getClosingRate();
+      state.eyeAngle = eye->getAngle();
+      state.distanceTime = halMicros();
+      state.map.addReading(state.eyeAngle,state.distance,halMillis());
+      updateAhead(state.eyeAngle,state.distance);
+      publish();
+    }
+  }
+  wasSweeping = command.isSweeping;
+
+  if(rangeSensors) {
+    bool isNewRange = false;
+    rangeSensors->setTravel(command.travelSpeed);
+    PROFILE_START(STAGE_RANGES);
+    rangeSensors->update();
+    PROFILE_END(STAGE_RANGES);
+    for(int i = 0; i < rangeSensors->getCount(); i++) {
+      if(!rangeSensors->getNewReading(i,&state.ranges[i])) continue;
+      int heading = rangeSensors->getHeading(i);
+      if(heading >= EYE_SERVO_MIN_ANGLE && heading <= EYE_SERVO_MAX_ANGLE) {
+        state.map.addReading(heading,state.ranges[i],halMillis());
+      }
+      isNewRange = true;
+    }
+    if(isNewRange) publish();
+  }
+ }
+
+ /* Tells the range sensors where the eye points before it pings. While the servo is moving the
+  * eye could be pointing anywhere on the way, so it takes turns with all of them.
+  */
+ void SensingTask::updateEyeHeading() {
+  if(!rangeSensors) return;
+  rangeSensors->setHeading(eyeSlot,eye->getAngle(),eye->isSettled() ? ULTRASONIC_FIELD_OF_VIEW : 360);
+ }
+
+ // Keeps a reading of the eye if it was taken straight ahead
+ void SensingTask::updateAhead(int angle,double distance) {
+  if(angle < 90 - EMERGENCY_STOP_ANGLE || angle > 90 + EMERGENCY_STOP_ANGLE) return;
+  state.aheadDistance = distance;
+  state.aheadTime = halMillis();
+  if(state.aheadTime == 0) state.aheadTime = 1;
+ }
+
+ // Hands the current state to the control side
+ void SensingTask::publish() {
+  state.timestamp = halMicros();
+  state.sequence++;
+  snapshots.getWriteBuffer() = state;
+  snapshots.publish();
+ }
+
+ // Control side: sets what the eye should do, and how the car is moving
+ void SensingTask::setCommand(bool isSweeping,int eyeAngle,float travelSpeed,int divisions) {
+  SensorCommand& command = commands.getWriteBuffer();
+  command.isSweeping = isSweeping;
+  command.eyeAngle = eyeAngle;
+  command.travelSpeed = travelSpeed;
+  command.divisions = divisions;
+  commands.publish();
+ }
+
+ // Control side: picks up the newest snapshot, returns true if there is a new one
+ bool SensingTask::update() {
+  return snapshots.update();
+ }
+
+ // Control side: returns the snapshot picked up by the last update()
+ const SensorSnapshot& SensingTask::read() {
+  return snapshots.read();
+ }
+
+ // Eye points home until the control loop says otherwise
+ SensorCommand SensingTask::initialCommand() {
+  SensorCommand command;
+  command.isSweeping = false;
+  command.eyeAngle = EYE_SERVO_HOME_ANGLE;
+  command.travelSpeed = 0;
+  command.divisions = EYE_DIVISIONS;
+  return command;
+ }
+
+ // Nothing has been detected yet
+ SensorSnapshot SensingTask::initialSnapshot() {
+  SensorSnapshot snapshot = SensorSnapshot(); // Zeroed, and the map is empty
+  snapshot.distance = -1.0;
+  snapshot.eyeAngle = EYE_SERVO_HOME_ANGLE;
+  snapshot.aheadDistance = -1.0;
+  for(int i = 0; i < PING_SCHEDULER_MAX_SENSORS; i++) snapshot.ranges[i] = -1.0;
+  return snapshot;
+ }
+#endif
@@ -4,6 +4,13 @@
  *  24 November 2020
  *  - Updated to support PWMController class
  *  - Renamed class to ServoESP32 
+ *  18 October 2026
+ *  - Added a motion model (commanded angle, time of the command and slew rate) used to
+ *    predict when the servo has actually reached its target, see isSettled()
+ *  - Hardware access goes through hal.h
+ *  - Duty cycles are integer and work for any PWM resolution and frequency (dutycycle.h)
+ *  - Added profileOutput() so a MotionProfile can ramp the angle (motionprofile.h)
+ *  - The PWM starts in begin(), straight at the home angle, instead of in the constructor
  *  
  *  VERSION HISTORY
  * ---------------
@@ -24,7 +31,10 @@
  #ifndef SERVOESP32_H
  #define SERVOESP32_H
 
+ #include "config.h"
+ #include "hal.h"
  #include "pwmcontroller.h"
+ #include "dutycycle.h"
 
 // Servo class definition
 class ServoESP32 {
@@ -34,14 +44,27 @@ class ServoESP32 {
     int maxAngle; // The maximum angle the servo can travel
     int homeAngle; // The angle considered to be home
     int PWMChannel; // The PWM signal that controls the servo angle
+    int startAngle; // The estimated angle when the last command was given
+    float slewRate; // How fast the servo moves in degrees per millisecond
+    unsigned long settleMicros; // Time allowed for the servo to stop oscillating after a move
+    unsigned long commandTime; // Time the last command was given
+    unsigned long travelMicros; // Predicted time for the last command to complete
+    uint32_t minDuty; // Duty cycle at 0 degrees
+    uint32_t dutySpan; // Duty cycle from 0 degrees to SERVO_ANGLE_RANGE
     PWMController pwmControl;
     
   public:
     ServoESP32(int minAngle,int maxAngle,int homeAngle,int PWMChannel,int PWMWire,int PWMFrequency,int PWMResolution);
+    void begin();
     int calculateDutyCycle(int angle); // Calculate PWM duty cycle for servo angle
     int getAngle();
     bool goHome();
     bool setAngle(int desiredAngle); 
+    void setMotionModel(float slewRate,unsigned long settleMicros);
+    int getEstimatedAngle();
+    unsigned long getSettleTime();
+    bool isSettled();
+    static float profileOutput(float angle,void* servo);
     
 };
 
@@ -56,21 +79,38 @@ ServoESP32::ServoESP32(int minAngle,int maxAngle,int homeAngle,int PWMChannel,in
   this->homeAngle = homeAngle;
   this->currentAngle = homeAngle;
   this->PWMChannel = PWMChannel;
+  this->startAngle = homeAngle;
+  this->slewRate = SERVO_SLEW_RATE;
+  this->settleMicros = SERVO_SETTLE_MICROS;
+  this->commandTime = 0;
+  this->travelMicros = 0;
+
+  // Duty cycles of the ends of the servo travel, for this PWM frequency and resolution
+  minDuty = dutyFromPulse(SERVO_MIN_PULSE_MICROS,PWMFrequency,PWMResolution);
+  dutySpan = dutyFromPulse(SERVO_MAX_PULSE_MICROS,PWMFrequency,PWMResolution) - minDuty;
   
   // Go to home position
   goHome();
 }
 
+/* Starts the PWM signal, its first pulse is the angle set so far (home). Where the servo was at
+ * power up is not known, so it is not counted as settled until it could have come from either end
+ */
+void ServoESP32::begin() {
+  pwmControl.begin();
+  startAngle = abs(currentAngle - minAngle) > abs(maxAngle - currentAngle) ? minAngle : maxAngle;
+  commandTime = halMicros();
+  travelMicros = (abs(currentAngle - startAngle) * 1000.0) / slewRate + settleMicros;
+}
+
 // Calculates the PWM duty cycle for a given input angle
 int ServoESP32::calculateDutyCycle(int angle) {
  
-  /* 0 degrees = 1ms = 5% duty cycle -> 180 degrees = 2ms = 10% duty cycle (See datasheet for more info)
-   *  NOTE: 2^12 = 4096, for 12 bit resolution
-   *  TODO: Adjust to work with resolutions other than 12-bit
+  /* 0 degrees = 1ms = 5% duty cycle -> 180 degrees = 2ms = 10% duty cycle at 50Hz (See datasheet for more info)
+   *  The duty cycles of the ends are worked out in the constructor, so this is integer only
    */ 
 
-   double dutyCycle = (1.0/3600.0)*angle + 0.05;
-   return 4096*dutyCycle;
+  return dutyFromAngle(angle,minDuty,dutySpan,SERVO_ANGLE_RANGE);
 }
 
 // Returns the current angle of the servo
@@ -93,10 +133,50 @@ bool ServoESP32::setAngle(int desiredAngle) {
   }
   
    pwmControl.update(calculateDutyCycle(desiredAngle));
+
+  // Start a new move from wherever the servo is now, unless it is already headed there
+  if(desiredAngle != currentAngle) {
+    startAngle = getEstimatedAngle();
+    commandTime = halMicros();
+    travelMicros = (abs(desiredAngle - startAngle) * 1000.0) / slewRate + settleMicros;
+  }
   
   // Update currentAngle
   currentAngle = desiredAngle;
   return true;
 }
 
+// Sets the speed of the servo in degrees per millisecond and the time it takes to settle after a move
+void ServoESP32::setMotionModel(float slewRate,unsigned long settleMicros) {
+  if(slewRate <= 0) return;
+  this->slewRate = slewRate;
+  this->settleMicros = settleMicros;
+}
+
+// Returns where the servo should be right now, based on the motion model
+int ServoESP32::getEstimatedAngle() {
+  float travelled = slewRate * (halMicros() - commandTime) / 1000.0;
+  int remaining = currentAngle - startAngle;
+
+  if(travelled >= abs(remaining)) return currentAngle;
+  if(remaining > 0) return startAngle + travelled;
+  return startAngle - travelled;
+}
+
+// Returns the time (micros) when the servo is predicted to have reached and settled at its target
+unsigned long ServoESP32::getSettleTime() {
+  return commandTime + travelMicros;
+}
+
+// Returns true once the servo is predicted to have reached and settled at its target
+bool ServoESP32::isSettled() {
+  return halMicros() - commandTime >= travelMicros;
+}
+
+// MotionOutput for a MotionProfile, rounds to the nearest degree (the angle taken if out of range)
+float ServoESP32::profileOutput(float angle,void* servo) {
+  if(((ServoESP32*)servo)->setAngle((int)(angle + 0.5))) return angle;
+  return ((ServoESP32*)servo)->getAngle();
+}
+
 #endif
@@ -0,0 +1,41 @@
+/* Arduino.h stand-in for the simulator
+ * 18 October 2026
+ * 
+ * Provides the small part of the Arduino/ESP32 core that the ARC headers and ARC.ino use
+ * outside of the HAL (types, constants and Serial), so they compile on a PC unchanged.
+ * Hardware access itself goes through hal.h, which is routed to SimBoard.
+ */ 
+
+#ifndef SIM_ARDUINO_H
+#define SIM_ARDUINO_H
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <cmath>
+#include <cstdlib>
+
+// Arduino's abs() is a macro that works on floats too
+using std::abs;
+
+typedef uint8_t byte;
+typedef bool boolean;
+
+#define HIGH 1
+#define LOW 0
+#define INPUT 0x01
+#define OUTPUT 0x03
+#define INPUT_PULLUP 0x05
+#define RISING 0x01
+#define FALLING 0x02
+#define CHANGE 0x03
+#define SERIAL_8N1 0x800001c
+#define IRAM_ATTR
+
+typedef uint32_t TickType_t;
+#define pdMS_TO_TICKS(x) ((TickType_t)(x))
+
+#include "simserial.h"
+
+#endif
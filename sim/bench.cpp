@@ -0,0 +1,593 @@
+/* ARC benchmarks
+ * 18 October 2026
+ *
+ * Times the control and sensing code of the car on a PC, so performance work on the class
+ * headers can be measured without flashing a board. Each benchmark runs one stage of the
+ * firmware (the same headers, compiled for the simulator) over a trace of controller buttons
+ * and eye readings: the built in synthetic trace, or a flash log recorded on the car.
+ *
+ * Usage: arcbench [--trace file] [--baseline file] [--save-baseline file] [--tolerance percent]
+ *   --trace file          use the buttons and eye readings of a flash log (read from the car,
+ *                         or saved with arcsim --save-log) instead of the synthetic trace
+ *   --baseline file       compare with a baseline, and exit with 1 if a benchmark is slower by
+ *                         more than the tolerance or allocates more than before
+ *   --save-baseline file  write the results as a new baseline
+ *   --tolerance percent   slowdown allowed before a benchmark is a regression (default 25)
+ *
+ * For each benchmark: ns/op is the best of BENCH_SAMPLES timed runs, allocs/op counts calls
+ * to operator new, per loop is how often the stage runs per control period of the trace
+ * (CONTROL_PERIOD_MILLIS) and ns/loop is its share of the loop. The loop equivalent line
+ * adds the shares up into the time one control loop of work takes on this PC.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <new>
+#include <vector>
+#include <algorithm>
+#include <Arduino.h>
+#include "config.h"
+#include "hal.h"
+#include "controlleraction.h"
+#include "dutycycle.h"
+#include "filter.h"
+#include "obstaclemap.h"
+#include "objecttracker.h"
+#include "motionprofile.h"
+#include "telemetry.h"
+#include "logcodec.h"
+
+ const int BENCH_SAMPLES = 5; // Timed runs of each benchmark, the best one counts
+ const unsigned long long BENCH_SAMPLE_NANOS = 50000000; // Shortest timed run
+ const unsigned long BENCH_TRACE_MILLIS = 10000; // Length of the synthetic trace
+ const unsigned long BENCH_SWEEP_MILLIS = 6000; // The synthetic trace sweeps until here, then holds the eye ahead
+ const int BENCH_PING_MILLIS = 18; // Time between eye readings in the synthetic trace
+ const double BENCH_DEFAULT_TOLERANCE = 25;
+ const double BENCH_MIN_SLOWDOWN_NANOS = 1.0; // Smaller slowdowns are timer noise, never a regression
+
+ // Counts every allocation, the firmware is meant to make none after setup()
+ unsigned long long allocationCount = 0;
+
+ void* operator new(size_t size) {
+  allocationCount++;
+  void* memory = malloc(size ? size : 1);
+  if(!memory) throw std::bad_alloc();
+  return memory;
+ }
+
+ void operator delete(void* memory) noexcept {
+  free(memory);
+ }
+
+ // Takes telemetry frames and throws them away, as fast as they come
+ class NullPrint : public Print {
+  public:
+    size_t write(uint8_t value) { return 1; }
+    size_t write(const uint8_t* buffer,size_t size) { return size; }
+    int availableForWrite() { return TELEMETRY_BUFFER_SIZE; }
+ };
+
+ // Stages of the firmware as they would see the trace, worked out before timing
+ struct BenchTrace {
+  unsigned long loops; // Control periods in the trace
+  std::vector<byte> buttons; // Controller data at each control period
+  std::vector<float> speeds; // Targets from ControllerAction at each control period
+  std::vector<int> steeringAngles;
+  std::vector<int> eyeAngles;
+  std::vector<ScanPoint> points; // Sweep readings, timestamps in millis
+  std::vector<ScanPoint> distances; // Readings with the eye held at one angle
+  std::vector<ObstacleMap> maps; // Obstacle map at each control period
+  std::vector<ScanFrame> frames; // Sweep readings grouped into complete sweeps, timestamps in micros
+  std::vector<LogRecord> records; // Everything the flash log would record
+  std::vector<uint8_t> pages; // records encoded as flash log pages
+ };
+
+ typedef unsigned long (*BenchFunction)(const BenchTrace& trace); // One pass, returns the operations done
+
+ struct Benchmark {
+  const char* name;
+  BenchFunction function;
+ };
+
+ struct BenchResult {
+  const char* name;
+  double nsPerOp;
+  double allocsPerOp;
+  double perLoop;
+ };
+
+ struct BaselineEntry {
+  char name[32];
+  double nsPerOp;
+  double allocsPerOp;
+ };
+
+ volatile uint32_t sink; // Results go here so the compiler cannot drop the work
+ volatile int servoResolution = EYE_PWM_RESOLUTION; // Read at run time, as the classes do
+ volatile int motorResolution = REAR_MOTOR_PWM_RESOLUTION;
+
+ unsigned long long nowNanos() {
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC,&now);
+  return now.tv_sec * 1000000000ULL + now.tv_nsec;
+ }
+
+ // Deterministic noise for the synthetic trace, 0 to 1
+ double benchRandom() {
+  static uint32_t state = 12345;
+  state = state * 1664525 + 1013904223;
+  return (state >> 8) / 16777216.0;
+ }
+
+ // Distance the synthetic eye sees at an angle, -1 if nothing is in range
+ double syntheticDistance(int angle,unsigned long time) {
+  double distance = -1;
+  if(angle >= 70 && angle <= 110) distance = 50 - 20.0 * time / BENCH_TRACE_MILLIS;
+  if(angle >= 130) distance = 30;
+  if(distance < 0 || benchRandom() < 0.05) return -1;
+  return distance + benchRandom() - 0.5;
+ }
+
+ // Buttons held in the synthetic trace: forward, fast, a turn, moving the eye by hand and stopping
+ byte syntheticButtons(unsigned long time) {
+  if(time < 500) return 0x00;
+  if(time < 2000) return 0x10;
+  if(time < 3000) return 0x12;
+  if(time < 4000) return 0x50;
+  if(time < 5000) return 0x41;
+  if(time < 6000) return 0x81;
+  if(time < 8000) return 0x90;
+  return 0x00;
+ }
+
+ // Builds the synthetic trace as flash log records, in time order
+ void makeSyntheticTrace(std::vector<LogRecord>* records) {
+  int step = (EYE_SERVO_MAX_ANGLE - EYE_SERVO_MIN_ANGLE) / (EYE_DIVISIONS - 1);
+  int index = 0;
+  int direction = 1;
+  byte lastButtons = 0xFF;
+  for(unsigned long time = 0; time < BENCH_TRACE_MILLIS; time++) {
+    byte buttons = syntheticButtons(time);
+    if(buttons != lastButtons) {
+      LogRecord record = {LOG_CONTROLLER,time,{buttons,0,0}};
+      records->push_back(record);
+      lastButtons = buttons;
+    }
+    if(time % BENCH_PING_MILLIS != 0) continue;
+    if(time < BENCH_SWEEP_MILLIS) {
+      int angle = EYE_SERVO_MIN_ANGLE + index * step;
+      LogRecord record = {LOG_SCAN_POINT,time,{angle,logTenths(syntheticDistance(angle,time)),0}};
+      records->push_back(record);
+      if(index + direction < 0 || index + direction >= EYE_DIVISIONS) direction = -direction;
+      index += direction;
+    }
+    else {
+      LogRecord record = {LOG_DISTANCE,time,{EYE_SERVO_HOME_ANGLE,logTenths(syntheticDistance(EYE_SERVO_HOME_ANGLE,time)),0}};
+      records->push_back(record);
+    }
+  }
+ }
+
+ // Reads the last run in a flash log, as arcsim --replay does. Returns false if there are no records
+ bool loadTrace(const char* fileName,std::vector<LogRecord>* records) {
+  FILE* file = fopen(fileName,"rb");
+  if(!file) return false;
+  std::vector<uint8_t> data;
+  uint8_t page[LOG_PAGE_SIZE];
+  while(fread(page,1,LOG_PAGE_SIZE,file) == (size_t)LOG_PAGE_SIZE) data.insert(data.end(),page,page + LOG_PAGE_SIZE);
+  fclose(file);
+
+  std::vector<std::pair<uint32_t,size_t> > pages;
+  LogDecoder decoder;
+  LogRecord record;
+  for(size_t offset = 0; offset < data.size(); offset += LOG_PAGE_SIZE) {
+    if(decoder.beginPage(&data[offset])) pages.push_back(std::make_pair(decoder.getSequence(),offset));
+  }
+  std::sort(pages.begin(),pages.end());
+  for(size_t i = 0; i < pages.size(); i++) {
+    decoder.beginPage(&data[pages[i].second]);
+    if(!records->empty() && decoder.getStartTime() < records->back().time) records->clear();
+    while(decoder.next(&record)) records->push_back(record);
+  }
+  return !records->empty();
+ }
+
+ // Works out what each stage sees from the records, the way the firmware would
+ void buildTrace(const std::vector<LogRecord>& records,BenchTrace* trace) {
+  unsigned long startTime = records.front().time;
+  unsigned long duration = records.back().time - startTime + 1;
+  ControllerAction action;
+  ObstacleMap map;
+  byte buttons = 0x00;
+  float speed = 0;
+  int steeringAngle = STEERING_SERVO_HOME_ANGLE;
+  int eyeAngle = EYE_SERVO_HOME_ANGLE;
+  size_t next = 0;
+
+  trace->loops = (duration + CONTROL_PERIOD_MILLIS - 1) / CONTROL_PERIOD_MILLIS;
+  for(unsigned long loop = 0; loop < trace->loops; loop++) {
+    unsigned long loopTime = startTime + loop * CONTROL_PERIOD_MILLIS;
+    while(next < records.size() && records[next].time <= loopTime) {
+      const LogRecord& record = records[next++];
+      ScanPoint point = {record.values[0],record.values[1] / 10.0,false,record.time};
+      if(record.values[1] < 0) point.distance = -1;
+      point.isValid = point.distance >= EYE_MIN_RANGE && point.distance <= EYE_MAX_RANGE;
+      if(record.type == LOG_CONTROLLER) buttons = record.values[0];
+      if(record.type == LOG_SCAN_POINT) {
+        trace->points.push_back(point);
+        map.addReading(point.angle,point.distance,point.timestamp);
+      }
+      if(record.type == LOG_DISTANCE) trace->distances.push_back(point);
+    }
+    if(action.update(buttons)) action.respond(buttons,&speed,&steeringAngle,&eyeAngle);
+    trace->buttons.push_back(buttons);
+    trace->speeds.push_back(speed);
+    trace->steeringAngles.push_back(steeringAngle);
+    trace->eyeAngles.push_back(eyeAngle);
+    trace->maps.push_back(map);
+  }
+  trace->records = records;
+
+  // Every EYE_DIVISIONS readings make a sweep, stored in order of angle like EchoSweeper does
+  ScanFrame frame = ScanFrame();
+  for(size_t i = 0; i + EYE_DIVISIONS <= trace->points.size(); i += EYE_DIVISIONS) {
+    frame.count = EYE_DIVISIONS;
+    frame.isForward = trace->points[i].angle < trace->points[i + EYE_DIVISIONS - 1].angle;
+    frame.sequence++;
+    for(int j = 0; j < EYE_DIVISIONS; j++) {
+      frame.points[j] = trace->points[i + (frame.isForward ? j : EYE_DIVISIONS - 1 - j)];
+      frame.points[j].timestamp *= 1000;
+    }
+    trace->frames.push_back(frame);
+  }
+
+  // Pages for the decoder, as the flash log would write them
+  LogEncoder encoder;
+  uint32_t sequence = 0;
+  for(size_t i = 0; i < records.size(); i++) {
+    if(sequence == 0 || !encoder.add(records[i])) {
+      trace->pages.resize(trace->pages.size() + LOG_PAGE_SIZE);
+      encoder.beginPage(&trace->pages[trace->pages.size() - LOG_PAGE_SIZE],sequence++,records[i].time);
+      encoder.add(records[i]);
+    }
+  }
+ }
+
+ // ControllerAction::update() on the buttons of every control period
+ unsigned long benchControllerUpdate(const BenchTrace& trace) {
+  ControllerAction action;
+  for(unsigned long i = 0; i < trace.loops; i++) {
+    if(action.update(trace.buttons[i])) sink += action.getPressed();
+  }
+  return trace.loops;
+ }
+
+ // ControllerAction::respond() every control period, the worst case of the buttons always changing
+ unsigned long benchControllerRespond(const BenchTrace& trace) {
+  ControllerAction action;
+  float speed = 0;
+  int steeringAngle = STEERING_SERVO_HOME_ANGLE;
+  int eyeAngle = EYE_SERVO_HOME_ANGLE;
+  for(unsigned long i = 0; i < trace.loops; i++) {
+    action.respond(trace.buttons[i],&speed,&steeringAngle,&eyeAngle);
+    sink += steeringAngle + eyeAngle;
+  }
+  return trace.loops;
+ }
+
+ // Steering and eye servo duty cycles, as ServoESP32::calculateDutyCycle() works them out
+ unsigned long benchServoDuty(const BenchTrace& trace) {
+  int resolution = servoResolution;
+  uint32_t minDuty = dutyFromPulse(SERVO_MIN_PULSE_MICROS,EYE_PWM_FREQENCY,resolution);
+  uint32_t dutySpan = dutyFromPulse(SERVO_MAX_PULSE_MICROS,EYE_PWM_FREQENCY,resolution) - minDuty;
+  for(unsigned long i = 0; i < trace.loops; i++) {
+    sink += dutyFromAngle(trace.steeringAngles[i],minDuty,dutySpan,SERVO_ANGLE_RANGE);
+    sink += dutyFromAngle(trace.eyeAngles[i],minDuty,dutySpan,SERVO_ANGLE_RANGE);
+  }
+  return 2 * trace.loops;
+ }
+
+ // Motor duty cycle, as Motor::calculateDutyCycle() works it out
+ unsigned long benchMotorDuty(const BenchTrace& trace) {
+  int resolution = motorResolution;
+  for(unsigned long i = 0; i < trace.loops; i++) {
+    uint32_t fraction = abs(trace.speeds[i]) * (1UL << DUTY_FRACTION_BITS);
+    sink += dutyFromFraction(fraction,resolution);
+  }
+  return trace.loops;
+ }
+
+ /* One step of a sweep per reading, as EchoSweeper does it: ping until the readings agree (the
+  * reading with a little jitter each time), then store the estimate. A full frame is sent
+  * over telemetry.
+  */
+ unsigned long benchSweepStep(const BenchTrace& trace) {
+  static const double JITTER[EYE_SAMPLES_MAX] = {0,0.4,-0.3};
+  static NullPrint output;
+  static ScanFrame frame;
+  static Telemetry telemetry(&output);
+  MedianFilter filter(ULTRASONIC_AGREE_TOLERANCE);
+  frame.count = 0;
+  for(size_t i = 0; i < trace.points.size(); i++) {
+    const ScanPoint& point = trace.points[i];
+    for(int sample = 0; sample < EYE_SAMPLES_MAX; sample++) {
+      filter.add(point.distance < 0 ? -1 : point.distance + JITTER[sample]);
+      if(filter.isAgreed(ULTRASONIC_AGREE_COUNT)) break;
+    }
+    ScanPoint& stored = frame.points[frame.count++];
+    stored.angle = point.angle;
+    stored.distance = filter.getEstimate();
+    stored.isValid = stored.distance >= EYE_MIN_RANGE && stored.distance <= EYE_MAX_RANGE;
+    filter.reset();
+    if(frame.count == EYE_DIVISIONS) {
+      telemetry.sendScan(frame);
+      telemetry.flush();
+      frame.count = 0;
+    }
+  }
+  return trace.points.size();
+ }
+
+ // AlphaBetaFilter::update() on each reading taken with the eye held still
+ unsigned long benchAlphaBeta(const BenchTrace& trace) {
+  AlphaBetaFilter filter(EYE_FILTER_ALPHA,EYE_FILTER_BETA,EYE_FILTER_GATE,EYE_FILTER_MAX_MISSES);
+  for(size_t i = 0; i < trace.distances.size(); i++) {
+    sink += filter.update(trace.distances[i].distance,trace.distances[i].timestamp * 1000);
+  }
+  return trace.distances.size();
+ }
+
+ // ObstacleMap::addReading() on each sweep reading
+ unsigned long benchMapAdd(const BenchTrace& trace) {
+  ObstacleMap map;
+  for(size_t i = 0; i < trace.points.size(); i++) {
+    map.addReading(trace.points[i].angle,trace.points[i].distance,trace.points[i].timestamp);
+  }
+  sink += map.getDensity(OBSTACLE_MAP_BINS / 2,trace.points.empty() ? 0 : trace.points.back().timestamp) > 0;
+  return trace.points.size();
+ }
+
+ // ObjectTracker::update() on each complete sweep
+ unsigned long benchTrackerUpdate(const BenchTrace& trace) {
+  static ObjectTracker tracker;
+  tracker.reset();
+  for(size_t i = 0; i < trace.frames.size(); i++) tracker.update(trace.frames[i]);
+  sink += tracker.getCount();
+  return trace.frames.size();
+ }
+
+ /* MotionProfile::step() for the rear motor and the steering, as often as the timer steps them
+  * in a control period, heading for the targets of the trace
+  */
+ unsigned long benchMotionStep(const BenchTrace& trace) {
+  MotionProfile drive(DRIVE_SLEW_RATE,DRIVE_ACCELERATION,DRIVE_JERK,-1.0,1.0);
+  MotionProfile steering(STEERING_SLEW_RATE,STEERING_ACCELERATION,STEERING_JERK,
+    STEERING_SERVO_MIN_ANGLE,STEERING_SERVO_MAX_ANGLE);
+  steering.reset(STEERING_SERVO_HOME_ANGLE);
+  unsigned long steps = 0;
+  unsigned long long stepTime = 0; // Micros, the timer's steps against the control periods
+  for(unsigned long i = 0; i < trace.loops; i++) {
+    drive.setTarget(trace.speeds[i]);
+    steering.setTarget(trace.steeringAngles[i]);
+    for(; stepTime < (i + 1) * CONTROL_PERIOD_MILLIS * 1000ULL; stepTime += MOTION_PROFILE_PERIOD_MICROS) {
+      sink += drive.step() + steering.step();
+      steps += 2;
+    }
+  }
+  return steps;
+ }
+
+ // ObstacleMap::chooseHeading() every control period, on the map as it was then
+ unsigned long benchMapChoose(const BenchTrace& trace) {
+  unsigned long startTime = trace.records.front().time;
+  for(unsigned long i = 0; i < trace.loops; i++) {
+    int heading;
+    float speed;
+    if(trace.maps[i].chooseHeading(startTime + i * CONTROL_PERIOD_MILLIS,90,&heading,&speed)) sink += heading;
+  }
+  return trace.loops;
+ }
+
+ // Controller and actuator telemetry every control period, decimated as in ARC.ino
+ unsigned long benchTelemetry(const BenchTrace& trace) {
+  static NullPrint output;
+  static Telemetry telemetry(&output);
+  static bool isSetUp = false;
+  if(!isSetUp) {
+    telemetry.setDecimation(TELEMETRY_CONTROLLER,TELEMETRY_STATE_DECIMATION);
+    telemetry.setDecimation(TELEMETRY_ACTUATORS,TELEMETRY_STATE_DECIMATION);
+    isSetUp = true;
+  }
+  for(unsigned long i = 0; i < trace.loops; i++) {
+    telemetry.sendController(i,trace.buttons[i]);
+    telemetry.sendActuators(i,trace.speeds[i],trace.steeringAngles[i],trace.eyeAngles[i]);
+    telemetry.flush();
+  }
+  return trace.loops;
+ }
+
+ // LogEncoder::add() on every record, starting pages as FlashLog does
+ unsigned long benchLogEncode(const BenchTrace& trace) {
+  static uint8_t page[LOG_PAGE_SIZE];
+  LogEncoder encoder;
+  uint32_t sequence = 0;
+  encoder.beginPage(page,sequence++,trace.records.front().time);
+  for(size_t i = 0; i < trace.records.size(); i++) {
+    if(encoder.add(trace.records[i])) continue;
+    encoder.beginPage(page,sequence++,trace.records[i].time);
+    encoder.add(trace.records[i]);
+  }
+  sink += sequence;
+  return trace.records.size();
+ }
+
+ // LogDecoder::next() on every record of the encoded pages
+ unsigned long benchLogDecode(const BenchTrace& trace) {
+  unsigned long count = 0;
+  for(size_t offset = 0; offset < trace.pages.size(); offset += LOG_PAGE_SIZE) {
+    LogDecoder decoder;
+    LogRecord record;
+    decoder.beginPage(&trace.pages[offset]);
+    while(decoder.next(&record)) {
+      sink += record.values[0];
+      count++;
+    }
+  }
+  return count;
+ }
+
+ const Benchmark BENCHMARKS[] = {
+  {"controller.update",benchControllerUpdate},
+  {"controller.respond",benchControllerRespond},
+  {"duty.servo",benchServoDuty},
+  {"duty.motor",benchMotorDuty},
+  {"sweep.step",benchSweepStep},
+  {"filter.alphabeta",benchAlphaBeta},
+  {"map.add",benchMapAdd},
+  {"map.choose",benchMapChoose},
+  {"tracker.update",benchTrackerUpdate},
+  {"motion.step",benchMotionStep},
+  {"telemetry.state",benchTelemetry},
+  {"log.encode",benchLogEncode},
+  {"log.decode",benchLogDecode}
+ };
+ const int BENCHMARK_COUNT = sizeof(BENCHMARKS) / sizeof(BENCHMARKS[0]);
+
+ // Times one benchmark, ns/op is the best of the samples and allocs/op is over all of them
+ BenchResult runBenchmark(const Benchmark& benchmark,const BenchTrace& trace) {
+  BenchResult result = {benchmark.name,0,0,0};
+  unsigned long long totalOps = 0;
+  unsigned long long allocations = 0;
+  unsigned long opsPerPass = benchmark.function(trace); // Warm up
+  result.perLoop = (double)opsPerPass / trace.loops;
+  if(opsPerPass == 0) return result;
+
+  for(int sample = 0; sample < BENCH_SAMPLES; sample++) {
+    unsigned long long ops = 0;
+    unsigned long long startAllocations = allocationCount;
+    unsigned long long startTime = nowNanos();
+    unsigned long long elapsed;
+    do {
+      ops += benchmark.function(trace);
+      elapsed = nowNanos() - startTime;
+    } while(elapsed < BENCH_SAMPLE_NANOS);
+    allocations += allocationCount - startAllocations;
+    totalOps += ops;
+    double nsPerOp = (double)elapsed / ops;
+    if(sample == 0 || nsPerOp < result.nsPerOp) result.nsPerOp = nsPerOp;
+  }
+  result.allocsPerOp = (double)allocations / totalOps;
+  return result;
+ }
+
+ // Reads a baseline written by --save-baseline, returns false if it cannot be read
+ bool readBaseline(const char* fileName,std::vector<BaselineEntry>* baseline) {
+  FILE* file = fopen(fileName,"r");
+  if(!file) return false;
+  char line[128];
+  while(fgets(line,sizeof(line),file)) {
+    BaselineEntry entry;
+    if(line[0] == '#') continue;
+    if(sscanf(line,"%31s %lf %lf",entry.name,&entry.nsPerOp,&entry.allocsPerOp) == 3) baseline->push_back(entry);
+  }
+  fclose(file);
+  return true;
+ }
+
+ bool writeBaseline(const char* fileName,const std::vector<BenchResult>& results) {
+  FILE* file = fopen(fileName,"w");
+  if(!file) return false;
+  fprintf(file,"# ARC benchmark baseline, written by arcbench --save-baseline\n");
+  fprintf(file,"# name ns/op allocs/op\n");
+  for(size_t i = 0; i < results.size(); i++) {
+    fprintf(file,"%s %.2f %.4f\n",results[i].name,results[i].nsPerOp,results[i].allocsPerOp);
+  }
+  fclose(file);
+  return true;
+ }
+
+ const BaselineEntry* findBaseline(const std::vector<BaselineEntry>& baseline,const char* name) {
+  for(size_t i = 0; i < baseline.size(); i++) {
+    if(strcmp(baseline[i].name,name) == 0) return &baseline[i];
+  }
+  return 0;
+ }
+
+ int main(int argc,char** argv) {
+  const char* traceFile = 0;
+  const char* baselineFile = 0;
+  const char* saveBaselineFile = 0;
+  double tolerance = BENCH_DEFAULT_TOLERANCE;
+  for(int i = 1; i < argc; i++) {
+    if(strcmp(argv[i],"--trace") == 0 && i + 1 < argc) traceFile = argv[++i];
+    else if(strcmp(argv[i],"--baseline") == 0 && i + 1 < argc) baselineFile = argv[++i];
+    else if(strcmp(argv[i],"--save-baseline") == 0 && i + 1 < argc) saveBaselineFile = argv[++i];
+    else if(strcmp(argv[i],"--tolerance") == 0 && i + 1 < argc) tolerance = atof(argv[++i]);
+    else {
+      fprintf(stderr,"Usage: arcbench [--trace file] [--baseline file] [--save-baseline file] [--tolerance percent]\n");
+      return 1;
+    }
+  }
+
+  std::vector<LogRecord> records;
+  if(traceFile) {
+    if(!loadTrace(traceFile,&records)) {
+      fprintf(stderr,"No log records in %s\n",traceFile);
+      return 1;
+    }
+  }
+  else {
+    makeSyntheticTrace(&records);
+  }
+  std::vector<BaselineEntry> baseline;
+  if(baselineFile && !readBaseline(baselineFile,&baseline)) {
+    fprintf(stderr,"Cannot read %s\n",baselineFile);
+    return 1;
+  }
+
+  BenchTrace trace;
+  buildTrace(records,&trace);
+  printf("Trace %s: %lu control periods, %lu records, %lu sweep readings, %lu held readings\n",
+    traceFile ? traceFile : "synthetic",trace.loops,(unsigned long)trace.records.size(),
+    (unsigned long)trace.points.size(),(unsigned long)trace.distances.size());
+  printf("%-20s %9s %9s %9s %10s %12s\n","","per loop","ns/op","ns/loop","allocs/op","vs baseline");
+
+  std::vector<BenchResult> results;
+  double loopNanos = 0;
+  int regressions = 0;
+  for(int i = 0; i < BENCHMARK_COUNT; i++) {
+    BenchResult result = runBenchmark(BENCHMARKS[i],trace);
+    results.push_back(result);
+    loopNanos += result.nsPerOp * result.perLoop;
+    printf("%-20s %9.3f %9.2f %9.2f %10.4f",result.name,result.perLoop,result.nsPerOp,
+      result.nsPerOp * result.perLoop,result.allocsPerOp);
+
+    const BaselineEntry* entry = findBaseline(baseline,result.name);
+    if(entry && entry->nsPerOp > 0) {
+      double change = 100 * (result.nsPerOp - entry->nsPerOp) / entry->nsPerOp;
+      printf(" %+11.1f%%",change);
+      bool isSlower = change > tolerance && result.nsPerOp - entry->nsPerOp > BENCH_MIN_SLOWDOWN_NANOS;
+      if(isSlower || result.allocsPerOp > entry->allocsPerOp) {
+        printf("  REGRESSION");
+        regressions++;
+      }
+    }
+    printf("\n");
+  }
+  printf("Loop equivalent      %.1f ns of work per control period, %.0f loops per second on this PC\n",
+    loopNanos,loopNanos > 0 ? 1e9 / loopNanos : 0);
+
+  if(saveBaselineFile) {
+    if(!writeBaseline(saveBaselineFile,results)) {
+      fprintf(stderr,"Cannot write %s\n",saveBaselineFile);
+      return 1;
+    }
+    printf("Baseline saved to %s\n",saveBaselineFile);
+  }
+  if(baselineFile) {
+    printf("%d regressions against %s (tolerance %.0f%%)\n",regressions,baselineFile,tolerance);
+    if(regressions > 0) return 1;
+  }
+  return 0;
+ }
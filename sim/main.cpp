@@ -0,0 +1,676 @@
+/* ARC simulator
+ * 18 October 2026
+ * 
+ * Runs ARC.ino and the same class headers as the car, on the simulated board. The
+ * controller buttons and the obstacles around the car come from a scenario file, and at the
+ * end of the run the loop latency, scan rate, reaction time and emergency stop latency are
+ * reported. Commands for the command link can be sent over the simulated Serial port, as a
+ * phone or PC would. After the run the non-blocking controller read (Controller::poll()) is
+ * checked against the blocking one.
+ * 
+ * Usage: arcsim [-v] [--save-log file] [--replay file] [scenario file]
+ *   -v                print every telemetry frame the firmware sends over Serial
+ *   --save-log file   write the simulated flash, with the log of the run, to a file
+ *   --replay file     feed the controller and eye readings of a log (a flash image read from the
+ *                     car, or saved with --save-log) back in, and check the actuator targets
+ * 
+ * Scenario file, one command per line, times in milliseconds:
+ *   <time> buttons <hex>                     Buttons held on the controller (as read by Controller)
+ *   <time> obstacle <min> <max> <distance>   Obstacle from min to max degrees, distance in inches
+ *   <time> clear                             Remove all obstacles
+ *   <time> topspeed <inches per second>      Speed of the car at full throttle
+ *   <time> noise <inches> <outlier percent>  Errors added to the eye readings
+ *   <time> slowdown <factor>                 CPU time of the loop multiplied by factor (1 is normal)
+ *   <time> mode <mode>                       Mode command (0 controller, 1 autonomous, 2 remote)
+ *   <time> setpoint <speed> <steering> <eye> <sweep> <ttl>
+ *                                            Setpoint command, speed in percent, angles in degrees,
+ *                                            sweep 0 or 1, time to live in milliseconds
+ *   <time> waypoint <heading> <speed> <ttl>  Waypoint command, heading as an eye angle
+ *   <time> clearance <inches>                Closest an obstacle ahead may come from now on
+ *   <time> travel <inches>                   Least the car must drive forward from now to the end
+ *   <time> end                               End of the run
+ * 
+ * The run fails (exit status 1) if an obstacle ahead reaches the car, or comes closer than the
+ * clearance set by the scenario, or if the car drives less than the travel set by the scenario.
+ */ 
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <vector>
+#include <algorithm>
+#include <Arduino.h>
+#include "ARC.ino"
+#include "simdevices.h"
+
+ enum ScenarioCommand {
+  SCENARIO_BUTTONS,
+  SCENARIO_OBSTACLE,
+  SCENARIO_CLEAR,
+  SCENARIO_TOP_SPEED,
+  SCENARIO_NOISE,
+  SCENARIO_SLOWDOWN,
+  SCENARIO_MODE,
+  SCENARIO_SETPOINT,
+  SCENARIO_WAYPOINT,
+  SCENARIO_CLEARANCE,
+  SCENARIO_TRAVEL,
+  SCENARIO_END
+ };
+
+ struct ScenarioEvent {
+  unsigned long long time; // Nanoseconds
+  ScenarioCommand command;
+  double values[5];
+ };
+
+ // Used when no scenario file is given: drive at a wall, sweep, turn and stop
+ const char* DEFAULT_SCENARIO =
+  "0 obstacle 70 110 50\n"
+  "0 obstacle 130 155 30\n"
+  "500 buttons 10\n"
+  "1500 buttons 00\n"
+  "2000 buttons 08\n"
+  "5000 buttons 50\n"
+  "5500 buttons 90\n"
+  "6000 buttons 00\n"
+  "6500 end\n";
+
+ // Recorded actuator targets are checked this long after their time, once the replayed loop has caught up
+ const unsigned long long REPLAY_CHECK_DELAY = 2 * CONTROL_PERIOD_MILLIS * 1000000ULL;
+
+ SimController* controllerDevice;
+ SimWorld* world;
+ SimSonar* sonar;
+ std::vector<ScenarioEvent> scenario;
+ unsigned long long endTime = 0;
+ std::vector<LogRecord> replayRecords;
+ unsigned long long lastSetpointTime = 0; // Time the last byte of the last setpoint arrived
+ unsigned long replayChecks = 0;
+ unsigned long replayMatches = 0;
+ double minTravel = 0; // Least the car must drive forward (inches) from travelStartTime, 0 if not checked
+ double travelStart = 0; // Odometer at travelStartTime
+ unsigned long long travelStartTime = 0;
+
+ // Reads a scenario, returns false if a line could not be understood
+ bool parseScenario(const char* text) {
+  char line[128];
+  int lineNumber = 0;
+  while(*text) {
+    size_t length = strcspn(text,"\n");
+    if(length >= sizeof(line)) length = sizeof(line) - 1;
+    memcpy(line,text,length);
+    line[length] = 0;
+    text += strcspn(text,"\n");
+    if(*text) text++;
+    lineNumber++;
+
+    char name[16];
+    double timeMillis;
+    ScenarioEvent event;
+    memset(&event,0,sizeof(event));
+    if(line[0] == '#' || sscanf(line,"%lf %15s",&timeMillis,name) != 2) continue;
+    event.time = timeMillis * 1000000.0;
+    if(strcmp(name,"buttons") == 0) {
+      unsigned int buttons;
+      if(sscanf(line,"%*f %*s %x",&buttons) != 1) goto error;
+      event.command = SCENARIO_BUTTONS;
+      event.values[0] = buttons;
+    }
+    else if(strcmp(name,"obstacle") == 0) {
+      if(sscanf(line,"%*f %*s %lf %lf %lf",&event.values[0],&event.values[1],&event.values[2]) != 3) goto error;
+      event.command = SCENARIO_OBSTACLE;
+    }
+    else if(strcmp(name,"clear") == 0) {
+      event.command = SCENARIO_CLEAR;
+    }
+    else if(strcmp(name,"topspeed") == 0) {
+      if(sscanf(line,"%*f %*s %lf",&event.values[0]) != 1) goto error;
+      event.command = SCENARIO_TOP_SPEED;
+    }
+    else if(strcmp(name,"noise") == 0) {
+      if(sscanf(line,"%*f %*s %lf %lf",&event.values[0],&event.values[1]) != 2) goto error;
+      event.command = SCENARIO_NOISE;
+    }
+    else if(strcmp(name,"slowdown") == 0) {
+      if(sscanf(line,"%*f %*s %lf",&event.values[0]) != 1) goto error;
+      event.command = SCENARIO_SLOWDOWN;
+    }
+    else if(strcmp(name,"mode") == 0) {
+      if(sscanf(line,"%*f %*s %lf",&event.values[0]) != 1) goto error;
+      event.command = SCENARIO_MODE;
+    }
+    else if(strcmp(name,"setpoint") == 0) {
+      if(sscanf(line,"%*f %*s %lf %lf %lf %lf %lf",&event.values[0],&event.values[1],&event.values[2],
+        &event.values[3],&event.values[4]) != 5) goto error;
+      event.command = SCENARIO_SETPOINT;
+    }
+    else if(strcmp(name,"waypoint") == 0) {
+      if(sscanf(line,"%*f %*s %lf %lf %lf",&event.values[0],&event.values[1],&event.values[2]) != 3) goto error;
+      event.command = SCENARIO_WAYPOINT;
+    }
+    else if(strcmp(name,"clearance") == 0) {
+      if(sscanf(line,"%*f %*s %lf",&event.values[0]) != 1) goto error;
+      event.command = SCENARIO_CLEARANCE;
+    }
+    else if(strcmp(name,"travel") == 0) {
+      if(sscanf(line,"%*f %*s %lf",&event.values[0]) != 1) goto error;
+      event.command = SCENARIO_TRAVEL;
+    }
+    else if(strcmp(name,"end") == 0) {
+      event.command = SCENARIO_END;
+      endTime = event.time;
+    }
+    else {
+      goto error;
+    }
+    scenario.push_back(event);
+    continue;
+  error:
+    fprintf(stderr,"Scenario line %d not understood: %s\n",lineNumber,line);
+    return false;
+  }
+  return true;
+ }
+
+ // Sends a command frame to the firmware over Serial, returns the time its last byte arrives
+ unsigned long long sendCommand(int type,const uint8_t* payload,int length) {
+  uint8_t frame[COMMAND_MAX_PAYLOAD + TELEMETRY_FRAME_OVERHEAD];
+  int size = encodeCommand(type,payload,length,frame);
+  unsigned long long sendTime = SimBoard::get().getTime();
+  Serial.queueInput(sendTime,frame,size);
+  return sendTime + size * 10000000000ULL / SERIAL_BAUD_RATE;
+ }
+
+ // Applies a scenario event when its time comes
+ void runScenarioEvent(void* arg) {
+  ScenarioEvent* event = (ScenarioEvent*)arg;
+  uint8_t payload[6];
+  unsigned int timeToLive;
+  switch(event->command) {
+    case SCENARIO_BUTTONS:
+      controllerDevice->setButtons((uint8_t)event->values[0]);
+      break;
+    case SCENARIO_OBSTACLE:
+      world->addObstacle(event->values[0],event->values[1],event->values[2]);
+      break;
+    case SCENARIO_CLEAR:
+      world->clearObstacles();
+      break;
+    case SCENARIO_TOP_SPEED:
+      world->setTopSpeed(event->values[0]);
+      break;
+    case SCENARIO_NOISE:
+      sonar->setNoise(event->values[0],event->values[1] / 100.0);
+      break;
+    case SCENARIO_SLOWDOWN:
+      SimBoard::get().setCostScale(event->values[0]);
+      break;
+    case SCENARIO_MODE:
+      payload[0] = (uint8_t)event->values[0];
+      sendCommand(COMMAND_MODE,payload,1);
+      break;
+    case SCENARIO_SETPOINT:
+      timeToLive = (unsigned int)event->values[4];
+      payload[0] = timeToLive & 0xFF;
+      payload[1] = timeToLive >> 8;
+      payload[2] = (uint8_t)(int8_t)event->values[0];
+      payload[3] = (uint8_t)event->values[1];
+      payload[4] = (uint8_t)event->values[2];
+      payload[5] = event->values[3] != 0 ? 0x01 : 0x00;
+      lastSetpointTime = sendCommand(COMMAND_SETPOINT,payload,6);
+      break;
+    case SCENARIO_WAYPOINT:
+      timeToLive = (unsigned int)event->values[2];
+      payload[0] = timeToLive & 0xFF;
+      payload[1] = timeToLive >> 8;
+      payload[2] = (uint8_t)event->values[0];
+      payload[3] = (uint8_t)event->values[1];
+      sendCommand(COMMAND_WAYPOINT,payload,4);
+      break;
+    case SCENARIO_CLEARANCE:
+      world->setMinClearance(event->values[0]);
+      break;
+    case SCENARIO_TRAVEL:
+      minTravel = event->values[0];
+      travelStart = world->getOdometer();
+      travelStartTime = SimBoard::get().getTime();
+      break;
+    case SCENARIO_END:
+      break;
+  }
+ }
+
+ /* Decodes a log read from the flash, keeping the records of the last run in it. Pages are put
+  * in order by their sequence number, which carries on from one boot to the next while the time
+  * starts again. Returns false if there are no records.
+  */
+ bool loadReplay(const std::vector<char>& data) {
+  std::vector<std::pair<uint32_t,size_t> > pages;
+  LogDecoder decoder;
+  LogRecord record;
+  for(size_t offset = 0; offset + LOG_PAGE_SIZE <= data.size(); offset += LOG_PAGE_SIZE) {
+    if(decoder.beginPage((const uint8_t*)&data[offset])) pages.push_back(std::make_pair(decoder.getSequence(),offset));
+  }
+  std::sort(pages.begin(),pages.end());
+  for(size_t i = 0; i < pages.size(); i++) {
+    decoder.beginPage((const uint8_t*)&data[pages[i].second]);
+    if(!replayRecords.empty() && decoder.getStartTime() < replayRecords.back().time) replayRecords.clear();
+    while(decoder.next(&record)) replayRecords.push_back(record);
+  }
+  return !replayRecords.empty();
+ }
+
+ // Applies a recorded input when its time comes, or checks a recorded output against the firmware
+ void runReplayRecord(void* arg) {
+  LogRecord* record = (LogRecord*)arg;
+  switch(record->type) {
+    case LOG_CONTROLLER:
+      controllerDevice->setButtons((uint8_t)record->values[0]);
+      break;
+    case LOG_DISTANCE:
+    case LOG_SCAN_POINT:
+      sonar->setReplayDistance(record->values[0],record->values[1] < 0 ? -1.0 : record->values[1] / 10.0);
+      break;
+    case LOG_ACTUATORS:
+      replayChecks++;
+      if((int)(targetSpeed * 100) == record->values[0] && targetSteeringAngle == record->values[1] &&
+        targetEyeAngle == record->values[2]) {
+        replayMatches++;
+      }
+      break;
+  }
+ }
+
+ // Writes data to a file, returns false if it cannot be written
+ bool writeFile(const char* fileName,const std::vector<uint8_t>& data) {
+  FILE* file = fopen(fileName,"wb");
+  if(!file) return false;
+  bool isWritten = fwrite(&data[0],1,data.size(),file) == data.size();
+  return fclose(file) == 0 && isWritten;
+ }
+
+ // Buttons used to check Controller::poll(), every other bit so a shift out of step shows
+ const uint8_t POLL_CHECK_BUTTONS = 0xA5;
+
+ /* Reads the controller with poll(), calling it every microsecond until a byte is complete, then
+  * with getData(). Returns true if both read the buttons and hasNewData() follows the reads.
+  */
+ bool checkControllerPoll(SimController& device,unsigned long* calls,unsigned long* readTime) {
+  SimBoard& board = SimBoard::get();
+  uint8_t buttons = device.getButtons();
+  bool isMatched = true;
+  device.setButtons(POLL_CHECK_BUTTONS);
+  controller.getLatest();
+  *calls = 0;
+  while(!controller.poll()) {
+    (*calls)++;
+    board.advance(1000);
+  }
+  (*calls)++;
+  *readTime = controller.getReadTime();
+  isMatched &= controller.hasNewData();
+  isMatched &= controller.getLatest() == POLL_CHECK_BUTTONS;
+  isMatched &= !controller.hasNewData();
+  isMatched &= controller.getData() == POLL_CHECK_BUTTONS;
+  device.setButtons(buttons);
+  return isMatched;
+ }
+
+ // Returns the value at a fraction of the way through sorted values
+ unsigned long long percentile(std::vector<unsigned long long>& values,double fraction) {
+  if(values.empty()) return 0;
+  size_t index = fraction * (values.size() - 1);
+  return values[index];
+ }
+
+ // Prints min/avg/p50/p99/max of values given in nanoseconds, as microseconds
+ void printStats(const char* name,std::vector<unsigned long long>& values) {
+  unsigned long long total = 0;
+  std::sort(values.begin(),values.end());
+  for(size_t i = 0; i < values.size(); i++) total += values[i];
+  if(values.empty()) {
+    printf("%-28s no samples\n",name);
+    return;
+  }
+  printf("%-28s min %8.1f  avg %8.1f  p50 %8.1f  p99 %8.1f  max %8.1f us (%lu samples)\n",name,
+    values.front() / 1000.0,total / 1000.0 / values.size(),percentile(values,0.5) / 1000.0,
+    percentile(values,0.99) / 1000.0,values.back() / 1000.0,(unsigned long)values.size());
+ }
+
+ // Reads little endian values from a telemetry payload
+ unsigned long getTelemetry32(const unsigned char* data) {
+  return data[0] | (data[1] << 8) | (data[2] << 16) | ((unsigned long)data[3] << 24);
+ }
+
+ double getTelemetryDistance(const unsigned char* data) {
+  short tenths = (short)(data[0] | (data[1] << 8));
+  return tenths < 0 ? -1.0 : tenths / 10.0;
+ }
+
+ // Prints one telemetry frame as text
+ void printTelemetryFrame(int type,const unsigned char* payload,int length) {
+  switch(type) {
+    case TELEMETRY_TEXT:
+      printf("text        %.*s\n",length,(const char*)payload);
+      break;
+    case TELEMETRY_DISTANCE:
+      printf("distance    %10lu us %6.1f in\n",getTelemetry32(payload),getTelemetryDistance(payload + 4));
+      break;
+    case TELEMETRY_SCAN:
+      printf("scan        %10lu us %6lu us %s",getTelemetry32(payload),getTelemetry32(payload + 4),
+        payload[8] & 0x01 ? "fwd" : "rev");
+      for(int i = 0; i < payload[9]; i++) {
+        printf(" %d:%.1f",payload[10 + 3 * i],getTelemetryDistance(payload + 11 + 3 * i));
+      }
+      printf("\n");
+      break;
+    case TELEMETRY_CONTROLLER:
+      printf("controller  %10lu us 0x%02X\n",getTelemetry32(payload),payload[4]);
+      break;
+    case TELEMETRY_ACTUATORS:
+      printf("actuators   %10lu us speed %d%% steering %d eye %d\n",getTelemetry32(payload),(signed char)payload[4],
+        payload[5],payload[6]);
+      break;
+    case TELEMETRY_STATUS:
+      printf("status      %10lu us period %lu us dropped %lu writes %lu skipped %lu\n",getTelemetry32(payload),
+        getTelemetry32(payload + 4),getTelemetry32(payload + 8),getTelemetry32(payload + 12),getTelemetry32(payload + 16));
+      break;
+    case TELEMETRY_POINT:
+      printf("point       %10lu us %d:%.1f\n",getTelemetry32(payload),payload[4],getTelemetryDistance(payload + 5));
+      break;
+    case TELEMETRY_COMMAND:
+      printf("command     %10lu us type %d latency %lu us\n",getTelemetry32(payload),payload[4],getTelemetry32(payload + 5));
+      break;
+    default:
+      printf("unknown     type %d, %d bytes\n",type,length);
+  }
+ }
+
+ /* Checks the frames in everything the firmware sent, counting good frames and frames with a
+  * bad CRC. Bytes that are not part of a frame are skipped until the next sync byte.
+  */
+ void decodeTelemetry(const std::string& bytes,bool isPrinting,unsigned long* frameCount,unsigned long* badCount) {
+  const unsigned char* data = (const unsigned char*)bytes.data();
+  size_t size = bytes.size();
+  size_t i = 0;
+  *frameCount = 0;
+  *badCount = 0;
+  while(i + TELEMETRY_FRAME_OVERHEAD <= size) {
+    if(data[i] != TELEMETRY_SYNC) {
+      i++;
+      continue;
+    }
+    int length = data[i + 2];
+    if(i + TELEMETRY_FRAME_OVERHEAD + length > size) break;
+    unsigned short crc = 0xFFFF;
+    for(int j = 0; j < length + 2; j++) {
+      crc ^= data[i + 1 + j] << 8;
+      for(int bit = 0; bit < 8; bit++) {
+        crc = crc & 0x8000 ? (crc << 1) ^ 0x1021 : crc << 1;
+      }
+    }
+    size_t crcIndex = i + 3 + length;
+    if((data[crcIndex] | (data[crcIndex + 1] << 8)) != crc) {
+      (*badCount)++;
+      i++;
+      continue;
+    }
+    (*frameCount)++;
+    if(isPrinting) printTelemetryFrame(data[i + 1],data + i + 3,length);
+    i = crcIndex + 2;
+  }
+ }
+
+ // Reads a whole file into text, returns false if it cannot be read
+ bool readFile(const char* fileName,std::vector<char>* text) {
+  FILE* file = fopen(fileName,"rb");
+  if(!file) return false;
+  char buffer[512];
+  size_t count;
+  while((count = fread(buffer,1,sizeof(buffer),file)) > 0) {
+    text->insert(text->end(),buffer,buffer + count);
+  }
+  fclose(file);
+  text->push_back(0);
+  return true;
+ }
+
+ int main(int argc,char** argv) {
+  const char* scenarioFile = 0;
+  const char* replayFile = 0;
+  const char* saveLogFile = 0;
+  std::vector<char> scenarioText;
+  bool isVerbose = false;
+  for(int i = 1; i < argc; i++) {
+    if(strcmp(argv[i],"-v") == 0) isVerbose = true;
+    else if(strcmp(argv[i],"--replay") == 0 && i + 1 < argc) replayFile = argv[++i];
+    else if(strcmp(argv[i],"--save-log") == 0 && i + 1 < argc) saveLogFile = argv[++i];
+    else scenarioFile = argv[i];
+  }
+  if(replayFile) {
+    std::vector<char> replayData;
+    if(!readFile(replayFile,&replayData)) {
+      fprintf(stderr,"Cannot read %s\n",replayFile);
+      return 1;
+    }
+    replayData.pop_back();
+    if(!loadReplay(replayData)) {
+      fprintf(stderr,"No log records in %s\n",replayFile);
+      return 1;
+    }
+  }
+  if(scenarioFile) {
+    if(!readFile(scenarioFile,&scenarioText)) {
+      fprintf(stderr,"Cannot read %s\n",scenarioFile);
+      return 1;
+    }
+  }
+  else if(!replayFile) {
+    scenarioText.assign(DEFAULT_SCENARIO,DEFAULT_SCENARIO + strlen(DEFAULT_SCENARIO) + 1);
+  }
+  else {
+    scenarioText.push_back(0);
+  }
+  if(!parseScenario(&scenarioText[0])) return 1;
+  if(endTime == 0 && !replayRecords.empty()) endTime = (replayRecords.back().time + 1000) * 1000000ULL;
+  if(endTime == 0) endTime = 10000000000ULL;
+
+  // Build the car around the firmware, which was constructed before main()
+  SimBoard& board = SimBoard::get();
+  SimWorld simWorld;
+  SimController simController(CONTROLLER_LATCH_WIRE,CONTROLLER_CLOCK_WIRE,CONTROLLER_DATA_WIRE);
+  SimServo steeringDevice(STEERING_SERVO_PWM_CHANNEL,SERVO_SLEW_RATE,STEERING_SERVO_HOME_ANGLE);
+  SimServo eyeDevice(EYE_PWM_CHANNEL,EYE_SERVO_SLEW_RATE,EYE_SERVO_HOME_ANGLE);
+  SimMotor motorDevice(REAR_MOTOR_CONTROL_WIRE1,REAR_MOTOR_CONTROL_WIRE2,REAR_MOTOR_PWM_CHANNEL,&simWorld);
+  SimSonar eyeSonar(EYE_TRIGGER_WIRE,EYE_ECHO_WIRE,&eyeDevice,EYE_SERVO_HOME_ANGLE,&simWorld);
+  SimSonar leftSonar(LEFT_RANGE_TRIGGER_WIRE,LEFT_RANGE_ECHO_WIRE,0,LEFT_RANGE_HEADING,&simWorld);
+  SimSonar rightSonar(RIGHT_RANGE_TRIGGER_WIRE,RIGHT_RANGE_ECHO_WIRE,0,RIGHT_RANGE_HEADING,&simWorld);
+  SimSonar rearSonar(REAR_RANGE_TRIGGER_WIRE,REAR_RANGE_ECHO_WIRE,0,REAR_RANGE_HEADING,&simWorld);
+  simWorld.setSteering(&steeringDevice);
+  eyeSonar.setAlarm(EMERGENCY_STOP_DISTANCE,EMERGENCY_STOP_ANGLE);
+  eyeSonar.setReadRange(EYE_MAX_RANGE);
+  leftSonar.setReadRange(RANGE_MAX_RANGE);
+  rightSonar.setReadRange(RANGE_MAX_RANGE);
+  rearSonar.setReadRange(RANGE_MAX_RANGE);
+  world = &simWorld;
+  controllerDevice = &simController;
+  sonar = &eyeSonar;
+  for(size_t i = 0; i < scenario.size(); i++) {
+    board.schedule(scenario[i].time,runScenarioEvent,&scenario[i]);
+  }
+  for(size_t i = 0; i < replayRecords.size(); i++) {
+    unsigned long long recordTime = replayRecords[i].time * 1000000ULL;
+    if(replayRecords[i].type == LOG_ACTUATORS) recordTime += REPLAY_CHECK_DELAY;
+    board.schedule(recordTime,runReplayRecord,&replayRecords[i]);
+  }
+
+  clock_t startClock = clock();
+  setup();
+  unsigned long long bootTime = board.getTime();
+
+  // Run the loop, measuring each pass and how long the car takes to react to the buttons
+  std::vector<unsigned long long> loopBusy;
+  std::vector<unsigned long long> loopPeriod;
+  std::vector<unsigned long long> reactions;
+  std::vector<unsigned long long> commandReactions;
+  std::vector<unsigned long long> pingToBrake;
+  std::vector<unsigned long long> echoToBrake;
+  unsigned long long lastButtonChange = 0;
+  bool isReactionPending = false;
+  unsigned long long lastSetpoint = 0;
+  bool isCommandPending = false;
+  while(board.getTime() < endTime) {
+    unsigned long long startTime = board.getTime();
+    unsigned long long startBusy = board.getBusyTime();
+    loop();
+    loopPeriod.push_back(board.getTime() - startTime);
+    loopBusy.push_back(board.getBusyTime() - startBusy);
+
+    if(simController.getChangeTime() != lastButtonChange) {
+      lastButtonChange = simController.getChangeTime();
+      isReactionPending = true;
+    }
+    if(isReactionPending) {
+      unsigned long long outputChange = std::max(motorDevice.getChangeTime(),steeringDevice.getChangeTime());
+      if(outputChange >= lastButtonChange && outputChange > 0) {
+        reactions.push_back(outputChange - lastButtonChange);
+        isReactionPending = false;
+      }
+    }
+
+    // Likewise from the last byte of a setpoint arriving over Serial
+    if(lastSetpointTime != lastSetpoint) {
+      lastSetpoint = lastSetpointTime;
+      isCommandPending = true;
+    }
+    if(isCommandPending) {
+      unsigned long long outputChange = std::max(motorDevice.getChangeTime(),steeringDevice.getChangeTime());
+      if(outputChange >= lastSetpoint) {
+        commandReactions.push_back(outputChange - lastSetpoint);
+        isCommandPending = false;
+      }
+    }
+
+    // Time from a close echo ahead to the motor braking, only counted if the car was going forward
+    unsigned long long alarmTrigger,alarmEcho;
+    if(eyeSonar.getAlarm(&alarmTrigger,&alarmEcho) && motorDevice.getThrottle() <= 0) {
+      if(motorDevice.getStopTime() >= alarmEcho) {
+        pingToBrake.push_back(motorDevice.getStopTime() - alarmTrigger);
+        echoToBrake.push_back(motorDevice.getStopTime() - alarmEcho);
+      }
+      eyeSonar.clearAlarm();
+    }
+  }
+  double runSeconds = (double)(clock() - startClock) / CLOCKS_PER_SEC;
+  unsigned long pollCalls,pollTime;
+  bool isPollMatched = checkControllerPoll(simController,&pollCalls,&pollTime);
+
+  // Report
+  unsigned long frameCount,badCount;
+  decodeTelemetry(Serial.getOutput(),isVerbose,&frameCount,&badCount);
+  double simSeconds = board.getTime() / 1000000000.0;
+  printf("ARC simulator: %.3f s simulated in %.3f s (%.0fx real time)\n",simSeconds,runSeconds,
+    runSeconds > 0 ? simSeconds / runSeconds : 0);
+  printf("%-28s %.1f us\n","Setup",bootTime / 1000.0);
+  printf("%-28s %lu us (","Boot to first tick",boot.getFirstTickTime());
+  for(int i = 0; i < BOOT_STAGE_COUNT; i++) {
+    printf("%s%s %lu",i > 0 ? ", " : "",BOOT_STAGE_NAMES[i],boot.getStageMicros((BootStage)i));
+  }
+  printf("), %lu outputs written before they were set up\n",board.getUnsetWriteCount());
+  printStats("Loop CPU time",loopBusy);
+  printStats("Loop period",loopPeriod);
+  printf("%-28s %lu of %lu passes over %lu us, %lu more in flash erases (","Loop overruns",supervisor.getTickOverruns(),
+    supervisor.getTickCount(),CONTROL_PERIOD_MILLIS * 1000UL * LOOP_DEADLINE_PERCENT / 100,supervisor.getExcusedOverruns());
+  for(int i = 0; i < SUPERVISE_STAGE_COUNT; i++) {
+    printf("%s%s %lu",i > 0 ? ", " : "",SUPERVISE_STAGE_NAMES[i],supervisor.getStageOverruns((SuperviseStage)i));
+  }
+  printf(")\n");
+  printf("%-28s %s at the end, lowest %s, sensing stalled %lu times\n","Degrade level",
+    DEGRADE_LEVEL_NAMES[supervisor.getLevel()],DEGRADE_LEVEL_NAMES[supervisor.getMaxLevel()],supervisor.getStallCount());
+  printf("%-28s longest gap %.1f ms, %lu resets\n","Watchdog",board.getMaxFeedGap() / 1000000.0,
+    board.getWatchdogTrips());
+  printStats("Reaction (buttons->output)",reactions);
+  printf("%-28s %lu calls, %lu us, %s getData()\n","Controller poll",pollCalls,pollTime,
+    isPollMatched ? "matches" : "DOES NOT MATCH");
+  printStats("Reaction (setpoint->output)",commandReactions);
+  printf("%-28s %lu commands, %lu bad, %lu ran out, read->targets max %lu us\n","Command link",
+    commandLink.getFramesReceived(),commandLink.getFramesBad(),commandLink.getCommandsExpired(),commandLink.getMaxLatency());
+  printStats("Emergency stop (ping->brake)",pingToBrake);
+  printStats("Emergency stop (echo->brake)",echoToBrake);
+  printf("%-28s %lu\n","Emergency stops",emergencyStop.getStopCount());
+  printf("%-28s %lu complete, last %.2f sweeps/s\n","Sweeps",eye.getFrame().sequence,eye.getSweepRate());
+  printf("%-28s %lu (%.1f per second)\n","Pings",eyeSonar.getPingCount(),eyeSonar.getPingCount() / simSeconds);
+  if(eye.getFrame().count > 0) {
+    printf("%-28s %.2f in the last sweep\n","Pings per sweep point",(double)eye.getFrame().pingCount / eye.getFrame().count);
+  }
+  unsigned long rangePings = leftSonar.getPingCount() + rightSonar.getPingCount() + rearSonar.getPingCount();
+  printf("%-28s left %lu, right %lu, rear %lu pings (%.1f per second with the eye)\n","Range sensors",
+    leftSonar.getPingCount(),rightSonar.getPingCount(),rearSonar.getPingCount(),
+    (rangePings + eyeSonar.getPingCount()) / simSeconds);
+  printf("%-28s %lu\n","Ghost echoes (crosstalk)",eyeSonar.getGhostCount() + leftSonar.getGhostCount() +
+    rightSonar.getGhostCount() + rearSonar.getGhostCount());
+  printf("%-28s %lu bytes, blocked %.1f us\n","Serial output",(unsigned long)Serial.getOutput().size(),
+    Serial.getBlockedTime() / 1000.0);
+  printf("%-28s %lu frames, %lu dropped, %lu bad\n","Telemetry",frameCount,telemetry.getFramesDropped(),badCount);
+  printf("%-28s %lu made, %lu skipped (unchanged)\n","Output writes",getOutputStats().writeCount,
+    getOutputStats().elidedCount);
+  printf("%-28s %.1f in\n","Closest approach ahead",simWorld.getClosestApproach());
+  unsigned long long breachTime;
+  double breachDistance;
+  bool isBreached = simWorld.getBreach(&breachTime,&breachDistance);
+  if(isBreached) {
+    printf("%-28s FAILED, %.1f in ahead at %.3f s (%s)\n","Clearance",breachDistance,breachTime / 1000000000.0,
+      breachDistance <= 0 ? "collision" : "closer than the clearance");
+  }
+  else if(simWorld.getMinClearance() > 0) {
+    printf("%-28s kept %.1f in\n","Clearance",simWorld.getMinClearance());
+  }
+  else {
+    printf("%-28s no collision\n","Clearance");
+  }
+  double travel = simWorld.getOdometer() - travelStart;
+  bool isStuck = minTravel > 0 && travel < minTravel;
+  if(minTravel > 0) {
+    printf("%-28s %s%.1f in from %.3f s (at least %.1f in)\n","Travel",isStuck ? "FAILED, " : "",travel,
+      travelStartTime / 1000000000.0,minTravel);
+  }
+  printf("%-28s %.3f\n","Largest throttle step",motorDevice.getMaxStep());
+  const ObjectTracker& objects = sensing.read().objects;
+  printf("%-28s %d at the end of the run\n","Objects tracked",objects.getCount());
+  for(int i = 0; i < objects.getCount(); i++) {
+    const ObjectTrack& track = objects.getTrack(i);
+    printf("  %-26s %5.1f deg %5.1f in, %+6.1f in/s %+6.1f deg/s, seen %d sweeps%s\n","",track.angle,track.distance,
+      track.radialVelocity,track.angularVelocity,track.hits,objects.isConfirmed(i) ? "" : " (unconfirmed)");
+  }
+  printf("%-28s %lu pages written, %lu sectors erased, %lu records dropped, %lu errors\n","Flash log",
+    flashLog.getPagesWritten(),flashLog.getEraseCount(),flashLog.getRecordsDropped(),flashLog.getFlashErrors());
+  if(replayFile) {
+    printf("%-28s %lu records, actuator targets matched %lu of %lu\n","Replay",(unsigned long)replayRecords.size(),
+      replayMatches,replayChecks);
+  }
+
+#ifdef ARC_PROFILING
+  // Stages on the sensing task run in zero virtual time, see README.md
+  printf("\nLoop profile (us)            count      min      p50      p90      p99      max\n");
+  for(int i = 0; i < PROFILE_STAGE_COUNT; i++) {
+    Profiler& profiler = getProfiler();
+    if(profiler.getCount(i) == 0) continue;
+    printf("  %-26s %7lu %8.1f %8.1f %8.1f %8.1f %8.1f\n",PROFILE_STAGE_NAMES[i],(unsigned long)profiler.getCount(i),
+      profiler.getMin(i) / (double)CPU_FREQUENCY_MHZ,profiler.getPercentile(i,50) / (double)CPU_FREQUENCY_MHZ,
+      profiler.getPercentile(i,90) / (double)CPU_FREQUENCY_MHZ,profiler.getPercentile(i,99) / (double)CPU_FREQUENCY_MHZ,
+      profiler.getMax(i) / (double)CPU_FREQUENCY_MHZ);
+  }
+#endif
+
+  // Let the task write what is left of the log, as the car would before the power goes off
+  if(saveLogFile) {
+    flashLog.close();
+    while(flashLog.isWriting()) board.advance(FLASH_LOG_TASK_PERIOD_MILLIS * 1000000ULL);
+    if(!writeFile(saveLogFile,board.getFlash())) {
+      fprintf(stderr,"Cannot write %s\n",saveLogFile);
+      return 1;
+    }
+  }
+  return isBreached || isStuck ? 1 : 0;
+ }
@@ -0,0 +1,553 @@
+/* SimBoard class
+ * 18 October 2026
+ * 
+ * A simulated ESP32 for running the ARC firmware on a PC. Time is a virtual clock in
+ * nanoseconds which only moves when the firmware waits (delay, pulseIn, delayUntil) or
+ * spends CPU time. Every HAL call is charged a rough cost, so busy loops still make
+ * progress and loop latency can be measured. Everything is deterministic, and a run goes
+ * as fast as the PC allows instead of in real time.
+ * 
+ * Devices (controller, servos, sensors, motor) attach to pins and PWM channels with
+ * listeners, and schedule future pin changes as events on the clock. Interrupts attached
+ * by the firmware are called SIM_INTERRUPT_LATENCY after a device changes an input pin.
+ * 
+ * Tasks started with halStartTask() behave like a second core: their step runs on the
+ * virtual clock at its own period, in between the HAL calls of the main loop, and the CPU
+ * time they use is not charged to the main loop. Timers from halStartTimer() run the same way.
+ * 
+ * Outputs written before they were set up are counted: a pin changed before it was made an
+ * output, or a PWM channel written or attached to its pin before it was set up. On the ESP32
+ * these are the glitches that twitch the motor and servos at boot.
+ * 
+ * setCostScale() stretches the CPU time charged to the main loop, to see how the firmware
+ * copes with a slower loop (interrupts or flash writes taking the CPU away on the ESP32). The
+ * task watchdog is simulated by timing the gaps between feeds: a gap longer than its timeout
+ * would have reset the ESP32, and is counted instead.
+ * 
+ * The log partition is simulated as NOR flash: erasing sets whole sectors to 0xFF, and
+ * writing can only clear bits. The ESP32 turns the cache off on both cores while it erases or
+ * writes the flash, so an erase or write from a task holds up the main loop and the other
+ * tasks until it is done, rather than running in zero time like the rest of the task.
+ */ 
+
+#ifndef SIMBOARD_H
+#define SIMBOARD_H
+
+#include <stdint.h>
+#include <vector>
+#include <queue>
+#include <string.h>
+
+ const int SIM_PIN_COUNT = 40;
+ const int SIM_PWM_CHANNELS = 16;
+ const uint32_t SIM_FLASH_SIZE = 0x160000; // Same as the log partition in partitions.csv
+ const uint32_t SIM_FLASH_SECTOR_SIZE = 4096;
+
+ // Rough cost of each kind of call, in nanoseconds of CPU time
+ const unsigned long long SIM_COST_PIN = 100;
+ const unsigned long long SIM_COST_FAST_PIN = 10; // Direct GPIO register access
+ const unsigned long long SIM_COST_PWM = 500;
+ const unsigned long long SIM_COST_TIME = 50;
+ const unsigned long long SIM_COST_SERIAL = 200; // Per byte written
+ const unsigned long long SIM_COST_FORMAT = 5000; // Formatting a float as text
+ const unsigned long long SIM_COST_FLASH_ERASE = 45000000; // Per 4 KB sector
+ const unsigned long long SIM_COST_FLASH_WRITE = 2000; // Per byte, a 256 byte page takes about 0.5 ms
+ const unsigned long long SIM_COST_FLASH_READ = 25; // Per byte
+ // Time from a pin change to its interrupt handler running (Arduino GPIO interrupt dispatch)
+ const unsigned long long SIM_INTERRUPT_LATENCY = 2000;
+
+ const unsigned long long SIM_CPU_FREQUENCY_MHZ = 240;
+
+ const int SIM_PIN_OUTPUT = 0x03; // OUTPUT in Arduino.h
+
+ typedef void (*SimHandler)(void* arg);
+ typedef void (*SimPinListener)(int pin,int level,void* arg);
+ typedef void (*SimPWMListener)(int channel,uint32_t dutyCycle,void* arg);
+
+ // Something that happens at a set time on the virtual clock
+ struct SimEvent {
+  unsigned long long time;
+  unsigned long long order; // Keeps events at the same time in the order they were scheduled
+  SimHandler handler;
+  void* arg;
+  bool operator>(const SimEvent& other) const {
+    if(time != other.time) return time > other.time;
+    return order > other.order;
+  }
+ };
+
+ struct SimPin {
+  int mode;
+  int level;
+  SimHandler interrupt;
+  void* interruptArg;
+  int interruptMode;
+  std::vector<SimPinListener> listeners;
+  std::vector<void*> listenerArgs;
+ };
+
+ struct SimPWMChannel {
+  int frequency;
+  int resolution;
+  uint32_t dutyCycle;
+  std::vector<SimPWMListener> listeners;
+  std::vector<void*> listenerArgs;
+ };
+
+ struct SimTask {
+  SimHandler step;
+  void* arg;
+  unsigned long long period;
+  unsigned long long nextRun;
+ };
+
+ class SimBoard {
+  private:
+    unsigned long long time; // Virtual clock in nanoseconds
+    unsigned long long busyTime; // CPU time charged to the main loop
+    unsigned long long eventCount;
+    bool isDispatching; // True while running events or tasks, time cannot move then
+    unsigned long long stallEnd; // Time a flash erase or write from a task holds the main loop and tasks until
+    unsigned long unsetWriteCount; // Outputs written before they were set up
+    double costScale; // CPU time charged to the main loop is multiplied by this
+    unsigned long long watchdogTimeout; // 0 until the watchdog is started
+    unsigned long long lastFeedTime;
+    unsigned long long maxFeedGap;
+    unsigned long watchdogTrips; // Feeds that came after the timeout
+    SimPin pins[SIM_PIN_COUNT];
+    SimPWMChannel channels[SIM_PWM_CHANNELS];
+    std::priority_queue<SimEvent,std::vector<SimEvent>,std::greater<SimEvent> > events;
+    std::vector<SimTask> tasks;
+    std::vector<uint8_t> flash;
+    SimBoard();
+    void runUntil(unsigned long long endTime);
+    unsigned long long nextWakeTime();
+    static void runInterrupt(void* arg);
+  public:
+    static SimBoard& get();
+    void reset();
+    // Clock
+    unsigned long long getTime();
+    unsigned long long getBusyTime();
+    void charge(unsigned long long nanoseconds);
+    void stall(unsigned long long nanoseconds);
+    void setCostScale(double scale);
+    void advance(unsigned long long nanoseconds);
+    void advanceTo(unsigned long long endTime);
+    unsigned long micros();
+    uint32_t getCycleCount();
+    void delayMicros(unsigned long microseconds);
+    void delayMillis(unsigned long milliseconds);
+    void delayUntilMicros(unsigned long long wakeTime);
+    void schedule(unsigned long long eventTime,SimHandler handler,void* arg);
+    // Pins, firmware side
+    void setPinMode(int pin,int mode);
+    void writePin(int pin,int level,unsigned long long cost = SIM_COST_PIN);
+    int readPin(int pin,unsigned long long cost = SIM_COST_PIN);
+    void attachInterrupt(int pin,SimHandler handler,void* arg,int mode);
+    unsigned long pulseIn(int pin,int state,unsigned long timeout);
+    // Pins, device side
+    void drivePin(int pin,int level);
+    int getPinLevel(int pin);
+    void addPinListener(int pin,SimPinListener listener,void* arg);
+    // PWM
+    void pwmSetup(int channel,int frequency,int resolution);
+    void pwmAttach(int pin,int channel);
+    void pwmWrite(int channel,uint32_t dutyCycle);
+    uint32_t getDutyCycle(int channel);
+    double getDutyFraction(int channel);
+    double getPulseMicros(int channel);
+    void addPWMListener(int channel,SimPWMListener listener,void* arg);
+    unsigned long getUnsetWriteCount();
+    // Tasks
+    bool startTask(SimHandler step,void* arg,unsigned long long period);
+    // Watchdog
+    void watchdogBegin(unsigned long long timeout);
+    void watchdogFeed();
+    unsigned long long getMaxFeedGap();
+    unsigned long getWatchdogTrips();
+    // Flash
+    uint32_t getFlashSize();
+    bool flashErase(uint32_t offset,uint32_t length);
+    bool flashWrite(uint32_t offset,const void* data,uint32_t length);
+    bool flashRead(uint32_t offset,void* data,uint32_t length);
+    const std::vector<uint8_t>& getFlash();
+ };
+
+ // Constructor
+ SimBoard::SimBoard() {
+  reset();
+ }
+
+ // Returns the one simulated board
+ SimBoard& SimBoard::get() {
+  static SimBoard board;
+  return board;
+ }
+
+ // Puts the board back into its power up state
+ void SimBoard::reset() {
+  time = 0;
+  busyTime = 0;
+  eventCount = 0;
+  isDispatching = false;
+  stallEnd = 0;
+  unsetWriteCount = 0;
+  costScale = 1.0;
+  watchdogTimeout = 0;
+  lastFeedTime = 0;
+  maxFeedGap = 0;
+  watchdogTrips = 0;
+  for(int i = 0; i < SIM_PIN_COUNT; i++) {
+    pins[i].mode = 0;
+    pins[i].level = 0;
+    pins[i].interrupt = 0;
+    pins[i].interruptArg = 0;
+    pins[i].interruptMode = 0;
+    pins[i].listeners.clear();
+    pins[i].listenerArgs.clear();
+  }
+  for(int i = 0; i < SIM_PWM_CHANNELS; i++) {
+    channels[i].frequency = 0;
+    channels[i].resolution = 0;
+    channels[i].dutyCycle = 0;
+    channels[i].listeners.clear();
+    channels[i].listenerArgs.clear();
+  }
+  while(!events.empty()) events.pop();
+  tasks.clear();
+  flash.assign(SIM_FLASH_SIZE,0xFF);
+ }
+
+ // Returns the virtual time in nanoseconds
+ unsigned long long SimBoard::getTime() {
+  return time;
+ }
+
+ // Returns the CPU time charged to the main loop in nanoseconds
+ unsigned long long SimBoard::getBusyTime() {
+  return busyTime;
+ }
+
+ // Charges CPU time to the main loop, unless the call came from an event or a task
+ void SimBoard::charge(unsigned long long nanoseconds) {
+  if(isDispatching) return;
+  nanoseconds = nanoseconds * costScale;
+  busyTime += nanoseconds;
+  runUntil(time + nanoseconds);
+ }
+
+ /* Charges a flash erase or write. From the main loop it is CPU time like any other call, from
+  * a task the main loop and the other tasks cannot run until it is done
+  */
+ void SimBoard::stall(unsigned long long nanoseconds) {
+  if(!isDispatching) {
+    charge(nanoseconds);
+    return;
+  }
+  if(time + nanoseconds > stallEnd) stallEnd = time + nanoseconds;
+ }
+
+ // Sets how much slower the main loop runs than the default costs, 1 is normal
+ void SimBoard::setCostScale(double scale) {
+  costScale = scale > 0 ? scale : 1.0;
+ }
+
+ // Lets time pass without using the CPU
+ void SimBoard::advance(unsigned long long nanoseconds) {
+  advanceTo(time + nanoseconds);
+ }
+
+ void SimBoard::advanceTo(unsigned long long endTime) {
+  // Events and tasks cannot wait, they run in zero time
+  if(isDispatching) return;
+  if(endTime > time) runUntil(endTime);
+ }
+
+ // Returns the earliest time an event or task is due
+ unsigned long long SimBoard::nextWakeTime() {
+  unsigned long long wakeTime = ~0ULL;
+  if(!events.empty()) wakeTime = events.top().time;
+  for(size_t i = 0; i < tasks.size(); i++) {
+    if(tasks[i].nextRun < wakeTime) wakeTime = tasks[i].nextRun;
+  }
+  return wakeTime;
+ }
+
+ // Moves the clock forward, running events and tasks as their time comes
+ void SimBoard::runUntil(unsigned long long endTime) {
+  isDispatching = true;
+  for(;;) {
+    unsigned long long wakeTime = nextWakeTime();
+    if(wakeTime > endTime) break;
+    time = wakeTime;
+    if(!events.empty() && events.top().time == wakeTime) {
+      SimEvent event = events.top();
+      events.pop();
+      event.handler(event.arg);
+      continue;
+    }
+    for(size_t i = 0; i < tasks.size(); i++) {
+      if(tasks[i].nextRun == wakeTime) {
+        tasks[i].step(tasks[i].arg);
+        tasks[i].nextRun = wakeTime + tasks[i].period;
+        // A stall from the step holds up the tasks and the main loop, events (interrupts) still run
+        if(stallEnd > wakeTime) {
+          for(size_t j = 0; j < tasks.size(); j++) {
+            if(tasks[j].nextRun < stallEnd) tasks[j].nextRun = stallEnd;
+          }
+          if(stallEnd > endTime) endTime = stallEnd;
+        }
+        break;
+      }
+    }
+  }
+  time = endTime;
+  isDispatching = false;
+ }
+
+ unsigned long SimBoard::micros() {
+  charge(SIM_COST_TIME);
+  return time / 1000;
+ }
+
+ // Returns the CPU cycle counter of the main core, which wraps around like on the ESP32
+ uint32_t SimBoard::getCycleCount() {
+  charge(SIM_COST_TIME);
+  return (uint32_t)(time * SIM_CPU_FREQUENCY_MHZ / 1000);
+ }
+
+ // delayMicroseconds() is a busy wait on the ESP32, so it is charged as CPU time
+ void SimBoard::delayMicros(unsigned long microseconds) {
+  charge(microseconds * 1000ULL);
+ }
+
+ // delay() lets other tasks run on the ESP32, so it is not charged
+ void SimBoard::delayMillis(unsigned long milliseconds) {
+  advance(milliseconds * 1000000ULL);
+ }
+
+ void SimBoard::delayUntilMicros(unsigned long long wakeTime) {
+  advanceTo(wakeTime * 1000ULL);
+ }
+
+ // Runs handler(arg) at eventTime (nanoseconds)
+ void SimBoard::schedule(unsigned long long eventTime,SimHandler handler,void* arg) {
+  SimEvent event;
+  event.time = eventTime < time ? time : eventTime;
+  event.order = eventCount++;
+  event.handler = handler;
+  event.arg = arg;
+  events.push(event);
+ }
+
+ void SimBoard::setPinMode(int pin,int mode) {
+  if(pin < 0 || pin >= SIM_PIN_COUNT) return;
+  charge(SIM_COST_PIN);
+  pins[pin].mode = mode;
+ }
+
+ // Firmware writes an output, devices listening to the pin are told about the change
+ void SimBoard::writePin(int pin,int level,unsigned long long cost) {
+  if(pin < 0 || pin >= SIM_PIN_COUNT) return;
+  charge(cost);
+  level = level ? 1 : 0;
+  if(pins[pin].level == level) return;
+  if(pins[pin].mode != SIM_PIN_OUTPUT) unsetWriteCount++;
+  pins[pin].level = level;
+  bool wasDispatching = isDispatching;
+  isDispatching = true;
+  for(size_t i = 0; i < pins[pin].listeners.size(); i++) {
+    pins[pin].listeners[i](pin,level,pins[pin].listenerArgs[i]);
+  }
+  isDispatching = wasDispatching;
+ }
+
+ int SimBoard::readPin(int pin,unsigned long long cost) {
+  if(pin < 0 || pin >= SIM_PIN_COUNT) return 0;
+  charge(cost);
+  return pins[pin].level;
+ }
+
+ void SimBoard::attachInterrupt(int pin,SimHandler handler,void* arg,int mode) {
+  if(pin < 0 || pin >= SIM_PIN_COUNT) return;
+  pins[pin].interrupt = handler;
+  pins[pin].interruptArg = arg;
+  pins[pin].interruptMode = mode;
+ }
+
+ // Waits for the pin to go to state and back, returning the time it spent in state (micros)
+ // This is a busy wait on the ESP32, so the time is charged as CPU time
+ unsigned long SimBoard::pulseIn(int pin,int state,unsigned long timeout) {
+  unsigned long long endTime = time + timeout * 1000ULL;
+  unsigned long long startTime;
+  unsigned long long waitStart = time;
+  state = state ? 1 : 0;
+
+  // Wait for any pulse already in progress to end, then for the pulse to start
+  while(pins[pin].level == state && time < endTime) {
+    advanceTo(nextWakeTime() < endTime ? nextWakeTime() : endTime);
+  }
+  while(pins[pin].level != state && time < endTime) {
+    advanceTo(nextWakeTime() < endTime ? nextWakeTime() : endTime);
+  }
+  startTime = time;
+  while(pins[pin].level == state && time < endTime) {
+    advanceTo(nextWakeTime() < endTime ? nextWakeTime() : endTime);
+  }
+  if(!isDispatching) busyTime += time - waitStart;
+  if(pins[pin].level == state || time >= endTime) return 0;
+  return (time - startTime) / 1000;
+ }
+
+ // A device changes an input, which calls the interrupt attached to the pin if it matches
+ void SimBoard::drivePin(int pin,int level) {
+  if(pin < 0 || pin >= SIM_PIN_COUNT) return;
+  level = level ? 1 : 0;
+  if(pins[pin].level == level) return;
+  pins[pin].level = level;
+  if(pins[pin].interrupt == 0) return;
+  int mode = pins[pin].interruptMode;
+  if(mode == 0x03 || (mode == 0x01 && level) || (mode == 0x02 && !level)) {
+    schedule(time + SIM_INTERRUPT_LATENCY,runInterrupt,&pins[pin]);
+  }
+ }
+
+ // Calls the interrupt handler of a pin, as an event
+ void SimBoard::runInterrupt(void* arg) {
+  SimPin* pin = (SimPin*)arg;
+  if(pin->interrupt) pin->interrupt(pin->interruptArg);
+ }
+
+ // Returns the level of a pin without charging any time
+ int SimBoard::getPinLevel(int pin) {
+  if(pin < 0 || pin >= SIM_PIN_COUNT) return 0;
+  return pins[pin].level;
+ }
+
+ void SimBoard::addPinListener(int pin,SimPinListener listener,void* arg) {
+  if(pin < 0 || pin >= SIM_PIN_COUNT) return;
+  pins[pin].listeners.push_back(listener);
+  pins[pin].listenerArgs.push_back(arg);
+ }
+
+ void SimBoard::pwmSetup(int channel,int frequency,int resolution) {
+  if(channel < 0 || channel >= SIM_PWM_CHANNELS) return;
+  charge(SIM_COST_PWM);
+  channels[channel].frequency = frequency;
+  channels[channel].resolution = resolution;
+ }
+
+ void SimBoard::pwmAttach(int pin,int channel) {
+  if(channel < 0 || channel >= SIM_PWM_CHANNELS) return;
+  charge(SIM_COST_PWM);
+  if(channels[channel].frequency == 0) unsetWriteCount++;
+ }
+
+ void SimBoard::pwmWrite(int channel,uint32_t dutyCycle) {
+  if(channel < 0 || channel >= SIM_PWM_CHANNELS) return;
+  charge(SIM_COST_PWM);
+  if(channels[channel].frequency == 0) unsetWriteCount++;
+  channels[channel].dutyCycle = dutyCycle;
+  bool wasDispatching = isDispatching;
+  isDispatching = true;
+  for(size_t i = 0; i < channels[channel].listeners.size(); i++) {
+    channels[channel].listeners[i](channel,dutyCycle,channels[channel].listenerArgs[i]);
+  }
+  isDispatching = wasDispatching;
+ }
+
+ uint32_t SimBoard::getDutyCycle(int channel) {
+  return channels[channel].dutyCycle;
+ }
+
+ // Returns the duty cycle as a fraction from 0 to 1
+ double SimBoard::getDutyFraction(int channel) {
+  if(channels[channel].resolution == 0) return 0;
+  return channels[channel].dutyCycle / (double)(1UL << channels[channel].resolution);
+ }
+
+ // Returns the high time of the PWM signal in microseconds
+ double SimBoard::getPulseMicros(int channel) {
+  if(channels[channel].frequency == 0) return 0;
+  return getDutyFraction(channel) * 1000000.0 / channels[channel].frequency;
+ }
+
+ void SimBoard::addPWMListener(int channel,SimPWMListener listener,void* arg) {
+  if(channel < 0 || channel >= SIM_PWM_CHANNELS) return;
+  channels[channel].listeners.push_back(listener);
+  channels[channel].listenerArgs.push_back(arg);
+ }
+
+ // Returns the number of outputs written before they were set up
+ unsigned long SimBoard::getUnsetWriteCount() {
+  return unsetWriteCount;
+ }
+
+ // Starts a task whose step runs every period nanoseconds
+ bool SimBoard::startTask(SimHandler step,void* arg,unsigned long long period) {
+  SimTask task;
+  task.step = step;
+  task.arg = arg;
+  task.period = period > 0 ? period : 1000;
+  task.nextRun = time;
+  tasks.push_back(task);
+  return true;
+ }
+
+ // Starts timing the gaps between feeds, timeout in nanoseconds
+ void SimBoard::watchdogBegin(unsigned long long timeout) {
+  watchdogTimeout = timeout;
+  lastFeedTime = time;
+ }
+
+ // A feed later than the timeout would have reset the ESP32, it is counted instead
+ void SimBoard::watchdogFeed() {
+  if(watchdogTimeout == 0) return;
+  unsigned long long gap = time - lastFeedTime;
+  if(gap > maxFeedGap) maxFeedGap = gap;
+  if(gap > watchdogTimeout) watchdogTrips++;
+  lastFeedTime = time;
+ }
+
+ // Returns the longest time between feeds in nanoseconds
+ unsigned long long SimBoard::getMaxFeedGap() {
+  return maxFeedGap;
+ }
+
+ unsigned long SimBoard::getWatchdogTrips() {
+  return watchdogTrips;
+ }
+
+ uint32_t SimBoard::getFlashSize() {
+  return flash.size();
+ }
+
+ // Sets whole sectors back to 0xFF
+ bool SimBoard::flashErase(uint32_t offset,uint32_t length) {
+  if(offset % SIM_FLASH_SECTOR_SIZE || length % SIM_FLASH_SECTOR_SIZE || offset + length > flash.size()) return false;
+  stall(length / SIM_FLASH_SECTOR_SIZE * SIM_COST_FLASH_ERASE);
+  memset(&flash[offset],0xFF,length);
+  return true;
+ }
+
+ // Writing can only clear bits, like NOR flash
+ bool SimBoard::flashWrite(uint32_t offset,const void* data,uint32_t length) {
+  if(offset + length > flash.size()) return false;
+  stall(length * SIM_COST_FLASH_WRITE);
+  for(uint32_t i = 0; i < length; i++) flash[offset + i] &= ((const uint8_t*)data)[i];
+  return true;
+ }
+
+ bool SimBoard::flashRead(uint32_t offset,void* data,uint32_t length) {
+  if(offset + length > flash.size()) return false;
+  charge(length * SIM_COST_FLASH_READ);
+  memcpy(data,&flash[offset],length);
+  return true;
+ }
+
+ // Returns the whole flash, to save the log to a file
+ const std::vector<uint8_t>& SimBoard::getFlash() {
+  return flash;
+ }
+#endif
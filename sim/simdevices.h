@@ -0,0 +1,604 @@
+/* Simulated devices
+ * 18 October 2026
+ * 
+ * Models of the hardware on the car, attached to the pins and PWM channels of SimBoard:
+ * - SimController: NES controller (4021 shift register) with buttons set by the scenario
+ * - SimServo: SG90 servo that follows the PWM pulse width at a limited slew rate
+ * - SimMotor: motor driver, turns the direction pins and PWM duty cycle into a speed, and
+ *   keeps the largest step in throttle (braking aside) to show how smoothly it is ramped
+ * - SimWorld: obstacles around the car, which get closer as the car drives forward. It records
+ *   the first time an obstacle ahead comes closer than the clearance set by the scenario, or
+ *   reaches the car
+ * - SimSonar: HC-SR04, answers a trigger with an echo pulse for the nearest obstacle, and
+ *   can flag the first echo from closer than a set distance ahead. When replaying a log it
+ *   answers with the last recorded reading at the angle instead of looking at the world.
+ *   Sonars pointing within SIM_SONAR_BEAM_ANGLE of each other hear each other's bursts: an
+ *   echo line that is waiting falls early when another sonar's echo arrives, a ghost echo.
+ *   Echoes from further than SIM_SONAR_CROSSTALK_RANGE are too faint to be heard that way
+ */ 
+
+#ifndef SIMDEVICES_H
+#define SIMDEVICES_H
+
+#include <vector>
+#include <math.h>
+#include "simboard.h"
+
+ // Echo line rises this long after the trigger falls (8 cycle 40kHz burst plus processing)
+ const unsigned long long SIM_SONAR_ECHO_DELAY = 450000;
+ // Echo length when nothing is detected, in nanoseconds
+ const unsigned long long SIM_SONAR_NO_ECHO = 38000000;
+ const double SIM_SONAR_MAX_RANGE = 400;
+ const double SIM_SONAR_MIN_RANGE = 1; // Anything closer still gives an echo this long
+ const int SIM_SONAR_ANGLES = 181; // Angles a replayed reading can be given for (0 to 180)
+ const double SIM_SONAR_MICROS_PER_INCH = 146.591;
+ const double SIM_SONAR_BEAM_ANGLE = 30; // Sonars pointing closer together than this hear each other
+ const double SIM_SONAR_CROSSTALK_RANGE = 72; // Bursts from further than this (inches) are too faint for other sonars
+ const double SIM_TURN_DEGREES_PER_INCH = 3.0; // Turn of the car per inch driven at full steering lock
+
+ class SimController {
+  private:
+    int latchWire;
+    int clockWire;
+    int dataWire;
+    uint8_t buttons; // Bit set for each button pressed, in the order read by Controller
+    uint8_t shiftRegister;
+    unsigned long long changeTime;
+    void outputBit();
+    static void onPin(int pin,int level,void* arg);
+  public:
+    SimController(int latchWire,int clockWire,int dataWire);
+    void setButtons(uint8_t buttons);
+    uint8_t getButtons();
+    unsigned long long getChangeTime();
+ };
+
+ SimController::SimController(int latchWire,int clockWire,int dataWire) {
+  this->latchWire = latchWire;
+  this->clockWire = clockWire;
+  this->dataWire = dataWire;
+  buttons = 0;
+  shiftRegister = 0;
+  changeTime = 0;
+  SimBoard::get().addPinListener(latchWire,onPin,this);
+  SimBoard::get().addPinListener(clockWire,onPin,this);
+  outputBit();
+ }
+
+ // The data line is low while the current button is pressed
+ void SimController::outputBit() {
+  SimBoard::get().drivePin(dataWire,(shiftRegister & 0x01) ? 0 : 1);
+ }
+
+ void SimController::onPin(int pin,int level,void* arg) {
+  SimController* controller = (SimController*)arg;
+  if(!level) return;
+  if(pin == controller->latchWire) {
+    // Latch loads the buttons
+    controller->shiftRegister = controller->buttons;
+  }
+  else {
+    // Clock shifts the next button onto the data line
+    controller->shiftRegister = controller->shiftRegister >> 1;
+  }
+  controller->outputBit();
+ }
+
+ void SimController::setButtons(uint8_t buttons) {
+  if(buttons != this->buttons) changeTime = SimBoard::get().getTime();
+  this->buttons = buttons;
+ }
+
+ uint8_t SimController::getButtons() {
+  return buttons;
+ }
+
+ // Returns the time the buttons last changed (nanoseconds)
+ unsigned long long SimController::getChangeTime() {
+  return changeTime;
+ }
+
+ class SimServo {
+  private:
+    int channel;
+    double slewRate; // Degrees per millisecond
+    double startAngle;
+    double targetAngle;
+    unsigned long long commandTime;
+    unsigned long long changeTime;
+    static void onPWM(int channel,uint32_t dutyCycle,void* arg);
+  public:
+    SimServo(int channel,double slewRate,double homeAngle);
+    double getAngle();
+    double getTargetAngle();
+    unsigned long long getChangeTime();
+ };
+
+ SimServo::SimServo(int channel,double slewRate,double homeAngle) {
+  this->channel = channel;
+  this->slewRate = slewRate;
+  startAngle = homeAngle;
+  targetAngle = homeAngle;
+  commandTime = 0;
+  changeTime = 0;
+  SimBoard::get().addPWMListener(channel,onPWM,this);
+ }
+
+ // A 1ms pulse is 0 degrees and a 2ms pulse is 180 degrees
+ void SimServo::onPWM(int channel,uint32_t dutyCycle,void* arg) {
+  SimServo* servo = (SimServo*)arg;
+  double angle = (SimBoard::get().getPulseMicros(channel) - 1000.0) * 180.0 / 1000.0;
+  if(fabs(angle - servo->targetAngle) < 0.01) return;
+  servo->startAngle = servo->getAngle();
+  servo->targetAngle = angle;
+  servo->commandTime = SimBoard::get().getTime();
+  servo->changeTime = servo->commandTime;
+ }
+
+ // Returns where the servo horn actually is right now
+ double SimServo::getAngle() {
+  double travelled = slewRate * (SimBoard::get().getTime() - commandTime) / 1000000.0;
+  double remaining = targetAngle - startAngle;
+  if(travelled >= fabs(remaining)) return targetAngle;
+  return remaining > 0 ? startAngle + travelled : startAngle - travelled;
+ }
+
+ double SimServo::getTargetAngle() {
+  return targetAngle;
+ }
+
+ // Returns the time the servo was last given a new angle (nanoseconds)
+ unsigned long long SimServo::getChangeTime() {
+  return changeTime;
+ }
+
+ // An obstacle covering a range of angles at a distance from the car
+ struct SimObstacle {
+  double minAngle;
+  double maxAngle;
+  double distance; // Inches
+ };
+
+ class SimWorld {
+  private:
+    std::vector<SimObstacle> obstacles;
+    double carSpeed; // Inches per second, positive is forward
+    double topSpeed; // Inches per second at full throttle
+    unsigned long long updateTime;
+    double closestApproach;
+    double minClearance; // Closest an obstacle ahead may come (inches), 0 only checks for a collision
+    bool isBreached;
+    unsigned long long breachTime;
+    double breachDistance;
+    double odometer; // Inches driven forward since the start
+    SimServo* steering; // Turns the car, 90 degrees is straight
+    void update();
+  public:
+    SimWorld();
+    void addObstacle(double minAngle,double maxAngle,double distance);
+    void clearObstacles();
+    void setTopSpeed(double topSpeed);
+    void setThrottle(double throttle);
+    void setSteering(SimServo* steering);
+    double getDistance(double angle);
+    double getClosestApproach();
+    void setMinClearance(double clearance);
+    double getMinClearance();
+    bool getBreach(unsigned long long* time,double* distance);
+    double getOdometer();
+ };
+
+ SimWorld::SimWorld() {
+  carSpeed = 0;
+  topSpeed = 60;
+  updateTime = 0;
+  closestApproach = SIM_SONAR_MAX_RANGE;
+  minClearance = 0;
+  isBreached = false;
+  breachTime = 0;
+  breachDistance = 0;
+  odometer = 0;
+  steering = 0;
+ }
+
+ // Moves the obstacles by how far the car has driven since the last update
+ void SimWorld::update() {
+  unsigned long long currentTime = SimBoard::get().getTime();
+  double travelled = carSpeed * (currentTime - updateTime) / 1000000000.0;
+  updateTime = currentTime;
+  if(travelled == 0) return;
+  if(travelled > 0) odometer += travelled;
+  // Steering left (below 90) turns the car left, so the obstacles move round to the right
+  double turn = 0;
+  if(steering) turn = travelled * (90 - steering->getAngle()) / 90.0 * SIM_TURN_DEGREES_PER_INCH;
+  for(size_t i = 0; i < obstacles.size(); i++) {
+    obstacles[i].minAngle -= turn;
+    obstacles[i].maxAngle -= turn;
+    // Angles are measured from the right side of the car, 90 degrees is straight ahead
+    double centerAngle = (obstacles[i].minAngle + obstacles[i].maxAngle) / 2.0;
+    obstacles[i].distance -= travelled * sin(centerAngle * M_PI / 180.0);
+    if(obstacles[i].distance < 0) obstacles[i].distance = 0;
+    if(obstacles[i].minAngle > 90 || obstacles[i].maxAngle < 90) continue;
+    if(obstacles[i].distance < closestApproach) closestApproach = obstacles[i].distance;
+    if(!isBreached && (obstacles[i].distance <= 0 || obstacles[i].distance < minClearance)) {
+      isBreached = true;
+      breachTime = currentTime;
+      breachDistance = obstacles[i].distance;
+    }
+  }
+ }
+
+ void SimWorld::addObstacle(double minAngle,double maxAngle,double distance) {
+  update();
+  SimObstacle obstacle;
+  obstacle.minAngle = minAngle;
+  obstacle.maxAngle = maxAngle;
+  obstacle.distance = distance;
+  obstacles.push_back(obstacle);
+ }
+
+ void SimWorld::clearObstacles() {
+  update();
+  obstacles.clear();
+ }
+
+ void SimWorld::setTopSpeed(double topSpeed) {
+  update();
+  this->topSpeed = topSpeed;
+ }
+
+ // Sets the throttle from -1 to 1
+ void SimWorld::setThrottle(double throttle) {
+  update();
+  carSpeed = throttle * topSpeed;
+ }
+
+ // Lets the steering servo turn the car
+ void SimWorld::setSteering(SimServo* steering) {
+  update();
+  this->steering = steering;
+ }
+
+ // Returns the distance to the nearest obstacle at an angle, -1 if there is none
+ double SimWorld::getDistance(double angle) {
+  update();
+  double distance = -1;
+  for(size_t i = 0; i < obstacles.size(); i++) {
+    if(angle >= obstacles[i].minAngle && angle <= obstacles[i].maxAngle) {
+      if(distance < 0 || obstacles[i].distance < distance) distance = obstacles[i].distance;
+    }
+  }
+  return distance;
+ }
+
+ // Returns the closest any obstacle straight ahead has come to the car
+ double SimWorld::getClosestApproach() {
+  update();
+  return closestApproach;
+ }
+
+ // Sets the closest an obstacle ahead may come from now on (inches)
+ void SimWorld::setMinClearance(double clearance) {
+  update();
+  minClearance = clearance;
+ }
+
+ double SimWorld::getMinClearance() {
+  return minClearance;
+ }
+
+ // Returns true if an obstacle ahead came closer than the clearance or hit the car, with when and how close
+ bool SimWorld::getBreach(unsigned long long* time,double* distance) {
+  update();
+  *time = breachTime;
+  *distance = breachDistance;
+  return isBreached;
+ }
+
+ // Returns how far the car has driven forward since the start (inches)
+ double SimWorld::getOdometer() {
+  update();
+  return odometer;
+ }
+
+ class SimMotor {
+  private:
+    int controlWire1;
+    int controlWire2;
+    int channel;
+    double throttle;
+    double maxStep; // Largest change in throttle at once, not counting brakes
+    unsigned long long changeTime;
+    unsigned long long stopTime;
+    SimWorld* world;
+    void update();
+    static void onPin(int pin,int level,void* arg);
+    static void onPWM(int channel,uint32_t dutyCycle,void* arg);
+  public:
+    SimMotor(int controlWire1,int controlWire2,int channel,SimWorld* world);
+    double getThrottle();
+    unsigned long long getChangeTime();
+    unsigned long long getStopTime();
+    double getMaxStep();
+ };
+
+ SimMotor::SimMotor(int controlWire1,int controlWire2,int channel,SimWorld* world) {
+  this->controlWire1 = controlWire1;
+  this->controlWire2 = controlWire2;
+  this->channel = channel;
+  this->world = world;
+  throttle = 0;
+  maxStep = 0;
+  changeTime = 0;
+  stopTime = 0;
+  SimBoard::get().addPinListener(controlWire1,onPin,this);
+  SimBoard::get().addPinListener(controlWire2,onPin,this);
+  SimBoard::get().addPWMListener(channel,onPWM,this);
+ }
+
+ // Works out the throttle from the direction pins and duty cycle, both pins low is a brake
+ void SimMotor::update() {
+  SimBoard& board = SimBoard::get();
+  double newThrottle = board.getDutyFraction(channel);
+  int wire1 = board.getPinLevel(controlWire1);
+  int wire2 = board.getPinLevel(controlWire2);
+  if(wire1 == wire2) newThrottle = 0;
+  else if(wire2) newThrottle = -newThrottle;
+  if(newThrottle == throttle) return;
+  if(newThrottle != 0 && fabs(newThrottle - throttle) > maxStep) maxStep = fabs(newThrottle - throttle);
+  if(throttle > 0 && newThrottle <= 0) stopTime = board.getTime();
+  throttle = newThrottle;
+  changeTime = board.getTime();
+  world->setThrottle(throttle);
+ }
+
+ void SimMotor::onPin(int pin,int level,void* arg) {
+  ((SimMotor*)arg)->update();
+ }
+
+ void SimMotor::onPWM(int channel,uint32_t dutyCycle,void* arg) {
+  ((SimMotor*)arg)->update();
+ }
+
+ double SimMotor::getThrottle() {
+  return throttle;
+ }
+
+ // Returns the time the throttle last changed (nanoseconds)
+ unsigned long long SimMotor::getChangeTime() {
+  return changeTime;
+ }
+
+ // Returns the time the throttle last stopped going forward (nanoseconds)
+ unsigned long long SimMotor::getStopTime() {
+  return stopTime;
+ }
+
+ double SimMotor::getMaxStep() {
+  return maxStep;
+ }
+
+ class SimSonar {
+  private:
+    int triggerPin;
+    int echoPin;
+    SimServo* mount; // Servo the sensor is mounted on
+    double fixedAngle; // Angle of the sensor if it has no servo
+    SimWorld* world;
+    bool isEchoing;
+    unsigned long pingCount;
+    unsigned long long echoLength;
+    double jitter; // Largest error of a reading (inches)
+    double outlierChance; // Chance of a reading being a missed echo or an echo from something closer
+    unsigned long noiseSeed;
+    double alarmDistance; // Echoes closer than this ahead set the alarm, 0 for none
+    double alarmAngle; // Angles this far either side of 90 degrees are ahead
+    bool isCloseEcho; // The echo in flight is close enough for the alarm
+    bool isAlarmSet;
+    unsigned long long triggerTime;
+    unsigned long long alarmTriggerTime;
+    unsigned long long alarmEchoTime;
+    double burstAngle; // Angle the sonar pointed when it fired
+    unsigned long long echoEndTime; // Time the echo line will fall
+    unsigned long long arrivalTime; // Time the burst comes back, 0 if it does not
+    bool isEchoStarted;
+    unsigned long ghostCount;
+    double readRange; // Ghost echoes are only counted if they cut the echo short within this range
+    bool isReplaying;
+    double replayDistances[SIM_SONAR_ANGLES]; // Last recorded reading at each angle, -1 if none
+    double random();
+    static void onTrigger(int pin,int level,void* arg);
+    static void onEchoStart(void* arg);
+    static void onEchoEnd(void* arg);
+    static std::vector<SimSonar*>& getSonars();
+    bool canHear(const SimSonar* other);
+    void hear(unsigned long long arrival);
+  public:
+    SimSonar(int triggerPin,int echoPin,SimServo* mount,double fixedAngle,SimWorld* world);
+    ~SimSonar();
+    unsigned long getPingCount();
+    unsigned long getGhostCount();
+    void setNoise(double jitter,double outlierChance);
+    void setReadRange(double distance);
+    void setAlarm(double distance,double angle);
+    bool getAlarm(unsigned long long* triggerTime,unsigned long long* echoTime);
+    void clearAlarm();
+    void setReplayDistance(int angle,double distance);
+ };
+
+ SimSonar::SimSonar(int triggerPin,int echoPin,SimServo* mount,double fixedAngle,SimWorld* world) {
+  this->triggerPin = triggerPin;
+  this->echoPin = echoPin;
+  this->mount = mount;
+  this->fixedAngle = fixedAngle;
+  this->world = world;
+  isEchoing = false;
+  pingCount = 0;
+  echoLength = 0;
+  jitter = 0;
+  outlierChance = 0;
+  noiseSeed = 12345;
+  alarmDistance = 0;
+  alarmAngle = 0;
+  isCloseEcho = false;
+  isAlarmSet = false;
+  triggerTime = 0;
+  alarmTriggerTime = 0;
+  alarmEchoTime = 0;
+  burstAngle = fixedAngle;
+  echoEndTime = 0;
+  arrivalTime = 0;
+  isEchoStarted = false;
+  ghostCount = 0;
+  readRange = SIM_SONAR_MAX_RANGE;
+  isReplaying = false;
+  for(int i = 0; i < SIM_SONAR_ANGLES; i++) replayDistances[i] = -1;
+  SimBoard::get().addPinListener(triggerPin,onTrigger,this);
+  getSonars().push_back(this);
+ }
+
+ SimSonar::~SimSonar() {
+  std::vector<SimSonar*>& sonars = getSonars();
+  for(size_t i = 0; i < sonars.size(); i++) {
+    if(sonars[i] == this) sonars.erase(sonars.begin() + i);
+  }
+ }
+
+ // Every sonar, so they can hear each other
+ std::vector<SimSonar*>& SimSonar::getSonars() {
+  static std::vector<SimSonar*> sonars;
+  return sonars;
+ }
+
+ // The burst is sent when the trigger falls, the echo follows a little later
+ void SimSonar::onTrigger(int pin,int level,void* arg) {
+  SimSonar* sonar = (SimSonar*)arg;
+  if(level || sonar->isEchoing) return;
+  double angle = sonar->mount ? sonar->mount->getAngle() : sonar->fixedAngle;
+  double distance = sonar->world->getDistance(angle);
+  if(sonar->isReplaying) {
+    int index = (int)(angle + 0.5);
+    distance = index >= 0 && index < SIM_SONAR_ANGLES ? sonar->replayDistances[index] : -1;
+  }
+  sonar->isEchoing = true;
+  sonar->pingCount++;
+  sonar->triggerTime = SimBoard::get().getTime();
+  if(distance >= 0) distance += (sonar->random() * 2 - 1) * sonar->jitter;
+  if(sonar->random() < sonar->outlierChance) {
+    distance = sonar->random() < 0.5 ? -1 : sonar->random() * (distance < 0 ? SIM_SONAR_MAX_RANGE : distance);
+  }
+  if(distance < 0 || distance > SIM_SONAR_MAX_RANGE) {
+    sonar->echoLength = SIM_SONAR_NO_ECHO;
+  }
+  else {
+    if(distance < SIM_SONAR_MIN_RANGE) distance = SIM_SONAR_MIN_RANGE;
+    sonar->echoLength = distance * SIM_SONAR_MICROS_PER_INCH * 1000.0;
+  }
+  sonar->isCloseEcho = distance >= 0 && distance < sonar->alarmDistance && fabs(angle - 90) <= sonar->alarmAngle;
+  sonar->burstAngle = angle;
+  sonar->echoEndTime = sonar->triggerTime + SIM_SONAR_ECHO_DELAY + sonar->echoLength;
+  // Bursts from further away are too faint to be heard by other sonars
+  bool isLoud = sonar->echoLength != SIM_SONAR_NO_ECHO && distance <= SIM_SONAR_CROSSTALK_RANGE;
+  sonar->arrivalTime = isLoud ? sonar->echoEndTime : 0;
+
+  // Bursts in flight from sonars pointing the same way are heard as well as the sonar's own
+  std::vector<SimSonar*>& sonars = getSonars();
+  for(size_t i = 0; i < sonars.size(); i++) {
+    SimSonar* other = sonars[i];
+    if(other == sonar || !other->isEchoing || !sonar->canHear(other)) continue;
+    if(other->arrivalTime) sonar->hear(other->arrivalTime);
+    if(sonar->arrivalTime) other->hear(sonar->arrivalTime);
+  }
+  SimBoard::get().schedule(sonar->triggerTime + SIM_SONAR_ECHO_DELAY,onEchoStart,sonar);
+ }
+
+ // Returns true if the sonars point close enough together to hear each other's bursts
+ bool SimSonar::canHear(const SimSonar* other) {
+  double angle = fmod(fabs(burstAngle - other->burstAngle),360);
+  if(angle > 180) angle = 360 - angle;
+  return angle < SIM_SONAR_BEAM_ANGLE;
+ }
+
+ // A burst arriving while the echo line is high ends the echo early, a ghost echo
+ void SimSonar::hear(unsigned long long arrival) {
+  if(arrival <= triggerTime + SIM_SONAR_ECHO_DELAY || arrival >= echoEndTime) return;
+  echoEndTime = arrival;
+  if(arrival - triggerTime - SIM_SONAR_ECHO_DELAY < readRange * SIM_SONAR_MICROS_PER_INCH * 1000.0) ghostCount++;
+  if(isEchoStarted) SimBoard::get().schedule(echoEndTime,onEchoEnd,this);
+ }
+
+ void SimSonar::onEchoStart(void* arg) {
+  SimSonar* sonar = (SimSonar*)arg;
+  SimBoard::get().drivePin(sonar->echoPin,1);
+  sonar->isEchoStarted = true;
+  SimBoard::get().schedule(sonar->echoEndTime,onEchoEnd,sonar);
+ }
+
+ void SimSonar::onEchoEnd(void* arg) {
+  SimSonar* sonar = (SimSonar*)arg;
+  // An echo cut short by a ghost leaves its first end behind
+  if(!sonar->isEchoing || SimBoard::get().getTime() != sonar->echoEndTime) return;
+  SimBoard::get().drivePin(sonar->echoPin,0);
+  sonar->isEchoing = false;
+  sonar->isEchoStarted = false;
+  if(sonar->isCloseEcho && !sonar->isAlarmSet) {
+    sonar->isAlarmSet = true;
+    sonar->alarmTriggerTime = sonar->triggerTime;
+    sonar->alarmEchoTime = SimBoard::get().getTime();
+  }
+ }
+
+ unsigned long SimSonar::getPingCount() {
+  return pingCount;
+ }
+
+ // Returns the number of echoes cut short by another sonar's burst
+ unsigned long SimSonar::getGhostCount() {
+  return ghostCount;
+ }
+
+ // Adds errors to the readings, the same run always gets the same errors
+ void SimSonar::setNoise(double jitter,double outlierChance) {
+  this->jitter = jitter;
+  this->outlierChance = outlierChance;
+ }
+
+ /* Sets the max range the firmware reads the sonar to. An echo longer than that has already
+  * been given up, so a ghost cutting it short does no harm and is not counted.
+  */
+ void SimSonar::setReadRange(double distance) {
+  readRange = distance;
+ }
+
+ // Echoes from closer than distance, within angle of straight ahead, will set the alarm
+ void SimSonar::setAlarm(double distance,double angle) {
+  alarmDistance = distance;
+  alarmAngle = angle;
+ }
+
+ // Returns true if a close echo has set the alarm, with when it was triggered and when it ended
+ bool SimSonar::getAlarm(unsigned long long* triggerTime,unsigned long long* echoTime) {
+  if(!isAlarmSet) return false;
+  *triggerTime = alarmTriggerTime;
+  *echoTime = alarmEchoTime;
+  return true;
+ }
+
+ // Waits for the next close echo
+ void SimSonar::clearAlarm() {
+  isAlarmSet = false;
+ }
+
+ // From now on pings at this angle are answered with the recorded distance, not the world
+ void SimSonar::setReplayDistance(int angle,double distance) {
+  if(angle < 0 || angle >= SIM_SONAR_ANGLES) return;
+  isReplaying = true;
+  replayDistances[angle] = distance;
+ }
+
+ // Returns a number from 0 to 1 (linear congruential generator)
+ double SimSonar::random() {
+  noiseSeed = noiseSeed * 1103515245UL + 12345UL;
+  return ((noiseSeed >> 16) & 0x7FFF) / 32768.0;
+ }
+#endif
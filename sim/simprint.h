@@ -0,0 +1,97 @@
+/* Print and Stream classes for the simulator
+ * 18 October 2026
+ * 
+ * Same interface as the Print and Stream base classes of the Arduino core, so code can
+ * take a Print* or Stream* and work with Serial (or any other port) on the car and in the
+ * simulator.
+ */ 
+
+#ifndef SIMPRINT_H
+#define SIMPRINT_H
+
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include "simboard.h"
+
+ class Print {
+  public:
+    virtual ~Print() {}
+    virtual size_t write(uint8_t value) = 0;
+    virtual size_t write(const uint8_t* buffer,size_t size);
+    virtual int availableForWrite();
+    size_t print(const char* text);
+    size_t print(char value);
+    size_t print(int value);
+    size_t print(unsigned int value);
+    size_t print(long value);
+    size_t print(unsigned long value);
+    size_t print(double value,int digits = 2);
+    size_t println();
+    template <typename T> size_t println(T value);
+ };
+
+ class Stream : public Print {
+  public:
+    virtual int available() = 0;
+    virtual int read() = 0;
+    virtual int peek() = 0;
+ };
+
+ size_t Print::write(const uint8_t* buffer,size_t size) {
+  for(size_t i = 0; i < size; i++) {
+    write(buffer[i]);
+  }
+  return size;
+ }
+
+ // Returns how many bytes can be written without blocking
+ int Print::availableForWrite() {
+  return 0;
+ }
+
+ size_t Print::print(const char* text) {
+  return write((const uint8_t*)text,strlen(text));
+ }
+
+ size_t Print::print(char value) {
+  return write((uint8_t)value);
+ }
+
+ size_t Print::print(int value) {
+  return print((long)value);
+ }
+
+ size_t Print::print(unsigned int value) {
+  return print((unsigned long)value);
+ }
+
+ size_t Print::print(long value) {
+  char text[24];
+  snprintf(text,sizeof(text),"%ld",value);
+  return print(text);
+ }
+
+ size_t Print::print(unsigned long value) {
+  char text[24];
+  snprintf(text,sizeof(text),"%lu",value);
+  return print(text);
+ }
+
+ size_t Print::print(double value,int digits) {
+  char text[40];
+  SimBoard::get().charge(SIM_COST_FORMAT);
+  snprintf(text,sizeof(text),"%.*f",digits,value);
+  return print(text);
+ }
+
+ size_t Print::println() {
+  return print("\r\n");
+ }
+
+ template <typename T>
+ size_t Print::println(T value) {
+  size_t size = print(value);
+  return size + println();
+ }
+#endif
@@ -0,0 +1,169 @@
+/* SimSerial class
+ * 18 October 2026
+ * 
+ * Serial port of the simulated board. Transmitted bytes drain from a FIFO at the baud rate
+ * on the virtual clock, so a write that overflows the FIFO blocks the caller just like it
+ * does on the car. Everything sent is kept so it can be checked after a run. Received bytes
+ * can be queued to arrive at a set time.
+ */ 
+
+#ifndef SIMSERIAL_H
+#define SIMSERIAL_H
+
+#include <stdio.h>
+#include <string>
+#include <deque>
+#include "simboard.h"
+#include "simprint.h"
+
+ // Size of the transmit FIFO plus driver buffer on the ESP32
+ const size_t SIM_SERIAL_TX_BUFFER = 128;
+
+ // A received byte and the time it arrives (nanoseconds)
+ struct SimSerialByte {
+  unsigned long long time;
+  uint8_t value;
+ };
+
+ class SimSerial : public Stream {
+  private:
+    long baudRate;
+    size_t txQueued; // Bytes waiting to be sent
+    unsigned long long txTime; // Time the FIFO was last drained up to
+    unsigned long long blockedTime; // Time writers spent waiting for room in the FIFO
+    std::string output;
+    std::deque<SimSerialByte> input;
+    bool isEcho;
+    unsigned long long getByteTime();
+    void drain();
+  public:
+    SimSerial();
+    void begin(long baudRate,int config = 0,int rxPin = -1,int txPin = -1);
+    size_t write(uint8_t value);
+    size_t write(const uint8_t* buffer,size_t size);
+    int availableForWrite();
+    int available();
+    int read();
+    int peek();
+    // Simulator side
+    void queueInput(unsigned long long arriveTime,const uint8_t* data,size_t size);
+    void setEcho(bool isEcho);
+    const std::string& getOutput();
+    void clearOutput();
+    unsigned long long getBlockedTime();
+ };
+
+ // Constructor
+ SimSerial::SimSerial() {
+  baudRate = 115200;
+  txQueued = 0;
+  txTime = 0;
+  blockedTime = 0;
+  isEcho = false;
+ }
+
+ void SimSerial::begin(long baudRate,int config,int rxPin,int txPin) {
+  this->baudRate = baudRate;
+  txTime = SimBoard::get().getTime();
+ }
+
+ // Time to send one byte (start bit, 8 data bits, stop bit) in nanoseconds
+ unsigned long long SimSerial::getByteTime() {
+  return 10000000000ULL / baudRate;
+ }
+
+ // Removes the bytes that have been sent since the last drain
+ void SimSerial::drain() {
+  unsigned long long currentTime = SimBoard::get().getTime();
+  unsigned long long sent = (currentTime - txTime) / getByteTime();
+  if(sent >= txQueued) {
+    txQueued = 0;
+    txTime = currentTime;
+  }
+  else {
+    txQueued -= sent;
+    txTime += sent * getByteTime();
+  }
+ }
+
+ // Queues a byte to send, waiting for room in the FIFO if it is full
+ size_t SimSerial::write(uint8_t value) {
+  SimBoard::get().charge(SIM_COST_SERIAL);
+  drain();
+  if(txQueued >= SIM_SERIAL_TX_BUFFER) {
+    unsigned long long startTime = SimBoard::get().getTime();
+    SimBoard::get().advanceTo(txTime + getByteTime());
+    blockedTime += SimBoard::get().getTime() - startTime;
+    drain();
+  }
+  txQueued++;
+  output.push_back((char)value);
+  if(isEcho) putchar(value);
+  return 1;
+ }
+
+ size_t SimSerial::write(const uint8_t* buffer,size_t size) {
+  for(size_t i = 0; i < size; i++) {
+    write(buffer[i]);
+  }
+  return size;
+ }
+
+ // Returns how many bytes can be written without blocking
+ int SimSerial::availableForWrite() {
+  drain();
+  return SIM_SERIAL_TX_BUFFER - txQueued;
+ }
+
+ int SimSerial::available() {
+  unsigned long long currentTime = SimBoard::get().getTime();
+  int count = 0;
+  for(size_t i = 0; i < input.size() && input[i].time <= currentTime; i++) {
+    count++;
+  }
+  return count;
+ }
+
+ int SimSerial::read() {
+  int value = peek();
+  if(value >= 0) input.pop_front();
+  return value;
+ }
+
+ int SimSerial::peek() {
+  if(input.empty() || input.front().time > SimBoard::get().getTime()) return -1;
+  return input.front().value;
+ }
+
+ // Makes data arrive on the receive line at arriveTime (nanoseconds)
+ void SimSerial::queueInput(unsigned long long arriveTime,const uint8_t* data,size_t size) {
+  // Bytes arrive one after the other at the baud rate
+  for(size_t i = 0; i < size; i++) {
+    SimSerialByte received;
+    received.time = arriveTime + i * getByteTime();
+    received.value = data[i];
+    std::deque<SimSerialByte>::iterator position = input.end();
+    while(position != input.begin() && (position - 1)->time > received.time) position--;
+    input.insert(position,received);
+  }
+ }
+
+ // Prints everything sent to stdout as well
+ void SimSerial::setEcho(bool isEcho) {
+  this->isEcho = isEcho;
+ }
+
+ const std::string& SimSerial::getOutput() {
+  return output;
+ }
+
+ void SimSerial::clearOutput() {
+  output.clear();
+ }
+
+ unsigned long long SimSerial::getBlockedTime() {
+  return blockedTime;
+ }
+
+ static SimSerial Serial;
+#endif
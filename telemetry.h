@@ -0,0 +1,353 @@
+/* Telemetry class
+ * 18 October 2026
+ * 
+ * Sends the state of the car as small binary frames instead of text. Frames are queued in a
+ * fixed buffer during the loop and flush() only writes what the serial port can take
+ * without blocking, so telemetry can never stall the control loop.
+ * 
+ * When the buffer fills up, frames are dropped by priority: low priority frames (sweeps, points)
+ * need half of the buffer free, normal priority frames (distances) a quarter, and high
+ * priority frames (controller, actuators, status, command, text) only need room for themselves. Each frame
+ * type can also be decimated so only every Nth frame offered is queued.
+ * 
+ * Frame format (multi byte values are little endian):
+ *   [0]     TELEMETRY_SYNC (0xA5)
+ *   [1]     type (TelemetryType)
+ *   [2]     payload length
+ *   [3..]   payload
+ *   [last2] CRC-16/CCITT (polynomial 0x1021, initial 0xFFFF) of type, length and payload
+ * 
+ * Payloads (times in micros, distances in tenths of an inch, -1 if nothing in range):
+ *   TEXT        characters of one line, no terminator
+ *   DISTANCE    u32 time, i16 distance
+ *   SCAN        u32 start time, u32 duration, u8 flags (bit 0 = forward), u8 count,
+ *               count x (u8 angle, i16 distance)
+ *   CONTROLLER  u32 time, u8 buttons
+ *   ACTUATORS   u32 time, i8 speed (percent), u8 steering angle, u8 eye angle
+ *   STATUS      u32 time, u32 control period (max since last status), u32 frames dropped,
+ *               u32 output writes, u32 output writes skipped (unchanged)
+ *   COMMAND     u32 time, u8 command type (CommandType), u32 latency (micros from the command
+ *               frame being read to the targets being set), one per command acted on
+ *   POINT       u32 time, u8 angle, i16 distance, one reading of a sweep as soon as it is taken
+ * 
+ * The largest frame is a SCAN of a whole sweep, so EYE_DIVISIONS is checked against
+ * TELEMETRY_MAX_PAYLOAD when compiling. The MiniDisplay's reader drops anything longer.
+ * 
+ * Commands sent to the car use the same framing, see commandlink.h.
+ */ 
+
+#ifndef TELEMETRY_H
+#define TELEMETRY_H
+
+#include "config.h"
+#include "hal.h"
+#include "echosweeper.h"
+
+ const uint8_t TELEMETRY_SYNC = 0xA5;
+ const int TELEMETRY_BUFFER_SIZE = 512;
+ const int TELEMETRY_MAX_PAYLOAD = 120;
+ const int TELEMETRY_FRAME_OVERHEAD = 5; // Sync, type, length and CRC
+ const int TELEMETRY_SCAN_HEADER = 10; // Bytes of a SCAN payload before the readings
+ const int TELEMETRY_SCAN_RECORD = 3; // Bytes per reading of a SCAN payload
+
+ static_assert(TELEMETRY_MAX_PAYLOAD <= 255,"The payload length is sent as one byte");
+ static_assert(TELEMETRY_SCAN_HEADER + SCAN_FRAME_CAPACITY * TELEMETRY_SCAN_RECORD <= TELEMETRY_MAX_PAYLOAD,
+   "A whole sweep does not fit in a SCAN frame, lower EYE_DIVISIONS");
+
+ enum TelemetryType {
+  TELEMETRY_TEXT = 1,
+  TELEMETRY_DISTANCE,
+  TELEMETRY_SCAN,
+  TELEMETRY_CONTROLLER,
+  TELEMETRY_ACTUATORS,
+  TELEMETRY_STATUS,
+  TELEMETRY_COMMAND,
+  TELEMETRY_POINT,
+  TELEMETRY_TYPE_COUNT
+ };
+
+ // Adds a byte to a CRC-16/CCITT, which starts at 0xFFFF
+ inline uint16_t telemetryCrc(uint16_t crc,uint8_t value) {
+  crc ^= (uint16_t)value << 8;
+  for(int i = 0; i < 8; i++) {
+    if(crc & 0x8000) crc = (crc << 1) ^ 0x1021;
+    else crc = crc << 1;
+  }
+  return crc;
+ }
+
+ enum TelemetryPriority {
+  PRIORITY_LOW,
+  PRIORITY_NORMAL,
+  PRIORITY_HIGH
+ };
+
+ class Telemetry {
+  private:
+    Print* output;
+    uint8_t buffer[TELEMETRY_BUFFER_SIZE]; // Ring buffer of queued bytes
+    int head; // Next byte to send
+    int count; // Bytes queued
+    uint16_t crc;
+    uint8_t decimation[TELEMETRY_TYPE_COUNT];
+    uint8_t offerCount[TELEMETRY_TYPE_COUNT];
+    unsigned long framesSent;
+    unsigned long framesDropped;
+    char text[TELEMETRY_MAX_PAYLOAD]; // Line being built by print()
+    int textLength;
+    bool beginFrame(TelemetryType type,int length,TelemetryPriority priority);
+    void put8(uint8_t value);
+    void put16(uint16_t value);
+    void put32(uint32_t value);
+    void putDistance(double distance);
+    void putRaw(uint8_t value);
+    void endFrame();
+  public:
+    Telemetry(Print* output);
+    void setDecimation(TelemetryType type,int decimation);
+    void sendText(const char* line);
+    void sendDistance(unsigned long timestamp,double distance);
+    void sendScan(const ScanFrame& frame);
+    void sendPoint(const ScanPoint& point);
+    void sendController(unsigned long timestamp,byte controllerData);
+    void sendActuators(unsigned long timestamp,float speed,int steeringAngle,int eyeAngle);
+    void sendStatus(unsigned long timestamp,unsigned long controlPeriod,const OutputStats& outputStats);
+    void sendCommand(unsigned long timestamp,int commandType,unsigned long latency);
+    void flush();
+    unsigned long getFramesSent();
+    unsigned long getFramesDropped();
+    int getQueued();
+    // Text lines, so Profiler::dump() and other text output can go through telemetry
+    void print(const char* value);
+    void print(unsigned long value);
+    void print(int value);
+    template <typename T> void println(T value);
+ };
+
+ // Constructor, frames are written to output (Serial)
+ Telemetry::Telemetry(Print* output) {
+  this->output = output;
+  head = 0;
+  count = 0;
+  crc = 0xFFFF;
+  framesSent = 0;
+  framesDropped = 0;
+  textLength = 0;
+  for(int i = 0; i < TELEMETRY_TYPE_COUNT; i++) {
+    decimation[i] = 1;
+    offerCount[i] = 0;
+  }
+ }
+
+ // Only every Nth frame of this type that is offered will be queued
+ void Telemetry::setDecimation(TelemetryType type,int decimation) {
+  if(decimation < 1) decimation = 1;
+  if(decimation > 255) decimation = 255;
+  this->decimation[type] = decimation;
+  offerCount[type] = 0;
+ }
+
+ // Starts a frame if decimation and the space left for its priority allow it
+ bool Telemetry::beginFrame(TelemetryType type,int length,TelemetryPriority priority) {
+  int frameSize = length + TELEMETRY_FRAME_OVERHEAD;
+  int reserved = 0;
+
+  // Decimation
+  if(offerCount[type] > 0) {
+    offerCount[type]--;
+    return false;
+  }
+  offerCount[type] = decimation[type] - 1;
+
+  // Lower priorities leave room for higher ones
+  if(priority == PRIORITY_LOW) reserved = TELEMETRY_BUFFER_SIZE / 2;
+  if(priority == PRIORITY_NORMAL) reserved = TELEMETRY_BUFFER_SIZE / 4;
+  if(TELEMETRY_BUFFER_SIZE - count - frameSize < reserved) {
+    framesDropped++;
+    return false;
+  }
+
+  putRaw(TELEMETRY_SYNC);
+  crc = 0xFFFF;
+  put8(type);
+  put8(length);
+  return true;
+ }
+
+ // Adds a byte to the buffer without updating the CRC
+ void Telemetry::putRaw(uint8_t value) {
+  int tail = head + count;
+  if(tail >= TELEMETRY_BUFFER_SIZE) tail -= TELEMETRY_BUFFER_SIZE;
+  buffer[tail] = value;
+  count++;
+ }
+
+ // Adds a byte to the frame, updating the CRC
+ void Telemetry::put8(uint8_t value) {
+  putRaw(value);
+  crc = telemetryCrc(crc,value);
+ }
+
+ void Telemetry::put16(uint16_t value) {
+  put8(value & 0xFF);
+  put8(value >> 8);
+ }
+
+ void Telemetry::put32(uint32_t value) {
+  put16(value & 0xFFFF);
+  put16(value >> 16);
+ }
+
+ // Distances are sent in tenths of an inch, -1 if nothing is in range
+ void Telemetry::putDistance(double distance) {
+  int16_t tenths = -1;
+  if(distance >= 0) {
+    tenths = distance >= 3276.7 ? 32767 : (int16_t)(distance * 10 + 0.5);
+  }
+  put16((uint16_t)tenths);
+ }
+
+ void Telemetry::endFrame() {
+  uint16_t frameCrc = crc;
+  putRaw(frameCrc & 0xFF);
+  putRaw(frameCrc >> 8);
+  framesSent++;
+ }
+
+ void Telemetry::sendText(const char* line) {
+  int length = strlen(line);
+  if(length > TELEMETRY_MAX_PAYLOAD) length = TELEMETRY_MAX_PAYLOAD;
+  if(!beginFrame(TELEMETRY_TEXT,length,PRIORITY_HIGH)) return;
+  for(int i = 0; i < length; i++) {
+    put8(line[i]);
+  }
+  endFrame();
+ }
+
+ void Telemetry::sendDistance(unsigned long timestamp,double distance) {
+  if(!beginFrame(TELEMETRY_DISTANCE,6,PRIORITY_NORMAL)) return;
+  put32(timestamp);
+  putDistance(distance);
+  endFrame();
+ }
+
+ void Telemetry::sendScan(const ScanFrame& frame) {
+  if(!beginFrame(TELEMETRY_SCAN,TELEMETRY_SCAN_HEADER + TELEMETRY_SCAN_RECORD * frame.count,PRIORITY_LOW)) return;
+  put32(frame.startTime);
+  put32(frame.endTime - frame.startTime);
+  put8(frame.isForward ? 0x01 : 0x00);
+  put8(frame.count);
+  for(int i = 0; i < frame.count; i++) {
+    put8(frame.points[i].angle);
+    putDistance(frame.points[i].isValid ? frame.points[i].distance : -1.0);
+  }
+  endFrame();
+ }
+
+ void Telemetry::sendPoint(const ScanPoint& point) {
+  if(!beginFrame(TELEMETRY_POINT,7,PRIORITY_LOW)) return;
+  put32(point.timestamp);
+  put8(point.angle);
+  putDistance(point.isValid ? point.distance : -1.0);
+  endFrame();
+ }
+
+ void Telemetry::sendController(unsigned long timestamp,byte controllerData) {
+  if(!beginFrame(TELEMETRY_CONTROLLER,5,PRIORITY_HIGH)) return;
+  put32(timestamp);
+  put8(controllerData);
+  endFrame();
+ }
+
+ void Telemetry::sendActuators(unsigned long timestamp,float speed,int steeringAngle,int eyeAngle) {
+  if(!beginFrame(TELEMETRY_ACTUATORS,7,PRIORITY_HIGH)) return;
+  put32(timestamp);
+  put8((uint8_t)(int8_t)(speed * 100));
+  put8(steeringAngle);
+  put8(eyeAngle);
+  endFrame();
+ }
+
+ void Telemetry::sendStatus(unsigned long timestamp,unsigned long controlPeriod,const OutputStats& outputStats) {
+  if(!beginFrame(TELEMETRY_STATUS,20,PRIORITY_HIGH)) return;
+  put32(timestamp);
+  put32(controlPeriod);
+  put32(framesDropped);
+  put32(outputStats.writeCount);
+  put32(outputStats.elidedCount);
+  endFrame();
+ }
+
+ // Acknowledges a command from the command link, with how long it took to act on
+ void Telemetry::sendCommand(unsigned long timestamp,int commandType,unsigned long latency) {
+  if(!beginFrame(TELEMETRY_COMMAND,9,PRIORITY_HIGH)) return;
+  put32(timestamp);
+  put8(commandType);
+  put32(latency);
+  endFrame();
+ }
+
+ // Writes as much of the queue as the port can take without blocking
+ void Telemetry::flush() {
+  int room = output->availableForWrite();
+  while(room > 0 && count > 0) {
+    // Write up to the end of the ring buffer in one go
+    int size = count;
+    if(size > room) size = room;
+    if(size > TELEMETRY_BUFFER_SIZE - head) size = TELEMETRY_BUFFER_SIZE - head;
+    output->write(&buffer[head],size);
+    head += size;
+    if(head == TELEMETRY_BUFFER_SIZE) head = 0;
+    count -= size;
+    room -= size;
+  }
+ }
+
+ unsigned long Telemetry::getFramesSent() {
+  return framesSent;
+ }
+
+ unsigned long Telemetry::getFramesDropped() {
+  return framesDropped;
+ }
+
+ // Returns the bytes waiting to be written
+ int Telemetry::getQueued() {
+  return count;
+ }
+
+ // Adds to the current text line, which is sent as a TEXT frame by println()
+ void Telemetry::print(const char* value) {
+  while(*value && textLength < TELEMETRY_MAX_PAYLOAD - 1) {
+    text[textLength++] = *value++;
+  }
+ }
+
+ void Telemetry::print(unsigned long value) {
+  char digits[12];
+  int length = 0;
+  do {
+    digits[length++] = '0' + value % 10;
+    value /= 10;
+  } while(value > 0);
+  while(length > 0 && textLength < TELEMETRY_MAX_PAYLOAD - 1) {
+    text[textLength++] = digits[--length];
+  }
+ }
+
+ void Telemetry::print(int value) {
+  if(value < 0) {
+    print("-");
+    value = -value;
+  }
+  print((unsigned long)value);
+ }
+
+ template <typename T>
+ void Telemetry::println(T value) {
+  print(value);
+  text[textLength] = 0;
+  sendText(text);
+  textLength = 0;
+ }
+#endif
@@ -0,0 +1,78 @@
+/* TripleBuffer class
+ * 18 October 2026
+ * 
+ * Lock-free handoff of the latest value from one task to another, where each side may be
+ * running on a different core. The producer always has a buffer of its own to write into and
+ * the consumer always has a buffer of its own to read from, so neither side ever waits and
+ * the consumer never sees a half written value. The third buffer holds the newest
+ * published value until the consumer picks it up. Values that are published faster than
+ * they are read are replaced, only the latest one is kept.
+ * 
+ * Only one producer and one consumer may use an instance.
+ */ 
+
+#ifndef TRIPLEBUFFER_H
+#define TRIPLEBUFFER_H
+
+#include <atomic>
+
+ // Set in the shared index when it holds a value the consumer has not picked up yet
+ const int TRIPLE_BUFFER_FRESH = 0x4;
+ const int TRIPLE_BUFFER_INDEX_MASK = 0x3;
+
+ template <typename T>
+ class TripleBuffer {
+  private:
+    T buffers[3];
+    std::atomic<int> sharedIndex; // Buffer in the middle, plus the fresh flag
+    int writeIndex; // Owned by the producer
+    int readIndex; // Owned by the consumer
+  public:
+    TripleBuffer(const T& initialValue);
+    T& getWriteBuffer();
+    void publish();
+    bool update();
+    const T& read();
+ };
+
+ // Constructor, every buffer starts with the initial value so read() is valid right away
+ template <typename T>
+ TripleBuffer<T>::TripleBuffer(const T& initialValue) : sharedIndex(1) {
+  for(int i = 0; i < 3; i++) {
+    buffers[i] = initialValue;
+  }
+  writeIndex = 0;
+  readIndex = 2;
+ }
+
+ // Producer: returns the buffer to fill before calling publish()
+ // NOTE: this buffer holds an older value, so it must be completely rewritten
+ template <typename T>
+ T& TripleBuffer<T>::getWriteBuffer() {
+  return buffers[writeIndex];
+ }
+
+ // Producer: makes the write buffer the newest value, and takes the old middle buffer to write into next
+ template <typename T>
+ void TripleBuffer<T>::publish() {
+  int previous = sharedIndex.exchange(writeIndex | TRIPLE_BUFFER_FRESH,std::memory_order_acq_rel);
+  writeIndex = previous & TRIPLE_BUFFER_INDEX_MASK;
+ }
+
+ // Consumer: picks up the newest value if there is one, returns true if read() has changed
+ template <typename T>
+ bool TripleBuffer<T>::update() {
+  if(!(sharedIndex.load(std::memory_order_acquire) & TRIPLE_BUFFER_FRESH)) {
+    return false;
+  }
+  int previous = sharedIndex.exchange(readIndex,std::memory_order_acq_rel);
+  readIndex = previous & TRIPLE_BUFFER_INDEX_MASK;
+  return true;
+ }
+
+ // Consumer: returns the value picked up by the last update()
+ template <typename T>
+ const T& TripleBuffer<T>::read() {
+  return buffers[readIndex];
+ }
+#endif
@@ -2,49 +2,276 @@
  * Written by Isaiah Knorr
  * 21 October, 2020
  * 
+ * 18 October 2026
+ * - Added an asynchronous ping API. startPing() fires the trigger and returns, the echo
+ *   edges are timestamped by a pin change interrupt, and poll() or a callback delivers the result
+ * - The echo timeout is now derived from the max range, so a ping never waits longer than
+ *   a useful echo could take
+ * - Hardware access goes through hal.h
+ * - The trigger and the echo read in the interrupt use the GPIO registers directly
+ * - Implemented getDistance(repeatNumber), a median filter that stops once the readings agree
+ * - Added setGate(), so a PingScheduler can hold pings back while another sensor could hear them
+ * - Added begin(), which sets up the pins and the echo interrupt from setup()
+ * 
  * For use with the HC-SR04 Ultrasonic module
  */ 
 
  #ifndef ULTRASONIC_H
  #define ULTRASONIC_H
 
+ #include "config.h"
+ #include "hal.h"
+ #include "filter.h"
+
+ // Echo pulse length per inch of distance (see datasheet, refined based on tests)
+ const double ULTRASONIC_MICROS_PER_INCH = 146.591;
+ const double ULTRASONIC_OFFSET = 0.088;
+
+ // States of an asynchronous ping
+ enum PingState {
+  PING_IDLE,     // No ping in flight
+  PING_WAITING,  // Trigger sent, waiting for the echo line to rise
+  PING_ECHO,     // Echo line is high, waiting for it to fall
+  PING_DONE      // Echo captured, waiting for poll() to collect it
+ };
+
+ /* Called from the interrupt when an echo has been captured. The echo time is passed in
+  * microseconds rather than a distance, because floating point is not allowed in an ISR.
+  * Use Ultrasonic::toMicros() to convert a distance threshold ahead of time.
+  */
+ typedef void (*EchoCallback)(unsigned long echoMicros,void* arg);
+
+ // Asked by startPing() before the trigger is fired, returns false to hold the ping back
+ typedef bool (*PingGate)(void* arg);
+
  class Ultrasonic {
   private:
     int triggerPin;
     int echoPin;
+    HalFastPin triggerFastPin;
+    HalFastPin echoFastPin;
+    unsigned long timeout; // Longest echo that is still in range, in microseconds
+    bool isAttached;
+    volatile PingState pingState;
+    volatile unsigned long triggerTime;
+    volatile unsigned long echoStartTime;
+    volatile unsigned long echoEndTime;
+    double lastDistance;
+    EchoCallback callback;
+    void* callbackArg;
+    PingGate gate;
+    void* gateArg;
+    static void IRAM_ATTR echoInterrupt(void* arg);
   public: 
     Ultrasonic();
     Ultrasonic(int triggerPin,int echoPin);
+    Ultrasonic(int triggerPin,int echoPin,int maxRange);
+    void begin();
     double getDistance();
     double getDistance(int repeatNumber);
+    bool startPing();
+    bool poll();
+    bool update();
+    bool isBusy();
+    double getLastDistance();
+    unsigned long getTimeout();
+    void setCallback(EchoCallback callback,void* arg);
+    void setGate(PingGate gate,void* arg);
+    static double toDistance(unsigned long echoMicros);
+    static unsigned long toMicros(double distance);
  };
 
  // Constructors
   Ultrasonic::Ultrasonic() {
+  triggerPin = -1;
+  echoPin = -1;
+  triggerFastPin = halFastPin(-1);
+  echoFastPin = halFastPin(-1);
+  timeout = toMicros(ULTRASONIC_MAX_RANGE);
+  isAttached = false;
+  pingState = PING_IDLE;
+  lastDistance = -1.0;
+  callback = 0;
+  callbackArg = 0;
+  gate = 0;
+  gateArg = 0;
  }
  
- Ultrasonic::Ultrasonic(int triggerPin,int echoPin) {
+ Ultrasonic::Ultrasonic(int triggerPin,int echoPin) : Ultrasonic(triggerPin,echoPin,ULTRASONIC_MAX_RANGE) {
+ }
+
+ Ultrasonic::Ultrasonic(int triggerPin,int echoPin,int maxRange) {
   this->triggerPin = triggerPin;
   this->echoPin = echoPin;
+  triggerFastPin = halFastPin(triggerPin);
+  echoFastPin = halFastPin(echoPin);
+  timeout = toMicros(maxRange);
+  isAttached = false;
+  pingState = PING_IDLE;
+  lastDistance = -1.0;
+  callback = 0;
+  callbackArg = 0;
+  gate = 0;
+  gateArg = 0;
  }
  
+ // Sets up the pins, the trigger low before it is made an output, and attaches the echo interrupt
+ void Ultrasonic::begin() {
+  halFastWrite(triggerFastPin,LOW);
+  halPinMode(triggerPin,OUTPUT);
+  halPinMode(echoPin,INPUT);
+  if(!isAttached) {
+    halAttachInterrupt(echoPin,echoInterrupt,this,CHANGE);
+    isAttached = true;
+  }
+ }
+
  // Returns the distance to the sensor in inches
  double Ultrasonic::getDistance() {
   // Set trigger high for 10 micro seconds
-  digitalWrite(triggerPin,HIGH);
-  delayMicroseconds(10);
-  digitalWrite(triggerPin,LOW);
+  halFastWrite(triggerFastPin,HIGH);
+  halDelayMicros(10);
+  halFastWrite(triggerFastPin,LOW);
   
-  // See datasheet to see where this conversion came from - was refined based on tests for increaced accuracy
-  double distance = (pulseIn(echoPin,HIGH)/ 146.591) - 0.088;
+  // Only wait as long as an echo from the max range could take
+  unsigned long echoTime = halPulseIn(echoPin,HIGH,ULTRASONIC_ECHO_START_MICROS + timeout);
 
-  // Check set error value of -1 if out of sensor range
-  if(distance > 400) 
-    return -1.0; 
+  // pulseIn returns 0 if the timeout was reached
+  if(echoTime == 0 || echoTime > timeout)
+    return -1.0;
     
-  // Return average value
-  return distance;
+  return toDistance(echoTime);
  } 
+
+ /* Takes up to repeatNumber readings, stopping early once ULTRASONIC_AGREE_COUNT readings in a row
+  * agree. Returns the mean of the readings close to the median, -1 if nothing is in range.
+  * Blocks for every ping, like getDistance().
+  */
+ double Ultrasonic::getDistance(int repeatNumber) {
+  MedianFilter filter(ULTRASONIC_AGREE_TOLERANCE);
+  for(int i = 0; i < repeatNumber; i++) {
+    filter.add(getDistance());
+    if(filter.isAgreed(ULTRASONIC_AGREE_COUNT)) break;
+  }
+  return filter.getEstimate();
+ }
+
+ /* Fires the trigger and returns immediately. Returns false if a ping is already in flight,
+  * the sensor is still holding the echo line high from a previous out of range ping, or the
+  * gate holds the ping back.
+  */
+ bool Ultrasonic::startPing() {
+  if(pingState != PING_IDLE) return false;
+
+  // The interrupt is attached here if begin() was not called, the constructor runs before setup()
+  if(!isAttached) {
+    halAttachInterrupt(echoPin,echoInterrupt,this,CHANGE);
+    isAttached = true;
+  }
+
+  // The HC-SR04 ignores triggers until the previous echo has ended
+  if(halFastRead(echoFastPin) == HIGH) return false;
+  if(gate && !gate(gateArg)) return false;
+
+  pingState = PING_WAITING;
+  triggerTime = halMicros();
+  halFastWrite(triggerFastPin,HIGH);
+  halDelayMicros(10);
+  halFastWrite(triggerFastPin,LOW);
+  return true;
+ }
+
+ // Timestamps the echo edges, runs in interrupt context
+ void IRAM_ATTR Ultrasonic::echoInterrupt(void* arg) {
+  Ultrasonic* sensor = (Ultrasonic*)arg;
+  unsigned long currentTime = halMicros();
+
+  if(sensor->pingState == PING_WAITING && halFastRead(sensor->echoFastPin) == HIGH) {
+    sensor->echoStartTime = currentTime;
+    sensor->pingState = PING_ECHO;
+  }
+  else if(sensor->pingState == PING_ECHO && halFastRead(sensor->echoFastPin) == LOW) {
+    sensor->echoEndTime = currentTime;
+    sensor->pingState = PING_DONE;
+    if(sensor->callback) {
+      sensor->callback(currentTime - sensor->echoStartTime,sensor->callbackArg);
+    }
+  }
+ }
+
+ /* Checks on the ping in flight. Returns true once it has finished, either with an echo or
+  * by timing out, and the result is then available from getLastDistance() (-1 if out of range)
+  */
+ bool Ultrasonic::poll() {
+  unsigned long currentTime = halMicros();
+
+  switch(pingState) {
+    case PING_IDLE:
+      return false;
+    case PING_WAITING:
+      // Echo never started
+      if(currentTime - triggerTime < ULTRASONIC_ECHO_START_MICROS) return false;
+      lastDistance = -1.0;
+      break;
+    case PING_ECHO:
+      // Anything still echoing after the timeout is beyond the max range
+      if(currentTime - echoStartTime < timeout) return false;
+      lastDistance = -1.0;
+      break;
+    case PING_DONE:
+      lastDistance = toDistance(echoEndTime - echoStartTime);
+      if(echoEndTime - echoStartTime > timeout) lastDistance = -1.0;
+      break;
+  }
+  pingState = PING_IDLE;
+  return true;
+ }
+
+ // Keeps a ping in flight, returns true each time a new reading is available
+ bool Ultrasonic::update() {
+  if(pingState == PING_IDLE) {
+    startPing();
+    return false;
+  }
+  return poll();
+ }
+
+ // Returns true while a ping is in flight
+ bool Ultrasonic::isBusy() {
+  return pingState != PING_IDLE;
+ }
+
+ // Returns the result of the last asynchronous ping in inches, -1 if out of range
+ double Ultrasonic::getLastDistance() {
+  return lastDistance;
+ }
+
+ // Returns the longest echo time that is still within range, in microseconds
+ unsigned long Ultrasonic::getTimeout() {
+  return timeout;
+ }
+
+ // Sets a function to be called from the interrupt as soon as an echo is captured
+ void Ultrasonic::setCallback(EchoCallback callback,void* arg) {
+  this->callbackArg = arg;
+  this->callback = callback;
+ }
+
+ // Sets a function asked before every asynchronous ping, see PingScheduler
+ void Ultrasonic::setGate(PingGate gate,void* arg) {
+  this->gateArg = arg;
+  this->gate = gate;
+ }
+
+ // Converts an echo time in microseconds to a distance in inches
+ double Ultrasonic::toDistance(unsigned long echoMicros) {
+  return (echoMicros / ULTRASONIC_MICROS_PER_INCH) - ULTRASONIC_OFFSET;
+ }
+
+ // Converts a distance in inches to an echo time in microseconds
+ unsigned long Ultrasonic::toMicros(double distance) {
+  return (distance + ULTRASONIC_OFFSET) * ULTRASONIC_MICROS_PER_INCH;
+ }
 #endif
  
  